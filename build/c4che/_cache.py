@@ -0,0 +1,52 @@
+AR = ['/usr/bin/ar']
+ARFLAGS = ['rcs']
+BINDIR = '/usr/local/bin'
+BOOST_VERSION = '1_74'
+CC_VERSION = ('12', '2', '0')
+COMPILER_CXX = 'g++'
+CPPPATH_ST = '-I%s'
+CXX = ['/usr/bin/g++']
+CXXFLAGS = ['-I/tmp/tbbshim', '-D_REENTRANT', '-Wall', '-fPIC', '-ftemplate-depth-1024', '-Wno-sign-compare', '-Wno-deprecated', '', '-Wno-unused', '-DSFERES_ROOT="/root/repo"', '', '-std=c++11', '-DEIGEN3_ENABLED']
+CXXFLAGS_MACBUNDLE = ['-fPIC']
+CXXFLAGS_cxxshlib = ['-fPIC']
+CXXLNK_SRC_F = []
+CXXLNK_TGT_F = ['-o']
+CXX_NAME = 'gcc'
+CXX_SRC_F = []
+CXX_TGT_F = ['-c', '-o']
+DEFINES_ST = '-D%s'
+DEFINES_TBB = ['USE_TBB']
+DEST_BINFMT = 'elf'
+DEST_CPU = 'x86_64'
+DEST_OS = 'linux'
+EIGEN_FOUND = True
+INCLUDES_BOOST = '/usr/include'
+INCLUDES_EIGEN = ['/usr/include/eigen3']
+INCLUDES_TBB = ['/usr/include']
+LIBDIR = '/usr/local/lib64'
+LIBPATH_BOOST = ['/usr/lib/x86_64-linux-gnu']
+LIBPATH_ST = '-L%s'
+LIBPATH_TBB = ['/usr/lib/x86_64-linux-gnu']
+LIB_BOOST = ['boost_serialization', 'boost_filesystem', 'boost_system', 'boost_unit_test_framework', 'boost_program_options', 'boost_graph', 'boost_thread', 'boost_regex', 'boost_mpi']
+LIB_MPI = ''
+LIB_ST = '-l%s'
+LIB_TBB = ['tbb']
+LINKFLAGS_MACBUNDLE = ['-bundle', '-undefined', 'dynamic_lookup']
+LINKFLAGS_cxxshlib = ['-shared']
+LINKFLAGS_cxxstlib = ['-Wl,-Bstatic']
+LINK_CXX = ['/usr/bin/g++']
+MPI_ENABLED = False
+MPI_FOUND = False
+PREFIX = '/usr/local'
+RPATH_ST = '-Wl,-rpath,%s'
+SFERES_ROOT = '/root/repo'
+SHLIB_MARKER = '-Wl,-Bdynamic'
+SONAME_ST = '-Wl,-h,%s'
+STLIBPATH_ST = '-L%s'
+STLIB_MARKER = '-Wl,-Bstatic'
+STLIB_ST = '-l%s'
+TBB_ENABLED = True
+cxxprogram_PATTERN = '%s'
+cxxshlib_PATTERN = 'lib%s.so'
+cxxstlib_PATTERN = 'lib%s.a'
+macbundle_PATTERN = '%s.bundle'
@@ -0,0 +1,2 @@
+version = 0x2000e00
+tools = [{'tool': 'ar', 'tooldir': None, 'funs': None}, {'tool': 'cxx', 'tooldir': None, 'funs': None}, {'tool': 'g++', 'tooldir': None, 'funs': None}, {'tool': 'compiler_cxx', 'tooldir': None, 'funs': None}, {'tool': 'boost', 'tooldir': None, 'funs': None}, {'tool': 'tbb', 'tooldir': None, 'funs': None}, {'tool': 'mpi', 'tooldir': None, 'funs': None}, {'tool': 'eigen', 'tooldir': None, 'funs': None}, {'tool': 'pthread', 'tooldir': None, 'funs': None}]
@@ -0,0 +1,130 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <boost/filesystem.hpp>
+#include <sferes/phen/parameters.hpp>
+#include <sferes/gen/evo_float.hpp>
+#include <sferes/ea/nsga2.hpp>
+#include <sferes/eval/eval.hpp>
+#include <sferes/modif/dummy.hpp>
+
+// compares the time to load a population from a gen file (boost archive)
+// and from a columnar checkpoint (see sferes/ea/checkpoint.hpp), with and
+// without the individuals stored as boost archives
+using namespace sferes;
+using namespace sferes::gen::evo_float;
+
+struct Params {
+  struct evo_float {
+    SFERES_CONST float cross_rate = 0.5f;
+    SFERES_CONST float mutation_rate = 0.1f;
+    SFERES_CONST float eta_m = 15.0f;
+    SFERES_CONST float eta_c = 10.0f;
+    SFERES_CONST mutation_t mutation_type = polynomial;
+    SFERES_CONST cross_over_t cross_over_type = sbx;
+  };
+  struct pop {
+    SFERES_CONST unsigned size = 20000;
+    SFERES_CONST unsigned nb_gen = 1;
+    SFERES_CONST float initial_aleat = 1.0f;
+    SFERES_CONST int dump_period = 1;
+  };
+  struct parameters {
+    SFERES_CONST float min = 0.0f;
+    SFERES_CONST float max = 1.0f;
+  };
+};
+
+struct ParamsIndivs : public Params {
+  struct pop : public Params::pop {
+    SFERES_CONST bool checkpoint_indivs = true;
+  };
+};
+
+SFERES_FITNESS(FitZDT1, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(2);
+    float g = 1.0f;
+    for (size_t i = 1; i < ind.size(); ++i)
+      g += 9.0f * ind.data(i) / (ind.size() - 1);
+    this->_objs[0] = -ind.data(0);
+    this->_objs[1] = -g * (1.0f - sqrtf(ind.data(0) / g));
+  }
+};
+
+template<typename E>
+double load_time(const std::string& fname) {
+  typedef std::chrono::steady_clock clock_t;
+  double best = 1e10;
+  for (size_t k = 0; k < 5; ++k) {
+    E ea;
+    clock_t::time_point t = clock_t::now();
+    ea.load(fname);
+    best = std::min(best, std::chrono::duration<double>(clock_t::now() - t).count());
+  }
+  return best;
+}
+
+template<typename P>
+double bench(const std::string& dir, double& t_archive) {
+  typedef gen::EvoFloat<30, P> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT1<P>, P> phen_t;
+  typedef ea::Nsga2<phen_t, eval::Eval<P>, boost::fusion::vector<>, modif::Dummy<>, P> ea_t;
+  ea_t ea;
+  ea.set_res_dir(dir);
+  ea.random_pop();
+  ea.update_stats();
+  ea.write(0);
+  ea.write_checkpoint(dir + "/gen_0.ckpt");
+  t_archive = load_time<ea_t>(dir + "/gen_0");
+  return load_time<ea_t>(dir + "/gen_0.ckpt");
+}
+
+int main() {
+  std::string dir = "bench_checkpoint";
+  double t_archive, t_indivs;
+  double t_columnar = bench<Params>(dir, t_archive);
+  t_indivs = bench<ParamsIndivs>(dir, t_archive);
+  std::cout << "N=" << Params::pop::size
+            << " gen file:" << t_archive << " s"
+            << " checkpoint:" << t_columnar << " s"
+            << " checkpoint with the individuals:" << t_indivs << " s" << std::endl;
+  boost::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,87 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <sferes/misc/rand.hpp>
+#include <sferes/fit/obj_matrix.hpp>
+#include <sferes/ea/dom_sort.hpp>
+
+// compares the non-dominated sorting backends (see sferes/ea/dom_sort.hpp)
+// for different numbers of individuals and objectives, with continuous
+// and discretized objectives (many duplicates)
+using namespace sferes;
+
+template<typename Sort>
+double bench(const fit::ObjMatrix& objs, size_t& nb_fronts) {
+  Sort sorter;
+  ea::Fronts fronts;
+  std::vector<size_t> ranks;
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  sorter(objs, fronts, ranks);
+  nb_fronts = fronts.size();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+int main() {
+  size_t sizes[] = { 500, 2000, 4000 };
+  size_t nb_objs[] = { 2, 3, 4, 6 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(size_t); ++s)
+    for (size_t m = 0; m < sizeof(nb_objs) / sizeof(size_t); ++m)
+      for (int discrete = 0; discrete < 2; ++discrete) {
+        fit::ObjMatrix objs;
+        objs.resize(sizes[s], nb_objs[m]);
+        std::vector<float> o(nb_objs[m]);
+        for (size_t i = 0; i < sizes[s]; ++i) {
+          for (size_t k = 0; k < nb_objs[m]; ++k) {
+            float v = misc::rand<float>(10);
+            o[k] = discrete ? floorf(v) : v;
+          }
+          objs.set_row(i, o);
+        }
+        size_t nb_fronts;
+        double deb = bench<ea::dom_sort_f>(objs, nb_fronts);
+        double ss = bench<ea::dom_sort_ens_ss_f>(objs, nb_fronts);
+        double bs = bench<ea::dom_sort_ens_bs_f>(objs, nb_fronts);
+        std::cout << "N=" << sizes[s] << " M=" << nb_objs[m]
+                  << (discrete ? " (discrete)" : "")
+                  << " fronts=" << nb_fronts
+                  << " deb:" << deb << " s"
+                  << " ens-ss:" << ss << " s"
+                  << " ens-bs:" << bs << " s" << std::endl;
+      }
+  return 0;
+}
@@ -37,15 +37,19 @@ def list_open_exps(exps, res_dir, nb_reps):
 def last_gen_file(res_dir, exp):
      d = res_dir + "/" + exp[0] + "/exp_" + str(exp[1])
      print d
-     l = glob.glob(d + "/gen_*")
+     l = [f for f in glob.glob(d + "/gen_*") if f.split('_')[-1].isdigit()]
+     if len(l) == 0: # interrupted before the first generation
+         return None, -1
      l.sort(lambda x,y: int(x.split('_')[-1]) - int(y.split('_')[-1]))
      return l[-1], int(l[-1].split('_')[-1])
 
 def sig_handler(signum, frame, process, exp, res_dir):
     print sys.argv[0], 'Signal handler called with signal', signum
-    # we kill our experiment (this is unfortunate!)
+    # the experiment writes its last complete generation and its status
+    # ('interrupted') before exiting (see run_ea and --stop-deadline)
     process.send_signal(signum)
-    print sys.argv[0], ' -> exiting (signal sent to the child)'
+    print sys.argv[0], ' -> waiting for the child (signal sent)'
+    process.wait()
     exit(0)
 
 def unlock(res_dir): os.remove(res_dir + '/lock')
@@ -121,7 +125,10 @@ def main(conf_file):
         # find the most recent gen file
         gen_file, gen = last_gen_file(res_dir, exp)
         print sys.argv[0], "gen file:", gen_file
-        to_execute = bin_dir + "/" + exp[0] + " -r " + gen_file + " -d " + res_dir + "/" + exp[0] + "/exp_" + str(exp[1])
+        if gen_file == None: # nothing to resume, we start again
+            to_execute = bin_dir + "/" + exp[0] + " -d " + res_dir + "/" + exp[0] + "/exp_" + str(exp[1])
+        else:
+            to_execute = bin_dir + "/" + exp[0] + " -r " + gen_file + " -d " + res_dir + "/" + exp[0] + "/exp_" + str(exp[1])
      else:
         print 'unknown status', exp[2]
         unlock()
@@ -133,6 +140,7 @@ def main(conf_file):
      def handler(x, y) : sig_handler(x, y, process, exp, res_dir)
      signal.signal(signal.SIGINT, handler)
      signal.signal(signal.SIGQUIT, handler)
+     signal.signal(signal.SIGTERM, handler)
      # we do not trap sigkill (should we?)
 
      #remove the lock
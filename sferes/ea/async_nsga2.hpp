@@ -0,0 +1,530 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+
+#ifndef ASYNC_NSGA2_HPP_
+#define ASYNC_NSGA2_HPP_
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#ifndef NO_PARALLEL
+#include <mutex>
+#include <tbb/task_group.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include <sferes/stc.hpp>
+#include <sferes/parallel.hpp>
+#include <sferes/ea/ea.hpp>
+#include <sferes/fit/fitness.hpp>
+#include <sferes/fit/obj_matrix.hpp>
+#include <sferes/fit/dominate_block.hpp>
+#include <sferes/ea/dom_sort.hpp>
+#include <sferes/ea/common.hpp>
+#include <sferes/ea/crowd.hpp>
+#include <sferes/modif/dummy.hpp>
+
+namespace sferes {
+  namespace ea {
+    namespace _async_nsga2 {
+      // evaluated individuals, in the order of completion
+      template<typename T>
+      class done_queue {
+       public:
+        void push(const T& t) {
+#ifndef NO_PARALLEL
+          std::lock_guard<std::mutex> lock(_mutex);
+#endif
+          _queue.push_back(t);
+        }
+        // false if no individual is available
+        bool try_pop(T& t) {
+#ifndef NO_PARALLEL
+          std::lock_guard<std::mutex> lock(_mutex);
+#endif
+          if (_queue.empty())
+            return false;
+          t = _queue.front();
+          _queue.pop_front();
+          return true;
+        }
+       protected:
+        std::deque<T> _queue;
+#ifndef NO_PARALLEL
+        std::mutex _mutex;
+#endif
+      };
+
+      // evaluate one individual (in a task), then push it to the queue
+      template<typename Indiv, typename Fit>
+      struct evaluate {
+        Indiv _ind;
+        Fit _fit;
+        done_queue<Indiv>& _done;
+
+        evaluate(const Indiv& ind, const Fit& fit, done_queue<Indiv>& done) :
+          _ind(ind), _fit(fit), _done(done) {}
+        void operator()() const {
+          _ind->fit() = _fit;
+          _ind->develop();
+          _ind->fit().eval(*_ind);
+          for (size_t j = 0; j < _ind->fit().objs().size(); ++j) {
+            assert(!std::isnan(_ind->fit().objs()[j]));
+          }
+          _done.push(_ind);
+        }
+      };
+
+      // modif::Dummy does not change the objectives
+      template<typename M>
+      struct is_dummy : boost::false_type {};
+      template<typename P, typename E>
+      struct is_dummy<modif::Dummy<P, E> > : boost::true_type {};
+
+      struct has_modifier_f {
+        bool& _r;
+        has_modifier_f(bool& r) : _r(r) {}
+        template<typename M>
+        void operator()(const M&) const {
+          _r = _r || !is_dummy<M>::value;
+        }
+      };
+    }
+
+    // Steady-state NSGA-II with asynchronous evaluations: up to
+    // Params::pop::nb_in_flight offspring are evaluated at the same time on
+    // the TBB pool, and each of them is inserted in the population as soon
+    // as its evaluation is finished (the worst individual, i.e. the one with
+    // the lowest crowding distance in the last front, is removed). A new
+    // offspring is then started, so that no thread waits for the slowest
+    // evaluation of a generation (e.g. with FitnessSimu).
+    //
+    // - an epoch (a "generation" for the stats and the dumps) is
+    //   Params::pop::epoch_evals completed evaluations
+    // - ranks are updated incrementally at each insertion; crowding
+    //   distances are only recomputed for the fronts that changed
+    // - the fitness modifiers (if any, modif::Dummy is ignored) are applied
+    //   to the population and the offspring before each insertion, so that
+    //   the offspring are never ranked on their raw objectives; as the
+    //   modifiers can change the objectives of every individual, the
+    //   population is then fully re-ranked (instead of incrementally)
+    // - the population is fully re-ranked at the end of each epoch
+    // - the initial population is evaluated by Eval; offspring are evaluated
+    //   directly by TBB tasks; when none of them is finished, the main thread
+    //   evaluates an offspring itself instead of waiting (everything is
+    //   sequential if NO_PARALLEL is defined or if there is only one thread)
+    // param : size
+    // param : nb_in_flight
+    // param : epoch_evals
+    SFERES_EA(AsyncNsga2, Ea) {
+    public:
+      typedef boost::shared_ptr<crowd::Indiv<Phen> > indiv_t;
+      typedef typename std::vector<indiv_t> pop_t;
+      typedef typename Phen::fit_t fit_t;
+      SFERES_EA_FRIEND(AsyncNsga2);
+
+      AsyncNsga2() : _free(0), _nb_in_flight(0), _nb_async_evals(0), _async(false) {
+        _modified = false;
+        boost::fusion::for_each(this->_fit_modifier, _async_nsga2::has_modifier_f(_modified));
+      }
+      ~AsyncNsga2() {
+        _wait_all();
+      }
+
+      void random_pop() {
+        _init_tasks();
+        pop_t init_pop(Params::pop::size);
+        parallel::p_for(parallel::range_t(0, init_pop.size()),
+                        random<crowd::Indiv<Phen> >(init_pop));
+        this->_eval_pop(init_pop, 0, init_pop.size());
+        _init_parents(init_pop);
+        _apply_modifier();
+      }
+
+      void epoch() {
+        _launch();
+        for (size_t k = 0; k < Params::pop::epoch_evals; ++k) {
+          indiv_t ind = _next();
+          --_nb_in_flight;
+          ++_nb_async_evals;
+          if (_modified)
+            _insert_modified(ind);
+          else
+            _insert(ind);
+          _launch();
+        }
+#ifndef NDEBUG
+        _check_ranks();
+#endif
+        _apply_modifier();
+        assert(this->_pop.size() == Params::pop::size);
+      }
+
+      const std::vector<boost::shared_ptr<Phen> >& pareto_front() const {
+        return _pareto_front;
+      }
+      // evaluations of the initial population + completed asynchronous evaluations
+      size_t nb_evals() const {
+        return this->_eval.nb_evals() + _nb_async_evals;
+      }
+      size_t nb_in_flight() const {
+        return _nb_in_flight;
+      }
+
+    protected:
+      std::vector<boost::shared_ptr<Phen> > _pareto_front;
+      // Params::pop::size individuals + a free slot (_free), which receives
+      // each evaluated offspring before the worst individual is removed
+      pop_t _parents;
+      size_t _free;
+      // offspring that are not started yet (cross() creates 2 of them)
+      pop_t _pending;
+      // objectives, ranks and crowding distances of the slots of _parents
+      fit::ObjMatrix _objs;
+      std::vector<size_t> _ranks;
+      std::vector<float> _crowd;
+      // full re-ranking (once per epoch)
+      fit::ObjMatrix _sort_objs;
+      Fronts _fronts;
+      dom_sort_f _dom_sorter;
+      std::vector<size_t> _scratch, _sorted, _touched;
+
+      _async_nsga2::done_queue<indiv_t> _done;
+      size_t _nb_in_flight;
+      size_t _nb_async_evals;
+      bool _async;
+      // true if there is a modifier other than modif::Dummy
+      bool _modified;
+#ifndef NO_PARALLEL
+      tbb::task_group _tasks;
+#endif
+
+      // for resuming
+      void _set_pop(const std::vector<boost::shared_ptr<Phen> >& pop) {
+        assert(pop.size() == Params::pop::size);
+        _init_tasks();
+        pop_t p(pop.size());
+        for (size_t i = 0; i < pop.size(); ++i)
+          p[i] = misc::Pool<crowd::Indiv<Phen> >::create(*pop[i]);
+        _init_parents(p);
+        _apply_modifier();
+      }
+
+      void _init_tasks() {
+        parallel::init();
+        _wait_all();
+#ifndef NO_PARALLEL
+        // with a single thread, the tasks would only run in _wait_all()
+        _async = tbb::this_task_arena::max_concurrency() > 1;
+#endif
+      }
+
+      void _wait_all() {
+#ifndef NO_PARALLEL
+        _tasks.wait();
+#endif
+        indiv_t ind;
+        while (_done.try_pop(ind))
+          --_nb_in_flight;
+        assert(_nb_in_flight == 0);
+      }
+
+      // next evaluated offspring (the main thread evaluates offspring
+      // while none of the running evaluations is finished)
+      indiv_t _next() {
+        indiv_t ind;
+        while (!_done.try_pop(ind))
+          _start(false);
+        return ind;
+      }
+
+      void _init_parents(const pop_t& pop) {
+        _parents = pop;
+        _parents.push_back(indiv_t());
+        _free = pop.size();
+        _pending.clear();
+      }
+
+      // move the free slot to the end, so that [0, size) are the individuals
+      void _compact() {
+        size_t last = Params::pop::size;
+        if (_free == last)
+          return;
+        std::swap(_parents[_free], _parents[last]);
+        _free = last;
+      }
+
+      // apply the modifiers to the population, then rank it from scratch
+      void _apply_modifier() {
+        _compact();
+        this->_pop.resize(Params::pop::size);
+        for (size_t i = 0; i < this->_pop.size(); ++i)
+          this->_pop[i] = _parents[i];
+        this->apply_modifier();
+        _rank_all();
+      }
+
+      void _rank_all() {
+        assert(_free == Params::pop::size);
+        const size_t size = Params::pop::size;
+        const size_t nb_objs = _parents[0]->fit().objs().size();
+        pop_t pop(_parents.begin(), _parents.begin() + size);
+        _sort_objs.snapshot(pop);
+        _dom_sorter(_sort_objs, _fronts, _ranks);
+        _crowd.resize(size);
+        parallel::p_for(parallel::range_t(0, _fronts.size()),
+                        crowd::crowd_fronts(_sort_objs, _fronts, _crowd));
+        // one more slot for the incoming offspring
+        _objs.resize(size + 1, nb_objs);
+        for (size_t i = 0; i < size; ++i) {
+          _objs.set_row(i, _parents[i]->fit().objs());
+          _parents[i]->set_rank(_ranks[i]);
+          _parents[i]->set_crowd(_crowd[i]);
+        }
+        _ranks.resize(size + 1);
+        _crowd.resize(size + 1);
+        _update_pareto_front();
+      }
+
+      void _update_pareto_front() {
+        _pareto_front.clear();
+        for (size_t i = 0; i < _parents.size(); ++i)
+          if (i != _free && _ranks[i] == 0)
+            _pareto_front.push_back(_parents[i]);
+      }
+
+      // start new evaluations until nb_in_flight are running
+      void _launch() {
+        while (_nb_in_flight < Params::pop::nb_in_flight)
+          _start(_async);
+      }
+
+      // evaluate the next offspring in a task or in this thread
+      void _start(bool async) {
+        if (_pending.empty())
+          _make_offspring();
+        indiv_t ind = _pending.back();
+        _pending.pop_back();
+        ++_nb_in_flight;
+        _async_nsga2::evaluate<indiv_t, fit_t> task(ind, this->_fit_proto, _done);
+#ifndef NO_PARALLEL
+        if (async) {
+          _tasks.run(task);
+          return;
+        }
+#endif
+        task();
+      }
+
+      // --- tournament selection + variation ---
+      size_t _rand_slot() const {
+        size_t k = misc::rand(Params::pop::size);
+        return k < _free ? k : k + 1;
+      }
+
+      size_t _tournament(size_t i1, size_t i2) const {
+        int flag = _objs.dominate_flag(i1, i2);
+        if (flag == 1)
+          return i1;
+        if (flag == -1)
+          return i2;
+        if (_crowd[i1] > _crowd[i2])
+          return i1;
+        if (_crowd[i1] < _crowd[i2])
+          return i2;
+        if (misc::flip_coin())
+          return i1;
+        else
+          return i2;
+      }
+
+      void _make_offspring() {
+        size_t p1 = _tournament(_rand_slot(), _rand_slot());
+        size_t p2 = _tournament(_rand_slot(), _rand_slot());
+        indiv_t o1, o2;
+        _parents[p1]->cross(_parents[p2], o1, o2);
+        o1->mutate();
+        o2->mutate();
+        _pending.push_back(o1);
+        _pending.push_back(o2);
+      }
+
+      // --- insertion ---
+      void _insert(const indiv_t& ind) {
+        const size_t x = _free;
+        const std::vector<float>& o = ind->fit().objs();
+        assert(o.size() == _objs.nb_objs());
+        _parents[x] = ind;
+        _objs.set_row(x, o);
+
+        // rank of x: 1 + the highest rank of the individuals that dominate it
+        // (the individuals dominated by x are in _scratch)
+        _scratch.clear();
+        size_t rank = 0;
+        bool dominated = false;
+        for (size_t b = 0; b < _objs.size(); b += fit::ObjMatrix::block_size) {
+          unsigned dominating_mask, dominated_mask;
+          fit::dominate_block(&o[0], _objs, b, dominating_mask, dominated_mask);
+          for (; dominated_mask; dominated_mask &= dominated_mask - 1) {
+            size_t p = b + __builtin_ctz(dominated_mask);
+            rank = std::max(rank, _ranks[p] + 1);
+            dominated = true;
+          }
+          for (; dominating_mask; dominating_mask &= dominating_mask - 1)
+            _scratch.push_back(b + __builtin_ctz(dominating_mask));
+        }
+        if (!dominated)
+          rank = 0;
+        _ranks[x] = rank;
+
+        // fronts whose crowding distances have to be recomputed
+        std::vector<size_t>& touched = _touched;
+        touched.assign(1, rank);
+
+        // the individuals dominated by x can only move to a higher front;
+        // in lexicographic order, each of them comes after its dominators
+        std::sort(_scratch.begin(), _scratch.end(), fit::compare_rows_lex(_objs));
+        for (size_t i = 0; i < _scratch.size(); ++i) {
+          size_t q = _scratch[i];
+          size_t r = std::max(_ranks[q], rank + 1);
+          for (size_t j = 0; j < i; ++j)
+            if (_objs.dominate_flag(_scratch[j], q) == 1)
+              r = std::max(r, _ranks[_scratch[j]] + 1);
+          if (r != _ranks[q]) {
+            touched.push_back(_ranks[q]);
+            touched.push_back(r);
+            _ranks[q] = r;
+          }
+        }
+
+        // the worst individual is in the last front (so it does not
+        // dominate anybody and its removal does not change the ranks)
+        size_t last = 0;
+        for (size_t i = 0; i < _parents.size(); ++i)
+          last = std::max(last, _ranks[i]);
+        _crowd_front(last);
+        size_t worst = x;
+        float worst_crowd = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < _parents.size(); ++i)
+          if (_ranks[i] == last && _crowd[i] < worst_crowd) {
+            worst = i;
+            worst_crowd = _crowd[i];
+          }
+        _parents[worst].reset();
+        _free = worst;
+        touched.push_back(last);
+
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for (size_t i = 0; i < touched.size(); ++i)
+          _crowd_front(touched[i]);
+
+        for (size_t i = 0; i < _parents.size(); ++i)
+          if (i != _free) {
+            _parents[i]->set_rank(_ranks[i]);
+            _parents[i]->set_crowd(_crowd[i]);
+          }
+      }
+
+      // the modifiers can change the objectives of all the individuals:
+      // they are applied to the population + the offspring, which are
+      // then ranked from scratch (the worst individual is removed)
+      void _insert_modified(const indiv_t& ind) {
+        _parents[_free] = ind;
+        this->_pop.resize(_parents.size());
+        for (size_t i = 0; i < _parents.size(); ++i)
+          this->_pop[i] = _parents[i];
+        this->apply_modifier();
+
+        _sort_objs.snapshot(_parents);
+        _dom_sorter(_sort_objs, _fronts, _ranks);
+        parallel::p_for(parallel::range_t(0, _fronts.size()),
+                        crowd::crowd_fronts(_sort_objs, _fronts, _crowd));
+        for (size_t i = 0; i < _parents.size(); ++i)
+          _objs.set_row(i, _parents[i]->fit().objs());
+
+        const size_t last = _fronts.size() - 1;
+        size_t worst = *_fronts.begin(last);
+        for (const size_t* p = _fronts.begin(last); p != _fronts.end(last); ++p)
+          if (_crowd[*p] < _crowd[worst])
+            worst = *p;
+        _parents[worst].reset();
+        _free = worst;
+        _crowd_front(last);
+
+        for (size_t i = 0; i < _parents.size(); ++i)
+          if (i != _free) {
+            _parents[i]->set_rank(_ranks[i]);
+            _parents[i]->set_crowd(_crowd[i]);
+          }
+      }
+
+      // the incremental ranks must be the same as a full sort
+      void _check_ranks() {
+        pop_t pop;
+        std::vector<size_t> ranks;
+        for (size_t i = 0; i < _parents.size(); ++i)
+          if (i != _free) {
+            pop.push_back(_parents[i]);
+            ranks.push_back(_ranks[i]);
+          }
+        fit::ObjMatrix objs;
+        objs.snapshot(pop);
+        Fronts fronts;
+        std::vector<size_t> full_ranks;
+        dom_sort(objs, fronts, full_ranks);
+        assert(ranks == full_ranks);
+      }
+
+      // recompute the crowding distances of the individuals of rank r
+      void _crowd_front(size_t r) {
+        _scratch.clear();
+        for (size_t i = 0; i < _parents.size(); ++i)
+          if (_parents[i] && _ranks[i] == r)
+            _scratch.push_back(i);
+        if (!_scratch.empty())
+          crowd::crowding_distance(_objs, &_scratch[0], &_scratch[0] + _scratch.size(),
+                                   _crowd, _sorted);
+      }
+    };
+  }
+}
+#endif
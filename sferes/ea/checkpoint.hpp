@@ -0,0 +1,588 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef EA_CHECKPOINT_HPP_
+#define EA_CHECKPOINT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <sferes/misc/pool.hpp>
+#include <sferes/gen/columns.hpp>
+
+namespace sferes {
+  namespace ea {
+    // Columnar checkpoints (the gen files written with
+    // SFERES_COLUMNAR_CHECKPOINT, or converted with --convert)
+    // Layout (native endianness; offsets from the start of the file; the
+    // matrices are aligned on 64 bytes so that they can be used in place
+    // when the file is mapped):
+    //  - header_t
+    //  - blob_t[nb_blobs]: one blob per stat, in the order of the stats
+    //  - the genomes: nb_genomes rows of genome_size scalars (gen::columns)
+    //  - the fitness values: pop_size floats
+    //  - the objectives: nb_objs columns of pop_size floats
+    //  - (delta only) the sources: pop_size uint32_t
+    //  - (has_indivs only) the individuals: blob_t[nb_genomes], one per
+    //    row of the genomes
+    //  - the blobs: boost binary archives (see WriteStat_f)
+    //  - (has_indivs only) the individual blobs: boost binary archives
+    // The population of the stat number pop_blob (a stat::State) is stored
+    // in the matrices, and its blob is empty; if the genotype does not
+    // provide gen::columns, pop_blob is no_blob and the state is a blob
+    // like the other stats. The individuals are rebuilt from the genomes,
+    // the values and the objectives, unless they have other serialized
+    // members (see indivs): they are then also stored, and loaded, as
+    // boost archives (flag has_indivs).
+    // A delta checkpoint (see History) only stores the genomes of the
+    // individuals that were not in the population of its parent, i.e. the
+    // checkpoint gen_<parent_gen> of the same directory: the source of the
+    // individual i is its row in the population of the parent, or no_blob
+    // if it is the next row of the genomes. An individual is only taken
+    // from the parent if what is stored about it (genome, value,
+    // objectives and blob) is the same, so that a delta loads the same
+    // individuals as a full checkpoint. The values, the objectives and the
+    // other stats are always stored in full.
+    namespace checkpoint {
+      static const char magic[8] = { 'S', 'F', 'E', 'R', 'E', 'S', 'C', 'K' };
+      static const uint32_t version = 1;
+      static const uint32_t no_blob = 0xFFFFFFFFu;
+      static const size_t alignment = 64;
+
+      struct header_t {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t gen;
+        uint64_t pop_size;
+        uint32_t genome_size;
+        uint32_t scalar_size;
+        uint32_t nb_objs;
+        uint32_t nb_blobs;
+        uint32_t pop_blob;
+        uint32_t reserved;
+        uint64_t genomes, values, objs;
+        uint32_t kind;
+        uint32_t flags;
+        uint64_t parent_gen;
+        uint64_t nb_genomes;
+        uint64_t sources;
+        uint64_t indivs;
+        // the seed of the run (if flags & has_seed, see stat::State)
+        uint64_t seed;
+      };
+      enum kind_t { full = 0, delta = 1 };
+      enum flags_t { has_seed = 1, has_indivs = 2 };
+      struct blob_t {
+        uint64_t offset, size;
+      };
+
+      inline size_t _align(size_t n) {
+        return (n + alignment - 1) / alignment * alignment;
+      }
+
+      // Params::pop::checkpoint_indivs (optional, false by default): the
+      // individuals have serialized members that the matrices do not hold
+      // (e.g. a behaviour descriptor in the fitness), so they are also
+      // stored as boost archives (slower to load, and the files depend on
+      // the version of boost)
+      template<typename P, typename Enable = void>
+      struct indivs {
+        SFERES_CONST bool value = false;
+      };
+      template<typename P>
+      struct indivs<P, typename stc::Void<decltype(P::pop::checkpoint_indivs)>::type> {
+        SFERES_CONST bool value = P::pop::checkpoint_indivs;
+      };
+
+      // the blob of an individual
+      template<typename Phen>
+      void save_indiv(const Phen& p, std::string& out) {
+        boost::iostreams::stream<boost::iostreams::back_insert_device<std::string> >
+        os(out);
+        boost::archive::binary_oarchive oa(os);
+        oa << p;
+      }
+      template<typename Phen>
+      void load_indiv(const char* data, size_t size, Phen& p) {
+        boost::iostreams::stream<boost::iostreams::array_source> is(data, size);
+        boost::archive::binary_iarchive ia(is);
+        ia >> p;
+      }
+
+      inline bool is_checkpoint(const std::string& fname) {
+        char m[sizeof(magic)];
+        std::ifstream ifs(fname.c_str(), std::ios::binary);
+        return ifs.read(m, sizeof(m)) && memcmp(m, magic, sizeof(m)) == 0;
+      }
+
+      // The population of the last checkpoint of a run, to write deltas:
+      // with a period k > 1, a full checkpoint is followed by k - 1 deltas,
+      // each one relative to the previous checkpoint (k <= 1: only full
+      // checkpoints). The individuals are recognized by what is stored about
+      // them (and not by their address, since the stats may see copies, see
+      // Snapshot).
+      class History {
+       public:
+        History() : _period(0), _nb_checkpoints(0), _gen(0), _row_bytes(0) {}
+        void set_period(size_t k) {
+          _period = k;
+          reset();
+        }
+        size_t period() const {
+          return _period;
+        }
+        // the next checkpoint will be full (e.g. if the last one was lost)
+        void reset() {
+          _nb_checkpoints = 0;
+          _rows.clear();
+          _keys.clear();
+        }
+        // the generation of the last checkpoint
+        size_t gen() const {
+          return _gen;
+        }
+        bool delta_due(size_t gen, size_t row_bytes) const {
+          return _nb_checkpoints > 0 && _nb_checkpoints < _period
+                 && gen > _gen && row_bytes == _row_bytes;
+        }
+        // a row of the last checkpoint with this key (what is stored about
+        // the individual), or no_blob
+        uint32_t row(const std::string& key) const {
+          std::unordered_map<uint64_t, uint32_t>::const_iterator it =
+            _rows.find(_hash(key));
+          if (it == _rows.end() || _keys[it->second] != key)
+            return no_blob;
+          return it->second;
+        }
+        // keys (the individuals of the new checkpoint) is swapped
+        void update(size_t gen, bool is_delta, std::vector<std::string>& keys, size_t row_bytes) {
+          _nb_checkpoints = is_delta ? _nb_checkpoints + 1 : 1;
+          _gen = gen;
+          _row_bytes = row_bytes;
+          _keys.swap(keys);
+          _rows.clear();
+          for (size_t i = 0; i < _keys.size(); ++i)
+            _rows.insert(std::make_pair(_hash(_keys[i]), (uint32_t)i));
+        }
+       protected:
+        // FNV-1a
+        static uint64_t _hash(const std::string& key) {
+          uint64_t h = 14695981039346656037ULL;
+          for (size_t i = 0; i < key.size(); ++i)
+            h = (h ^ (unsigned char)key[i]) * 1099511628211ULL;
+          return h;
+        }
+        size_t _period, _nb_checkpoints, _gen, _row_bytes;
+        std::unordered_map<uint64_t, uint32_t> _rows;
+        std::vector<std::string> _keys;
+      };
+
+      // assembles a checkpoint in a buffer (e.g. of misc::AsyncWriter);
+      // with a history, the population is stored as a delta when it is due
+      class Builder {
+       public:
+        Builder(History* history = 0) : _history(history) {
+          memset(&_header, 0, sizeof(_header));
+          memcpy(_header.magic, magic, sizeof(magic));
+          _header.version = version;
+          _header.header_size = sizeof(header_t);
+          _header.pop_blob = no_blob;
+          _header.scalar_size = sizeof(float);
+        }
+        // the blob of the next stat, to be filled
+        std::string& add_blob() {
+          _blobs.push_back(std::string());
+          return _blobs.back();
+        }
+        // the next stat is the population pop (with an empty blob); false
+        // if it cannot be stored in the matrices (and nothing is added)
+        // the seed of the run
+        void set_seed(uint64_t seed) {
+          _header.seed = seed;
+          _header.flags |= has_seed;
+        }
+        // with_indivs: also store the individuals as boost archives (see
+        // indivs)
+        template<typename Phen>
+        bool add_pop(size_t gen, const std::vector<boost::shared_ptr<Phen> >& pop,
+                     bool with_indivs = false) {
+          typedef gen::columns<typename Phen::gen_t> columns_t;
+          if (!columns_t::enabled || _header.pop_blob != no_blob)
+            return false;
+          size_t nb_objs = pop.empty() ? 0 : pop[0]->fit().objs().size();
+          for (size_t i = 0; i < pop.size(); ++i)
+            if (pop[i]->fit().objs().size() != nb_objs)
+              return false;
+          _header.gen = gen;
+          _header.pop_size = pop.size();
+          _header.genome_size = columns_t::size();
+          _header.scalar_size = sizeof(typename columns_t::scalar_t);
+          _header.nb_objs = nb_objs;
+          _header.pop_blob = _blobs.size();
+          size_t row_bytes = columns_t::size() * _header.scalar_size;
+          if (with_indivs)
+            _header.flags |= has_indivs;
+          std::vector<char> genomes(pop.size() * row_bytes);
+          std::vector<std::string> indivs(with_indivs ? pop.size() : 0);
+          // what is stored about each individual (see History)
+          std::vector<std::string> keys(pop.size());
+          _values.resize(pop.size());
+          _objs.resize(pop.size() * nb_objs);
+          typename columns_t::scalar_t* g =
+            reinterpret_cast<typename columns_t::scalar_t*>(genomes.data());
+          for (size_t i = 0; i < pop.size(); ++i) {
+            columns_t::get(pop[i]->gen(), g + i * columns_t::size());
+            _values[i] = pop[i]->fit().value();
+            for (size_t k = 0; k < nb_objs; ++k)
+              _objs[k * pop.size() + i] = pop[i]->fit().objs()[k];
+            keys[i].assign(&genomes[i * row_bytes], row_bytes);
+            keys[i].append(reinterpret_cast<const char*>(&_values[i]), sizeof(float));
+            if (nb_objs)
+              keys[i].append(reinterpret_cast<const char*>(&pop[i]->fit().objs()[0]),
+                             nb_objs * sizeof(float));
+            if (with_indivs) {
+              save_indiv(*pop[i], indivs[i]);
+              keys[i] += indivs[i];
+            }
+          }
+          bool is_delta = _history && _history->delta_due(gen, row_bytes);
+          if (is_delta) {
+            _header.kind = delta;
+            _header.parent_gen = _history->gen();
+            _sources.resize(pop.size());
+            _genomes.clear();
+            _indivs.clear();
+            for (size_t i = 0; i < pop.size(); ++i) {
+              const char* row = &genomes[i * row_bytes];
+              _sources[i] = _history->row(keys[i]);
+              if (_sources[i] == no_blob) {
+                _genomes.insert(_genomes.end(), row, row + row_bytes);
+                if (with_indivs)
+                  _indivs.push_back(indivs[i]);
+              }
+            }
+          } else {
+            _genomes = genomes;
+            _indivs = indivs;
+          }
+          _header.nb_genomes = _genomes.size() / std::max(row_bytes, (size_t)1);
+          if (_history)
+            _history->update(gen, is_delta, keys, row_bytes);
+          _blobs.push_back(std::string());
+          return true;
+        }
+        // writes the checkpoint to out
+        void finish(std::string& out) {
+          _header.nb_blobs = _blobs.size();
+          size_t offset = _align(sizeof(header_t) + _blobs.size() * sizeof(blob_t));
+          _header.genomes = offset;
+          offset = _align(offset + _genomes.size());
+          _header.values = offset;
+          offset = _align(offset + _values.size() * sizeof(float));
+          _header.objs = offset;
+          offset = _align(offset + _objs.size() * sizeof(float));
+          if (_header.kind == delta) {
+            _header.sources = offset;
+            offset = _align(offset + _sources.size() * sizeof(uint32_t));
+          }
+          _header.indivs = offset;
+          offset += _indivs.size() * sizeof(blob_t);
+          std::vector<blob_t> table(_blobs.size());
+          for (size_t i = 0; i < _blobs.size(); ++i) {
+            table[i].offset = offset;
+            table[i].size = _blobs[i].size();
+            offset += _blobs[i].size();
+          }
+          std::vector<blob_t> indiv_table(_indivs.size());
+          for (size_t i = 0; i < _indivs.size(); ++i) {
+            indiv_table[i].offset = offset;
+            indiv_table[i].size = _indivs[i].size();
+            offset += _indivs[i].size();
+          }
+          out.clear();
+          out.reserve(offset);
+          out.append(reinterpret_cast<const char*>(&_header), sizeof(header_t));
+          if (!table.empty())
+            out.append(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(blob_t));
+          _append(out, _header.genomes, _genomes.data(), _genomes.size());
+          _append(out, _header.values, _values.data(), _values.size() * sizeof(float));
+          _append(out, _header.objs, _objs.data(), _objs.size() * sizeof(float));
+          if (_header.kind == delta)
+            _append(out, _header.sources, _sources.data(), _sources.size() * sizeof(uint32_t));
+          _append(out, _header.indivs, indiv_table.data(), indiv_table.size() * sizeof(blob_t));
+          for (size_t i = 0; i < _blobs.size(); ++i)
+            _append(out, table[i].offset, _blobs[i].data(), _blobs[i].size());
+          for (size_t i = 0; i < _indivs.size(); ++i)
+            _append(out, indiv_table[i].offset, _indivs[i].data(), _indivs[i].size());
+          assert(out.size() == offset);
+        }
+       protected:
+        static void _append(std::string& out, size_t offset, const void* data, size_t n) {
+          assert(out.size() <= offset);
+          out.resize(offset, '\0');
+          if (n)
+            out.append(static_cast<const char*>(data), n);
+        }
+        History* _history;
+        header_t _header;
+        std::vector<std::string> _blobs, _indivs;
+        std::vector<char> _genomes;
+        std::vector<float> _values, _objs;
+        std::vector<uint32_t> _sources;
+      };
+
+      // a checkpoint mapped in memory: the genomes, the values and the
+      // objectives are read in place (no copy, no deserialization)
+      class Mapped {
+       public:
+        Mapped(const std::string& fname) : _fname(fname), _data(0), _size(0) {
+          int fd = ::open(fname.c_str(), O_RDONLY);
+          if (fd < 0)
+            throw std::runtime_error("cannot open " + fname);
+          struct ::stat st;
+          if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(header_t)) {
+            ::close(fd);
+            throw std::runtime_error(fname + " is not a checkpoint");
+          }
+          _size = st.st_size;
+          void* p = ::mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+          ::close(fd);
+          if (p == MAP_FAILED)
+            throw std::runtime_error("cannot map " + fname);
+          _data = static_cast<const char*>(p);
+          _check(fname);
+        }
+        ~Mapped() {
+          if (_data)
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+        Mapped(const Mapped&) = delete;
+        Mapped& operator=(const Mapped&) = delete;
+
+        const header_t& header() const {
+          return _header;
+        }
+        size_t gen() const {
+          return header().gen;
+        }
+        size_t pop_size() const {
+          return header().pop_size;
+        }
+        size_t genome_size() const {
+          return header().genome_size;
+        }
+        size_t nb_objs() const {
+          return header().nb_objs;
+        }
+        size_t nb_blobs() const {
+          return header().nb_blobs;
+        }
+        // the stat stored in the matrices (or no_blob)
+        size_t pop_blob() const {
+          return header().pop_blob;
+        }
+        bool is_delta() const {
+          return header().kind == delta;
+        }
+        bool has_seed() const {
+          return header().flags & checkpoint::has_seed;
+        }
+        // the individuals are also stored as boost archives (see indivs)
+        bool has_indivs() const {
+          return header().flags & checkpoint::has_indivs;
+        }
+        uint64_t seed() const {
+          return header().seed;
+        }
+        // the checkpoint of which this one is a delta
+        size_t parent_gen() const {
+          return header().parent_gen;
+        }
+        std::string parent() const {
+          size_t s = _fname.rfind('/');
+          std::string dir = s == std::string::npos ? std::string() : _fname.substr(0, s + 1);
+          return dir + "gen_" + std::to_string(parent_gen());
+        }
+        // the number of rows of the genome matrix (pop_size() if full)
+        size_t nb_genomes() const {
+          return header().nb_genomes;
+        }
+        // the i-th genome of the matrix (of the individual i if full)
+        template<typename T>
+        const T* genome(size_t i) const {
+          assert(sizeof(T) == header().scalar_size);
+          assert(i < nb_genomes());
+          return reinterpret_cast<const T*>(_data + header().genomes) + i * genome_size();
+        }
+        // (delta only) the row of each individual in the parent, or no_blob
+        const uint32_t* sources() const {
+          assert(is_delta());
+          return reinterpret_cast<const uint32_t*>(_data + header().sources);
+        }
+        float value(size_t i) const {
+          assert(i < pop_size());
+          return reinterpret_cast<const float*>(_data + header().values)[i];
+        }
+        // the objective k of all the individuals
+        const float* objs(size_t k) const {
+          assert(k < nb_objs());
+          return reinterpret_cast<const float*>(_data + header().objs) + k * pop_size();
+        }
+        const char* blob(size_t i) const {
+          return _data + _table()[i].offset;
+        }
+        size_t blob_size(size_t i) const {
+          return _table()[i].size;
+        }
+        // (has_indivs only) the blob of the individual of the i-th genome
+        const char* indiv(size_t i) const {
+          assert(has_indivs() && i < nb_genomes());
+          return _data + _indiv_table()[i].offset;
+        }
+        size_t indiv_size(size_t i) const {
+          assert(has_indivs() && i < nb_genomes());
+          return _indiv_table()[i].size;
+        }
+
+        // new individuals built from the matrices (or loaded from their
+        // blobs if has_indivs()); the population of a delta is built from
+        // the population of its parent (recursively)
+        template<typename Phen>
+        void pop(std::vector<boost::shared_ptr<Phen> >& pop) const {
+          typedef gen::columns<typename Phen::gen_t> columns_t;
+          typedef typename columns_t::scalar_t scalar_t;
+          if (!columns_t::enabled || columns_t::size() != genome_size()
+              || sizeof(scalar_t) != header().scalar_size)
+            throw std::runtime_error("the genotype does not match the checkpoint");
+          std::vector<boost::shared_ptr<Phen> > parent_pop;
+          if (is_delta())
+            Mapped(parent()).pop(parent_pop);
+          std::vector<bool> used(parent_pop.size(), false);
+          pop.resize(pop_size());
+          size_t next = 0;
+          for (size_t i = 0; i < pop.size(); ++i) {
+            uint32_t src = is_delta() ? sources()[i] : no_blob;
+            if (src != no_blob) {
+              if (src >= parent_pop.size())
+                throw std::runtime_error(_fname + ": the delta does not match " + parent());
+              // two individuals of the population may be the same
+              if (used[src])
+                pop[i] = misc::Pool<Phen>::create(static_cast<const Phen&>(*parent_pop[src]));
+              else
+                pop[i] = parent_pop[src];
+              used[src] = true;
+            } else {
+              if (next >= nb_genomes())
+                throw std::runtime_error(_fname + ": corrupted delta");
+              pop[i] = misc::Pool<Phen>::create();
+              if (has_indivs())
+                load_indiv(indiv(next), indiv_size(next), *pop[i]);
+              else {
+                columns_t::set(pop[i]->gen(), genome<scalar_t>(next));
+                pop[i]->fit().set_value(value(i));
+                pop[i]->fit().resize_obj(nb_objs());
+                for (size_t k = 0; k < nb_objs(); ++k)
+                  pop[i]->fit().set_obj(k, objs(k)[i]);
+              }
+              ++next;
+            }
+          }
+          if (next != nb_genomes())
+            throw std::runtime_error(_fname + ": corrupted delta");
+        }
+
+       protected:
+        const blob_t* _table() const {
+          return reinterpret_cast<const blob_t*>(_data + _header.header_size);
+        }
+        const blob_t* _indiv_table() const {
+          return reinterpret_cast<const blob_t*>(_data + _header.indivs);
+        }
+        void _check(const std::string& fname) {
+          header_t& h = _header;
+          memcpy(&h, _data, sizeof(header_t));
+          if (memcmp(h.magic, magic, sizeof(magic)) != 0)
+            throw std::runtime_error(fname + " is not a checkpoint");
+          if (h.version != version || h.header_size != sizeof(header_t))
+            throw std::runtime_error(fname + ": unsupported checkpoint version");
+          bool ok = h.header_size + h.nb_blobs * sizeof(blob_t) <= _size
+                    && h.genomes + h.nb_genomes * h.genome_size * h.scalar_size <= _size
+                    && h.values + h.pop_size * sizeof(float) <= _size
+                    && h.objs + h.pop_size * h.nb_objs * sizeof(float) <= _size
+                    && (!(h.flags & checkpoint::has_indivs)
+                        || h.indivs + h.nb_genomes * sizeof(blob_t) <= _size)
+                    && (h.pop_blob == no_blob || h.pop_blob < h.nb_blobs);
+          if (h.kind == delta)
+            ok = ok && h.parent_gen < h.gen
+                 && h.sources + h.pop_size * sizeof(uint32_t) <= _size;
+          else
+            ok = ok && h.kind == full && h.nb_genomes == h.pop_size;
+          for (size_t i = 0; ok && i < h.nb_blobs; ++i)
+            ok = _table()[i].offset + _table()[i].size <= _size;
+          for (size_t i = 0; ok && (h.flags & checkpoint::has_indivs) && i < h.nb_genomes; ++i)
+            ok = _indiv_table()[i].offset + _indiv_table()[i].size <= _size;
+          if (!ok)
+            throw std::runtime_error(fname + ": truncated checkpoint");
+        }
+        std::string _fname;
+        header_t _header;
+        const char* _data;
+        size_t _size;
+      };
+    }
+  }
+}
+
+#endif
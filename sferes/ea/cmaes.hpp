@@ -41,6 +41,7 @@
 #include <sferes/ea/ea.hpp>
 #include <sferes/fit/fitness.hpp>
 #include <sferes/parallel.hpp>
+#include <sferes/misc/pool.hpp>
 #include "cmaes_interface.h"
 
 namespace sferes {
@@ -60,7 +61,7 @@ namespace sferes {
         // we don't really need the random here
         this->_pop.resize(_lambda);
         BOOST_FOREACH(boost::shared_ptr<Phen>&indiv, this->_pop) {
-          indiv = boost::shared_ptr<Phen>(new Phen());
+          indiv = misc::Pool<Phen>::create();
         }
       }
       void epoch() {
@@ -37,18 +37,32 @@
 
 #ifndef COMMON_HPP_
 #define COMMON_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <sferes/parallel.hpp>
+#include <sferes/misc/pool.hpp>
+#include <sferes/misc/rand.hpp>
+#include <sferes/gen/batch.hpp>
+
 namespace sferes {
   namespace ea {
 
+    // the functors are built in the serial code: each of them takes a new
+    // random stream, and individual i draws its numbers from (stream, i)
+    // so that the result does not depend on the scheduling (see misc/rand.hpp)
     template<typename Phen>
     struct random {
       std::vector<boost::shared_ptr<Phen> >& _pop;
+      uint32_t _stream;
       ~random() { }
-      random(std::vector<boost::shared_ptr<Phen> >& pop) : _pop(pop) {}
-      random(const random& ev) : _pop(ev._pop) {}
+      random(std::vector<boost::shared_ptr<Phen> >& pop) :
+        _pop(pop), _stream(misc::rand_stream()) {}
+      random(const random& ev) : _pop(ev._pop), _stream(ev._stream) {}
       void operator() (const parallel::range_t& r) const {
         for (size_t i = r.begin(); i != r.end(); ++i) {
-          _pop[i] = boost::shared_ptr<Phen>(new Phen());
+          misc::rand_scope scope(_stream, i);
+          _pop[i] = misc::Pool<Phen>::create();
           _pop[i]->random();
         }
       }
@@ -57,16 +71,96 @@ namespace sferes {
     template<typename Phen>
     struct mutate {
       std::vector<boost::shared_ptr<Phen> >& _pop;
+      uint32_t _stream;
 
       ~mutate() { }
-      mutate(std::vector<boost::shared_ptr<Phen> >& pop) : _pop(pop) {}
-      mutate(const mutate& ev) : _pop(ev._pop) {}
+      mutate(std::vector<boost::shared_ptr<Phen> >& pop) :
+        _pop(pop), _stream(misc::rand_stream()) {}
+      mutate(const mutate& ev) : _pop(ev._pop), _stream(ev._stream) {}
       void operator() (const parallel::range_t& r) const {
-        for (size_t i = r.begin(); i != r.end(); ++i)
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          misc::rand_scope scope(_stream, i);
           _pop[i]->mutate();
+        }
+      }
+    };
+
+
+    // batch versions (see gen::batch): each task mutates / crosses blocks
+    // of block_size consecutive genotypes at once; the range is a range
+    // of blocks (see batch_nb_blocks()), and block k draws from (stream, k)
+    SFERES_CONST size_t batch_block_size = 64;
+    inline size_t batch_nb_blocks(size_t n) {
+      return (n + batch_block_size - 1) / batch_block_size;
+    }
+
+    template<typename Gen>
+    struct batch_mutate {
+      const std::vector<Gen*>& _gens;
+      uint32_t _stream;
+      ~batch_mutate() { }
+      batch_mutate(const std::vector<Gen*>& gens) :
+        _gens(gens), _stream(misc::rand_stream()) {}
+      batch_mutate(const batch_mutate& ev) : _gens(ev._gens), _stream(ev._stream) {}
+      void operator() (const parallel::range_t& r) const {
+        for (size_t k = r.begin(); k != r.end(); ++k) {
+          misc::rand_scope scope(_stream, k);
+          size_t b = k * batch_block_size;
+          size_t n = std::min(batch_block_size, _gens.size() - b);
+          gen::batch<Gen>::mutate(&_gens[b], n);
+        }
       }
     };
 
+    // (p1[i], p2[i]) -> (c1[i], c2[i])
+    template<typename Gen>
+    struct batch_cross {
+      const std::vector<Gen*>& _p1, & _p2, & _c1, & _c2;
+      uint32_t _stream;
+      ~batch_cross() { }
+      batch_cross(const std::vector<Gen*>& p1, const std::vector<Gen*>& p2,
+                  const std::vector<Gen*>& c1, const std::vector<Gen*>& c2) :
+        _p1(p1), _p2(p2), _c1(c1), _c2(c2), _stream(misc::rand_stream()) {}
+      batch_cross(const batch_cross& ev) :
+        _p1(ev._p1), _p2(ev._p2), _c1(ev._c1), _c2(ev._c2), _stream(ev._stream) {}
+      void operator() (const parallel::range_t& r) const {
+        for (size_t k = r.begin(); k != r.end(); ++k) {
+          misc::rand_scope scope(_stream, k);
+          size_t b = k * batch_block_size;
+          size_t n = std::min(batch_block_size, _p1.size() - b);
+          gen::batch<Gen>::cross(&_p1[b], &_p2[b], &_c1[b], &_c2[b], n);
+        }
+      }
+    };
+
+
+    // a random permutation of [0, size), computed in parallel: each index
+    // gets a random key drawn from (stream, index), then the indices are
+    // sorted by key (the same permutation for any number of threads)
+    struct _perm_keys {
+      std::vector<uint64_t>& _keys;
+      uint32_t _stream;
+      ~_perm_keys() { }
+      _perm_keys(std::vector<uint64_t>& keys) : _keys(keys), _stream(misc::rand_stream()) {}
+      _perm_keys(const _perm_keys& ev) : _keys(ev._keys), _stream(ev._stream) {}
+      void operator() (const parallel::range_t& r) const {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          misc::rand_scope scope(_stream, i);
+          _keys[i] = ((uint64_t)misc::rand<uint32_t>(0, 0xFFFFFFFFu) << 32) | i;
+        }
+      }
+    };
+    // keys is a buffer (to be reused from one call to the next)
+    inline void rand_perm(std::vector<size_t>& a, size_t size, std::vector<uint64_t>& keys) {
+      // the index is in the low bits of the key, so that the keys are unique
+      assert(size <= 0xFFFFFFFFu);
+      keys.resize(size);
+      parallel::p_for(parallel::range_t(0, size), _perm_keys(keys));
+      parallel::sort(keys.begin(), keys.end(), std::less<uint64_t>());
+      a.resize(size);
+      for (size_t i = 0; i < size; ++i)
+        a[i] = keys[i] & 0xFFFFFFFFu;
+    }
   }
 }
 #endif
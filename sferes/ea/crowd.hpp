@@ -36,13 +36,92 @@
 #ifndef   	CROWD_H_
 # define   	CROWD_H_
 
+#include <algorithm>
+#include <limits>
+#include <vector>
 #include <sferes/parallel.hpp>
+#include <sferes/misc/pool.hpp>
+#include <sferes/fit/obj_matrix.hpp>
+#include <sferes/ea/fronts.hpp>
 
 namespace sferes {
   namespace ea {
     namespace crowd {
       SFERES_CONST float inf = 1.0e14;
 
+      // crowding distance (Deb, p248) of the individuals of the front
+      // [fb, fe) (indices in objs), written to crowd[i] for each i in the front
+      // (sorted is a scratch vector)
+      inline void crowding_distance(const fit::ObjMatrix& objs,
+                                    const size_t* fb, const size_t* fe,
+                                    std::vector<float>& crowd,
+                                    std::vector<size_t>& sorted) {
+        assert(fe > fb);
+        assert(crowd.size() == objs.size());
+        const size_t* f = fb;
+        const size_t size = fe - fb;
+        if (size <= 2) {
+          for (size_t j = 0; j < size; ++j)
+            crowd[f[j]] = crowd::inf;
+          return;
+        }
+        // C1
+        for (size_t j = 0; j < size; ++j)
+          crowd[f[j]] = 0.0f;
+        sorted.assign(fb, fe);
+
+        // C2 + C3
+        // for each obj
+        for (size_t k = 0; k < objs.nb_objs(); ++k) {
+          const float* o = objs.col(k);
+          // sort in order of f_m (best first)
+          std::sort(sorted.begin(), sorted.end(), fit::compare_rows_obj(objs, k));
+          const float fmax = o[sorted.front()];
+          const float fmin = o[sorted.back()];
+          assert(!std::isinf(fmin));
+          assert(!std::isinf(fmax));
+          assert(fmin <= fmax);
+
+          // assign
+          crowd[sorted.front()] = crowd::inf;
+          crowd[sorted.back()] = crowd::inf;
+          if (fmax - fmin == 0)
+            continue;
+          const float range = fmax - fmin;
+          for (size_t j = 1; j < sorted.size() - 1; ++j) {
+            float d = (o[sorted[j - 1]] - o[sorted[j + 1]]) / range;
+            assert(d >= 0);
+            assert(!std::isnan(d));
+            assert(!std::isinf(d));
+            crowd[sorted[j]] += d;
+          }
+        }
+      }
+
+      // crowding distance of the fronts r.begin() ... r.end() - 1
+      // (fronts of indices in objs); each task sorts its own index
+      // permutations, without nested parallel sorts
+      class crowd_fronts {
+       public:
+        const fit::ObjMatrix& _objs;
+        const Fronts& _fronts;
+        std::vector<float>& _crowd;
+
+        ~crowd_fronts() { }
+        crowd_fronts(const fit::ObjMatrix& objs,
+                     const Fronts& fronts,
+                     std::vector<float>& crowd) :
+          _objs(objs), _fronts(fronts), _crowd(crowd) {}
+        crowd_fronts(const crowd_fronts& ev) :
+          _objs(ev._objs), _fronts(ev._fronts), _crowd(ev._crowd) {}
+        void operator() (const parallel::range_t& r) const {
+          std::vector<size_t> sorted;
+          for (size_t i = r.begin(); i != r.end(); ++i)
+            crowding_distance(_objs, _fronts.begin(i), _fronts.end(i), _crowd, sorted);
+        }
+      };
+
+      // crowding distance for fronts of individuals
       template<typename Indiv>
       class assign_crowd {
        public:
@@ -57,105 +136,18 @@ namespace sferes {
             _assign_crowd(_fronts[i]);
         }
        protected:
-        typedef typename std::vector<Indiv>::iterator it_t;
-        typedef typename std::vector<Indiv>::const_iterator cit_t;
-
-        void _fmin_max(const std::vector<Indiv>& f,
-                       std::vector<float>& fmin,
-                       std::vector<float>& fmax) const {
-          assert(f.size());
-          size_t nb_objs = f[0]->fit().objs().size();
-          assert(nb_objs);
-          fmin.resize(nb_objs);
-          fmax.resize(nb_objs);
-          for (unsigned i = 0; i < nb_objs; ++i) {
-            float mi = std::numeric_limits<float>::max();
-            float ma = -std::numeric_limits<float>::max();
-            for (cit_t it = f.begin(); it != f.end(); ++it) {
-              float o = (*it)->fit().obj(i);
-              assert(!std::isnan(o));
-              assert(!std::isnan(i));
-              assert(!std::isinf(o));
-              assert(!std::isinf(i));
-
-              if (o < mi)
-                mi = o;
-              if (o > ma)
-                ma = o;
-            }
-            fmin[i] = mi;
-            fmax[i] = ma;
-            assert(fmin[i] <= fmax[i]);
-          }
-        }
-
-        /// Deb, p248
-        /// /!\ end not included (like any stl algo)
         void _assign_crowd(std::vector<Indiv>& f) const {
-
-#ifndef NDEBUG
-          BOOST_FOREACH(Indiv& ind, f)
-          for (size_t i = 0; i < ind->fit().objs().size(); ++i) {
-            assert(!std::isnan(ind->fit().obj(i)));
-          }
-#endif
-
-
-          if (f.size() == 1) {
-            f[0]->set_crowd(crowd::inf);
-            return;
-          }
-          if (f.size() == 2) {
-            f[0]->set_crowd(crowd::inf);
-            f[1]->set_crowd(crowd::inf);
-          }
-
-          size_t nb_objs = f[0]->fit().objs().size();
-
-          // C1
-          BOOST_FOREACH(Indiv& i, f)
-          i->set_crowd(0.0f);
-
-          std::vector<float> fmin, fmax;
-          _fmin_max(f, fmin, fmax);
-
-          // C2 + C3
-          // for each obj
-          for (size_t i = 0; i < nb_objs; ++i) {
-            // sort in order of f_m (best first)
-            parallel::sort(f.begin(), f.end(), fit::compare_obj(i));
-            assert(!std::isnan(f[0]->fit().obj(i)));
-            assert(!std::isinf(f[0]->fit().obj(i)));
-            assert(!std::isnan(f[1]->fit().obj(i)));
-            assert(!std::isinf(f[1]->fit().obj(i)));
-            assert(f[0]->fit().obj(i) >= f[1]->fit().obj(i));
-
-            // assign
-            f[0]->set_crowd(crowd::inf);
-            f[f.size() - 1]->set_crowd(crowd::inf);
-
-            for (it_t it = f.begin() + 1; it != f.end() - 1; ++it) {
-              assert(i < fmin.size());
-              assert(i < fmax.size());
-              assert(!std::isnan(fmax[i]));
-              assert(!std::isinf(fmax[i]));
-              assert(!std::isnan(fmin[i]));
-              assert(!std::isinf(fmin[i]));
-              float f = (*(it - 1))->fit().obj(i) - (*(it + 1))->fit().obj(i);
-              assert(fmax[i] - fmin[i] >= 0);
-              assert(f >= 0);
-              if (fmax[i] - fmin[i] != 0)
-                f /= fmax[i] - fmin[i];
-              else
-                f = 0.0f;
-              assert(!std::isnan(f));
-              assert(!std::isinf(f));
-              assert(f >= 0);
-              (*it)->set_crowd((*it)->crowd() + f);
-            }
-          }
+          assert(f.size());
+          fit::ObjMatrix objs;
+          objs.snapshot(f);
+          std::vector<size_t> idx(f.size()), sorted;
+          for (size_t i = 0; i < idx.size(); ++i)
+            idx[i] = i;
+          std::vector<float> crowd(f.size());
+          crowding_distance(objs, &idx[0], &idx[0] + idx.size(), crowd, sorted);
+          for (size_t i = 0; i < f.size(); ++i)
+            f[i]->set_crowd(crowd[i]);
         }
-
       };
 
       struct compare_crowd {
@@ -165,6 +157,15 @@ namespace sferes {
         }
       };
 
+      // same, for indices in a vector of crowding distances
+      struct compare_crowd_idx {
+        const std::vector<float>& crowd;
+        compare_crowd_idx(const std::vector<float>& c) : crowd(c) {}
+        bool operator()(size_t i1, size_t i2) const {
+          return crowd[i1] > crowd[i2];
+        }
+      };
+
       struct compare_ranks {
         template<typename I>
         bool operator()(const boost::shared_ptr<I> i1, const boost::shared_ptr<I> i2) const {
@@ -197,9 +198,9 @@ namespace sferes {
                    boost::shared_ptr<Indiv>& o2) {
           assert(i2);
           if (!o1)
-            o1 = boost::shared_ptr<Indiv>(new Indiv());
+            o1 = misc::Pool<Indiv>::create();
           if (!o2)
-            o2 = boost::shared_ptr<Indiv>(new Indiv());
+            o2 = misc::Pool<Indiv>::create();
           this->_gen.cross(i2->gen(), o1->gen(), o2->gen());
 #ifdef TRACK_FIT
 #warning track fit is enabled
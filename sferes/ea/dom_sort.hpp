@@ -38,46 +38,139 @@
 #ifndef DOM_SORT_HPP
 #define DOM_SORT_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <boost/foreach.hpp>
 #include <sferes/eval/parallel.hpp>
+#include <sferes/fit/obj_matrix.hpp>
+#include <sferes/fit/dominate_block.hpp>
+#include <sferes/ea/fronts.hpp>
 //#warning NEW algorithm for NSGA-2 (2 objectives)-> define SFERES_FAST_DOMSORT !
 namespace sferes {
   namespace ea {
     namespace _dom_sort {
-      template<typename Phen>
+      // n[p] (the number of individuals that dominate p) and s[p] (the
+      // individuals dominated by p); rows is the scratch memory for the
+      // objectives of the individuals (nb_objs() floats per individual)
       struct count_dom {
-        const std::vector<Phen>& pop;
-        std::vector<size_t>& n;
+        const fit::ObjMatrix& objs;
+        std::atomic<size_t>* n;
         std::vector<std::vector<size_t> >& s;
         std::vector<size_t>& r;
+        float* rows;
 
         ~count_dom() { }
-        count_dom(const std::vector<Phen>& pop_,
-                  std::vector<size_t>& n_,
+        count_dom(const fit::ObjMatrix& objs_,
+                  std::atomic<size_t>* n_,
                   std::vector<std::vector<size_t> >& s_,
-                  std::vector<size_t>& r_) :
-          pop(pop_), n(n_), s(s_), r(r_) {
+                  std::vector<size_t>& r_,
+                  float* rows_) :
+          objs(objs_), n(n_), s(s_), r(r_), rows(rows_) {
         }
         count_dom(const count_dom& ev) :
-          pop(ev.pop), n(ev.n), s(ev.s), r(ev.r) {}
+          objs(ev.objs), n(ev.n), s(ev.s), r(ev.r), rows(ev.rows) {}
         void operator() (const parallel::range_t& range) const {
-          assert(n.size() == pop.size());
-          assert(s.size() == pop.size());
+          assert(s.size() == objs.size());
+          const size_t nb_objs = objs.nb_objs();
           for (size_t p = range.begin(); p != range.end(); ++p) {
-            assert(s[p].empty());
-            n[p] = 0;
-            for (size_t q = 0; q < pop.size(); ++q) {
-              int flag = fit::dominate_flag(pop[p], pop[q]);
-              if (flag > 0)
-                s[p].push_back(q);
-              else if (flag < 0)
-                ++n[p];
+            s[p].clear();
+            float* o = rows + p * nb_objs;
+            for (size_t k = 0; k < nb_objs; ++k)
+              o[k] = objs(p, k);
+            size_t nb_dominating = 0;
+            for (size_t b = 0; b < objs.size(); b += fit::ObjMatrix::block_size) {
+              unsigned dominating, dominated;
+              fit::dominate_block(o, objs, b, dominating, dominated);
+              nb_dominating += __builtin_popcount(dominated);
+              for (; dominating; dominating &= dominating - 1)
+                s[p].push_back(b + __builtin_ctz(dominating));
             }
-            if (n[p] == 0)
+            n[p].store(nb_dominating, std::memory_order_relaxed);
+            if (nb_dominating == 0)
               r[p] = 0;
           }
         }
       };
 
+      // copy the fronts of indices to fronts of individuals
+      template<typename Indiv>
+      inline void copy_fronts(const std::vector<Indiv>& pop,
+                              const Fronts& f,
+                              std::vector<std::vector<Indiv> >& fronts) {
+        fronts.clear();
+        fronts.resize(f.size());
+        for (size_t i = 0; i < f.size(); ++i)
+          for (const size_t* it = f.begin(i); it != f.end(i); ++it)
+            fronts[i].push_back(pop[*it]);
+      }
+
+      // scratch memory of sort_deb (kept from one call to the next)
+      struct deb_buffer_t {
+        // s[p] : individuals dominated by p
+        std::vector<std::vector<size_t> > s;
+        // n[p] : number of individuals that dominate p (decremented by
+        // several threads when the fronts are peeled)
+        std::vector<std::atomic<size_t> > n;
+        // objectives of each individual, contiguous (see count_dom)
+        std::vector<float> rows;
+
+        deb_buffer_t() {}
+        // (a copy does not need the scratch memory)
+        deb_buffer_t(const deb_buffer_t&) {}
+        deb_buffer_t& operator=(const deb_buffer_t&) {
+          return *this;
+        }
+        void resize(size_t size, size_t nb_objs) {
+          s.resize(size);
+          // (atomics cannot be moved, so n only grows, by reallocation)
+          if (n.size() < size)
+            std::vector<std::atomic<size_t> >(size).swap(n);
+          if (rows.size() < size * nb_objs)
+            rows.resize(size * nb_objs);
+        }
+      };
+
+      // remove the individuals of the front [front + r.begin(), front + r.end())
+      // from the domination counts; the individuals that are no longer
+      // dominated are appended (in any order) to next
+      struct peel_front {
+        const std::vector<std::vector<size_t> >& s;
+        std::atomic<size_t>* n;
+        std::vector<size_t>& ranks;
+        const size_t* front;
+        size_t* next;
+        std::atomic<size_t>& next_size;
+        size_t rank;
+
+        ~peel_front() { }
+        peel_front(const std::vector<std::vector<size_t> >& s_,
+                   std::atomic<size_t>* n_,
+                   std::vector<size_t>& ranks_,
+                   const size_t* front_, size_t* next_,
+                   std::atomic<size_t>& next_size_, size_t rank_) :
+          s(s_), n(n_), ranks(ranks_), front(front_), next(next_),
+          next_size(next_size_), rank(rank_) {
+        }
+        peel_front(const peel_front& ev) :
+          s(ev.s), n(ev.n), ranks(ev.ranks), front(ev.front), next(ev.next),
+          next_size(ev.next_size), rank(ev.rank) {}
+        void operator() (const parallel::range_t& range) const {
+          for (size_t pp = range.begin(); pp != range.end(); ++pp) {
+            size_t p = front[pp];
+            for (size_t k = 0; k < s[p].size(); ++k) {
+              size_t q = s[p][k];
+              assert(q != p);
+              size_t nq = n[q].fetch_sub(1);
+              assert(nq != 0);
+              if (nq == 1) {
+                ranks[q] = rank;
+                next[next_size.fetch_add(1)] = q;
+              }
+            }
+          }
+        }
+      };
 
       // cf deb's paper on NSGA-2 :
       /// @article{deb2002nsga,
@@ -89,78 +182,69 @@ namespace sferes {
       //  year={2002}
       // }
       // this algorithm is in O(n^2)
-      template<typename Indiv>
-      inline void sort_deb(const std::vector<Indiv>& pop,
-                           std::vector<std::vector<Indiv> >& fronts,
+      // both steps are parallel; each front is sorted by increasing index
+      inline void sort_deb(const fit::ObjMatrix& objs,
+                           deb_buffer_t& buffer,
+                           Fronts& fronts,
                            std::vector<size_t>& ranks) {
-        assert(!pop.empty());
-        std::vector<std::vector<size_t> > s(pop.size());
-        std::vector<std::vector<size_t> > f(1);
-        std::vector<size_t> n(pop.size());
-        ranks.resize(pop.size());
+        assert(objs.size());
+        const size_t size = objs.size();
+        buffer.resize(size, objs.nb_objs());
+        std::vector<std::vector<size_t> >& s = buffer.s;
+        std::atomic<size_t>* n = &buffer.n[0];
+        ranks.resize(size);
+
+        std::fill(ranks.begin(), ranks.end(), size);
 
-        std::fill(ranks.begin(), ranks.end(), pop.size());
+        parallel::p_for(parallel::range_t(0, size),
+                        _dom_sort::count_dom(objs, n, s, ranks, &buffer.rows[0]));
 
 #ifndef NDEBUG
-        BOOST_FOREACH(const Indiv& ind, pop)
-        for (size_t i = 0; i < ind->fit().objs().size(); ++i) {
-          assert(!std::isnan(ind->fit().objs()[i]));
-        }
+        for (size_t i = 0; i < size; ++i)
+          assert(n[i] < size);
 #endif
-
-        parallel::p_for(parallel::range_t(0, pop.size()),
-                        _dom_sort::count_dom<Indiv>(pop, n, s, ranks));
-
-        for (size_t i = 0; i < pop.size(); ++i)
+        fronts.clear(size);
+        size_t* idx = fronts.data();
+        size_t e = 0;
+        for (size_t i = 0; i < size; ++i)
           if (ranks[i] == 0)
-            f[0].push_back(i);
+            idx[e++] = i;
+        assert(e != 0);
+        fronts.add_front(e);
 
-#ifndef NDEBUG
-        BOOST_FOREACH(size_t k, n) {
-          assert(k < pop.size());
-        }
-
-#endif
-        assert(!f[0].empty());
         // second step : make layers
-        size_t i = 0;
-        while (!f[i].empty()) {
-          f.push_back(std::vector<size_t>());
-          for (size_t pp = 0; pp < f[i].size(); ++pp) {
-            size_t p = f[i][pp];
-            for (size_t k = 0; k < s[p].size(); ++k) {
-              size_t q = s[p][k];
-              assert(q != p);
-              assert(n[q] != 0);
-              --n[q];
-              if (n[q] == 0) {
-                ranks[q] = i + 1;
-                f.back().push_back(q);
-              }
-            }
-          }
-          ++i;
-          assert(i < f.size());
+        size_t b = 0;
+        while (e != size) {
+          std::atomic<size_t> next_size(0);
+          parallel::p_for(parallel::range_t(b, e),
+                          peel_front(s, n, ranks, idx, idx + e,
+                                     next_size, fronts.size()));
+          assert(next_size != 0);
+          std::sort(idx + e, idx + e + next_size);
+          b = e;
+          e += next_size;
+          fronts.add_front(e);
         }
+        assert(fronts.nb_indivs() == size);
+      }
 
-#ifndef NDEBUG
-        size_t size = 0;
-        BOOST_FOREACH(std::vector<size_t>& v, f)
-        size += v.size();
-        assert(size == pop.size());
-#endif
-
-        // copy indivs to the res
-        fronts.clear();
-        fronts.resize(f.size());
-        for (unsigned i = 0; i < f.size(); ++i)
-          for (unsigned j = 0; j < f[i].size(); ++j)
-            fronts[i].push_back(pop[f[i][j]]);
+      inline void sort_deb(const fit::ObjMatrix& objs,
+                           Fronts& fronts,
+                           std::vector<size_t>& ranks) {
+        deb_buffer_t buffer;
+        sort_deb(objs, buffer, fronts, ranks);
+      }
 
-        assert(fronts.back().size() == 0);
-        fronts.pop_back();
-        assert(!fronts.empty());
-        assert(!fronts[0].empty());
+      template<typename Indiv>
+      inline void sort_deb(const std::vector<Indiv>& pop,
+                           std::vector<std::vector<Indiv> >& fronts,
+                           std::vector<size_t>& ranks) {
+        assert(!pop.empty());
+        fit::ObjMatrix objs;
+        objs.snapshot(pop);
+        Fronts f;
+        sort_deb(objs, f, ranks);
+        copy_fronts(pop, f, fronts);
       }
 
       template<typename T>
@@ -170,59 +254,220 @@ namespace sferes {
         return v;
       }
 
-      struct _comp_fronts {
-        // this functor is ONLY for dom_sort_fast2
-        template<typename T>
-        bool operator()(const T& f2, const T& f1) {
-          assert(f1.size() == 1);
-          assert(f1[0]->fit().objs().size() == 2);
-          // we only need to compare f1 to the value of the last element of f2
-          if (f1[0]->fit().obj(1) < f2.back()->fit().obj(1))
-            return true;
-          else
-            return false;
-        }
-      };
-
       // see M. T. Jensen, 2003
-      template<typename Indiv>
-      inline void sort_2objs(const std::vector<Indiv>& pop,
-                             std::vector<std::vector<Indiv> > & f,
+      inline void sort_2objs(const fit::ObjMatrix& objs,
+                             Fronts& fronts,
                              std::vector<size_t>& ranks) {
-        std::vector<Indiv> p = pop;
-        parallel::sort(p.begin(), p.end(), fit::compare_objs_lex());
+        assert(objs.nb_objs() == 2);
+        std::vector<std::vector<size_t> > f;
+        std::vector<size_t> p(objs.size());
+        for (size_t i = 0; i < p.size(); ++i)
+          p[i] = i;
+        std::sort(p.begin(), p.end(), fit::compare_rows_lex(objs));
+        const float* o1 = objs.col(1);
         f.push_back(new_vector(p[0]));
         size_t e = 0;
         for (size_t i = 1; i < p.size(); ++i) {
-          if (p[i]->fit().obj(1) > f[e].back()->fit().obj(1)) { // !dominate(si, f_e)
-            typename std::vector<std::vector<Indiv> >::iterator b =
-              std::lower_bound(f.begin(), f.end(), new_vector(p[i]),
-                               _comp_fronts());
-            assert(b != f.end());
-            b->push_back(p[i]);
+          if (o1[p[i]] > o1[f[e].back()]) { // !dominate(si, f_e)
+            // we only need to compare p[i] to the last element of each front
+            size_t b = 0, end = f.size();
+            while (b < end) {
+              size_t mid = (b + end) / 2;
+              if (o1[p[i]] < o1[f[mid].back()])
+                b = mid + 1;
+              else
+                end = mid;
+            }
+            assert(b != f.size());
+            f[b].push_back(p[i]);
           } else {
             ++e;
             f.push_back(new_vector(p[i]));
           }
         }
-        // assign ranks to follow the interface
-        for (size_t i = 0; i < f.size(); ++i)
+        ranks.resize(objs.size());
+        fronts.clear(objs.size());
+        for (size_t i = 0; i < f.size(); ++i) {
           for (size_t j = 0; j < f[i].size(); ++j)
-            f[i][j]->set_rank(i);
+            ranks[f[i][j]] = i;
+          fronts.push_back(f[i]);
+        }
+      }
+
+      template<typename Indiv>
+      inline void sort_2objs(const std::vector<Indiv>& pop,
+                             std::vector<std::vector<Indiv> > & fronts,
+                             std::vector<size_t>& ranks) {
+        fit::ObjMatrix objs;
+        objs.snapshot(pop);
+        Fronts f;
+        sort_2objs(objs, f, ranks);
+        copy_fronts(pop, f, fronts);
+      }
+
+      // true if one of the individuals of the front f dominates p
+      // (all the individuals of f come before p in the lexicographic order)
+      inline bool _front_dominates(const std::vector<size_t>& f, size_t p,
+                                   const fit::ObjMatrix& objs) {
+        // the last inserted individuals are the closest to p in the
+        // lexicographic order, hence the most likely to dominate it
+        for (size_t k = f.size(); k > 0; --k)
+          if (objs.dominate_flag(f[k - 1], p) == 1)
+            return true;
+        return false;
+      }
+
+      // Efficient Non-dominated Sort (ENS), see:
+      // @article{zhang2015ens,
+      //   title={An efficient approach to nondominated sorting for
+      //          evolutionary multiobjective optimization},
+      //   author={Zhang, X. and Tian, Y. and Cheng, R. and Jin, Y.},
+      //   journal={IEEE Transactions on Evolutionary Computation},
+      //   volume={19}, number={2}, year={2015}
+      // }
+      // individuals are visited in lexicographic order, so an individual can
+      // only be dominated by individuals that have already been assigned to a
+      // front; it goes to the first front that does not dominate it, found
+      // with a sequential (ENS-SS) or a binary (ENS-BS) search.
+      // O(M N^2) in the worst case, but much faster than sort_deb in practice;
+      // fronts and ranks are the same as sort_deb's (each front is sorted by
+      // increasing index)
+      inline void sort_ens(const fit::ObjMatrix& objs,
+                           Fronts& fronts,
+                           std::vector<size_t>& ranks,
+                           bool binary_search) {
+        assert(objs.size());
+        std::vector<size_t> order(objs.size());
+        for (size_t i = 0; i < order.size(); ++i)
+          order[i] = i;
+        std::sort(order.begin(), order.end(), fit::compare_rows_lex(objs));
+
+        ranks.resize(objs.size());
+        std::vector<std::vector<size_t> > f;
+        for (size_t i = 0; i < order.size(); ++i) {
+          size_t p = order[i];
+          size_t k = 0;
+          if (binary_search) {
+            size_t hi = f.size();
+            while (k < hi) {
+              size_t mid = (k + hi) / 2;
+              if (_front_dominates(f[mid], p, objs))
+                k = mid + 1;
+              else
+                hi = mid;
+            }
+          } else
+            while (k < f.size() && _front_dominates(f[k], p, objs))
+              ++k;
+          if (k == f.size())
+            f.push_back(std::vector<size_t>());
+          f[k].push_back(p);
+          ranks[p] = k;
+        }
+        fronts.clear(objs.size());
+        for (size_t i = 0; i < f.size(); ++i) {
+          std::sort(f[i].begin(), f[i].end());
+          fronts.push_back(f[i]);
+        }
+        assert(!fronts.empty());
+        assert(fronts.front_size(0));
+      }
+
+      template<typename Indiv>
+      inline void sort_ens(const std::vector<Indiv>& pop,
+                           std::vector<std::vector<Indiv> >& fronts,
+                           std::vector<size_t>& ranks,
+                           bool binary_search) {
+        assert(!pop.empty());
+        fit::ObjMatrix objs;
+        objs.snapshot(pop);
+        Fronts f;
+        sort_ens(objs, f, ranks, binary_search);
+        copy_fronts(pop, f, fronts);
       }
     }
 
-    template<typename Indiv>
-    inline void dom_sort(const std::vector<Indiv>& pop,
-                         std::vector<std::vector<Indiv> >& fronts,
+    inline void dom_sort(const fit::ObjMatrix& objs,
+                         _dom_sort::deb_buffer_t& buffer,
+                         Fronts& fronts,
                          std::vector<size_t>& ranks) {
 #ifdef SFERES_FAST_DOMSORT
-      if (pop[0]->fit().objs().size() == 2)
-        _dom_sort::sort_2objs(pop, fronts, ranks);
+      if (objs.nb_objs() == 2)
+        _dom_sort::sort_2objs(objs, fronts, ranks);
       else
 #endif
-        _dom_sort::sort_deb(pop, fronts, ranks);
+        _dom_sort::sort_deb(objs, buffer, fronts, ranks);
+    }
+
+    inline void dom_sort(const fit::ObjMatrix& objs,
+                         Fronts& fronts,
+                         std::vector<size_t>& ranks) {
+      _dom_sort::deb_buffer_t buffer;
+      dom_sort(objs, buffer, fronts, ranks);
     }
+
+    template<typename Indiv>
+    inline void dom_sort(const std::vector<Indiv>& pop,
+                         std::vector<std::vector<Indiv> >& fronts,
+                         std::vector<size_t>& ranks) {
+      assert(!pop.empty());
+      fit::ObjMatrix objs;
+      objs.snapshot(pop);
+      Fronts f;
+      dom_sort(objs, f, ranks);
+      _dom_sort::copy_fronts(pop, f, fronts);
+    }
+
+    // sorting policies (see GenericNsga2); each of them can sort either
+    // a population or an ObjMatrix (fronts of indices)
+    // default: Deb's algorithm (or Jensen's for 2 objectives if
+    // SFERES_FAST_DOMSORT is defined); the scratch memory is kept in the
+    // policy object, so that the EA does not allocate at each generation
+    struct dom_sort_f {
+      template<typename Indiv>
+      void operator()(const std::vector<Indiv>& pop,
+                      std::vector<std::vector<Indiv> >& fronts,
+                      std::vector<size_t>& ranks) const {
+        dom_sort(pop, fronts, ranks);
+      }
+      void operator()(const fit::ObjMatrix& objs,
+                      Fronts& fronts,
+                      std::vector<size_t>& ranks) {
+        dom_sort(objs, _buffer, fronts, ranks);
+      }
+     protected:
+      _dom_sort::deb_buffer_t _buffer;
+    };
+
+    // ENS with sequential search (best when there are few fronts)
+    struct dom_sort_ens_ss_f {
+      template<typename Indiv>
+      void operator()(const std::vector<Indiv>& pop,
+                      std::vector<std::vector<Indiv> >& fronts,
+                      std::vector<size_t>& ranks) const {
+        _dom_sort::sort_ens(pop, fronts, ranks, false);
+      }
+      void operator()(const fit::ObjMatrix& objs,
+                      Fronts& fronts,
+                      std::vector<size_t>& ranks) const {
+        _dom_sort::sort_ens(objs, fronts, ranks, false);
+      }
+    };
+
+    // ENS with binary search (best when there are many fronts)
+    struct dom_sort_ens_bs_f {
+      template<typename Indiv>
+      void operator()(const std::vector<Indiv>& pop,
+                      std::vector<std::vector<Indiv> >& fronts,
+                      std::vector<size_t>& ranks) const {
+        _dom_sort::sort_ens(pop, fronts, ranks, true);
+      }
+      void operator()(const fit::ObjMatrix& objs,
+                      Fronts& fronts,
+                      std::vector<size_t>& ranks) const {
+        _dom_sort::sort_ens(objs, fronts, ranks, true);
+      }
+    };
   }
 }
 
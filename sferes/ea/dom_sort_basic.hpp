@@ -46,7 +46,7 @@ namespace sferes {
         template<typename Indiv>
         inline bool operator() (const Indiv& ind, const std::vector<Indiv>& pop) const {
 
-          BOOST_FOREACH(Indiv i, pop) {
+          BOOST_FOREACH(const Indiv& i, pop) {
             assert(i);
             assert(ind);
             if (fit::dominate(i, ind))
@@ -65,11 +65,15 @@ namespace sferes {
       for (size_t i = 0; i < p.size(); ++i)
         p[i] = i;
       ranks.resize(pop.size());
+      // (the buffers are reused by all the fronts)
+      std::vector<size_t> non_dominated, np;
+      std::vector<Indiv> tmp_pop;
+      tmp_pop.reserve(pop.size());
       int rank = 0;
       while (!p.empty()) {
-        std::vector<size_t> non_dominated;
         std::vector<Indiv> non_dominated_ind;
-        std::vector<Indiv> tmp_pop;
+        non_dominated.clear();
+        tmp_pop.clear();
         for (size_t i = 0; i < p.size(); ++i)
           tmp_pop.push_back(pop[p[i]]);
         for (size_t i = 0; i < p.size(); ++i)
@@ -79,7 +83,7 @@ namespace sferes {
             non_dominated_ind.push_back(pop[p[i]]);
           }
         assert(non_dominated.size());
-        std::vector<size_t> np;
+        np.clear();
         std::set_difference(p.begin(), p.end(),
                             non_dominated.begin(), non_dominated.end(),
                             std::back_insert_iterator<std::vector<size_t> >(np));
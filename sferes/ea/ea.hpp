@@ -41,9 +41,12 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <future>
+#include <unordered_map>
 
 #include <boost/fusion/container.hpp>
 #include <boost/fusion/algorithm.hpp>
+#include <boost/mpl/bool.hpp>
 #include <boost/mpl/vector.hpp>
 #include <boost/fusion/support/is_sequence.hpp>
 #include <boost/fusion/include/is_sequence.hpp>
@@ -59,11 +62,16 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/mpl/joint_view.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/array.hpp>
 
 #include <sferes/dbg/dbg.hpp>
 #include <sferes/misc.hpp>
+#include <sferes/misc/async_writer.hpp>
 #include <sferes/stc.hpp>
 #include <sferes/stat/state.hpp>
+#include <sferes/ea/checkpoint.hpp>
 
 #ifndef VERSION
 #define VERSION "version_unknown"
@@ -132,6 +140,66 @@ namespace sferes {
     };
 
 
+    // columnar checkpoints (see checkpoint.hpp): the population of the
+    // stat::State is stored in the matrices, the other stats in blobs
+    struct WriteColumnarStat_f {
+      WriteColumnarStat_f(checkpoint::Builder& b) : _builder(b) {
+      }
+      checkpoint::Builder& _builder;
+      template<typename T>
+      void operator() (const T& x) const {
+        _blob(x);
+      }
+      template<typename P, typename Pa, typename E>
+      void operator() (const stat::State<P, Pa, E>& x) const {
+        if (!_builder.add_pop(x.gen(), x.pop(), checkpoint::indivs<Pa>::value))
+          _blob(x);
+        else if (x.has_seed())
+          _builder.set_seed(x.seed());
+      }
+      template<typename T>
+      void _blob(const T& x) const {
+        boost::iostreams::stream<boost::iostreams::back_insert_device<std::string> >
+        os(_builder.add_blob());
+        boost::archive::binary_oarchive oa(os);
+        WriteStat_f<boost::archive::binary_oarchive> write(oa);
+        write(x);
+      }
+    };
+
+    struct ReadColumnarStat_f {
+      ReadColumnarStat_f(const checkpoint::Mapped& m) : _mapped(m), _i(0) {
+      }
+      const checkpoint::Mapped& _mapped;
+      mutable size_t _i;
+      template<typename T>
+      void operator() (T& x) const {
+        _blob(x);
+        ++_i;
+      }
+      template<typename P, typename Pa, typename E>
+      void operator() (stat::State<P, Pa, E>& x) const {
+        if (_i == _mapped.pop_blob()) {
+          std::vector<boost::shared_ptr<P> > pop;
+          _mapped.pop(pop);
+          x.set(_mapped.gen(), pop);
+          if (_mapped.has_seed())
+            x.set_seed(_mapped.seed());
+        } else
+          _blob(x);
+        ++_i;
+      }
+      template<typename T>
+      void _blob(T& x) const {
+        assert(_i < _mapped.nb_blobs());
+        boost::iostreams::stream<boost::iostreams::array_source>
+        is(_mapped.blob(_i), _mapped.blob_size(_i));
+        boost::archive::binary_iarchive ia(is);
+        ReadStat_f<boost::archive::binary_iarchive> read(ia);
+        read(x);
+      }
+    };
+
     template<typename E>
     struct ApplyModifier_f {
       ApplyModifier_f(E &ea) : _ea(ea) {
@@ -152,6 +220,9 @@ namespace sferes {
         typedef stat::State<typename EA::phen_t, typename EA::params_t>  state_t;
         const state_t& s = *boost::fusion::find<state_t>(ea.stat());
         ea.set_gen(s.gen() + 1);
+        // the same random numbers as the run that was interrupted
+        if (s.has_seed())
+          misc::rand_seed(s.seed());
         ea.set_pop(s.pop());
       }
     };
@@ -162,6 +233,88 @@ namespace sferes {
       void resume(EA& ea) { }
     };
 
+    // Params::pop::pipelined (optional, false by default): pipelined mode
+    // (see Ea::pipelined())
+    template<typename P, typename Enable = void>
+    struct pipelined {
+      SFERES_CONST bool value = false;
+    };
+    template<typename P>
+    struct pipelined<P, typename stc::Void<decltype(P::pop::pipelined)>::type> {
+      SFERES_CONST bool value = P::pop::pipelined;
+    };
+
+    // What the stats see in the pipelined mode (see Ea::pipelined()):
+    // a copy of the population (and of the pareto front for NSGA-II) made
+    // at the end of the generation, so that it does not change while the
+    // next generation is computed. The evaluator and the modifiers are those
+    // of the EA: the EA waits for the end of the refresh before using them.
+    template<typename E>
+    class Snapshot {
+     public:
+      typedef typename E::phen_t phen_t;
+      typedef typename E::eval_t eval_t;
+      typedef typename E::modifier_t modifier_t;
+      typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+
+      Snapshot(const E& ea) :
+        _ea(ea), _gen(ea.gen()), _nb_evals(ea.nb_evals()), _res_dir(ea.res_dir()) {}
+
+      // copy the individuals of src to dst (an individual that is in
+      // several populations is copied only once)
+      template<typename P>
+      void copy(const std::vector<boost::shared_ptr<P> >& src, pop_t& dst) {
+        dst.resize(src.size());
+        for (size_t i = 0; i < src.size(); ++i) {
+          boost::shared_ptr<phen_t>& c = _copies[src[i].get()];
+          if (!c)
+            c = misc::Pool<phen_t>::create(static_cast<const phen_t&>(*src[i]));
+          dst[i] = c;
+        }
+      }
+
+      const pop_t& pop() const {
+        return _pop;
+      }
+      pop_t& pop() {
+        return _pop;
+      }
+      const pop_t& pareto_front() const {
+        return _pareto_front;
+      }
+      pop_t& pareto_front() {
+        return _pareto_front;
+      }
+      size_t gen() const {
+        return _gen;
+      }
+      size_t nb_evals() const {
+        return _nb_evals;
+      }
+      const std::string& res_dir() const {
+        return _res_dir;
+      }
+      bool dump_enabled() const {
+        return _ea.dump_enabled();
+      }
+      const eval_t& eval() const {
+        return _ea.eval();
+      }
+      const modifier_t& fit_modifier() const {
+        return _ea.fit_modifier();
+      }
+      template<int I>
+      const typename boost::fusion::result_of::value_at_c<modifier_t, I>::type& fit_modifier() const {
+        return _ea.template fit_modifier<I>();
+      }
+     protected:
+      const E& _ea;
+      size_t _gen, _nb_evals;
+      std::string _res_dir;
+      pop_t _pop, _pareto_front;
+      std::unordered_map<const void*, boost::shared_ptr<phen_t> > _copies;
+    };
+
     template<typename Phen, typename Eval, typename Stat, typename FitModifier,
              typename Params,
              typename Exact = stc::Itself>
@@ -189,7 +342,14 @@ namespace sferes {
 
       typedef std::vector<boost::shared_ptr<Phen> > pop_t;
       typedef typename phen_t::fit_t fit_t;
-      Ea() : _pop(Params::pop::size), _gen(0), _stop(false) {
+      Ea() : _pop(Params::pop::size), _gen(0), _stop(false),
+        _nb_write_errors(0), _last_submitted(-1) {
+      }
+      ~Ea() {
+        if (_stats_task.valid())
+          _stats_task.wait();
+        // the writer may still serialize the stats
+        _writer.wait();
       }
       void set_fit_proto(const fit_t& fit) {
         _fit_proto = fit;
@@ -200,9 +360,16 @@ namespace sferes {
         _exp_name = exp_name;
         _make_res_dir();
         _set_status("running");
-        random_pop();
-        for (_gen = 0; _gen < Params::pop::nb_gen && !_stop; ++_gen)
-          _iter();
+        misc::rand_epoch(0);
+        _gen = 0;
+        try {
+          random_pop();
+          _iterate();
+        } catch (const misc::abandoned&) {
+          _interrupt((int)_gen - 1);
+        }
+        _wait_stats();
+        _writer.wait();
         if (!_stop)
           _set_status("finished");
       }
@@ -220,9 +387,14 @@ namespace sferes {
         Resume<stat_t, has_state_t> r;
         r.resume(*this);
         assert(!_pop.empty());
-        std::cout<<"resuming at:"<< gen() << std::endl;
-        for (; _gen < Params::pop::nb_gen && !_stop; ++_gen)
-          _iter();
+        std::cout<<"resuming at:"<< gen() << " seed: " << misc::rand_seed() << std::endl;
+        try {
+          _iterate();
+        } catch (const misc::abandoned&) {
+          _interrupt((int)_gen - 1);
+        }
+        _wait_stats();
+        _writer.wait();
         if (!_stop)
           _set_status("finished");
       }
@@ -266,7 +438,11 @@ namespace sferes {
       const typename boost::fusion::result_of::value_at_c<modifier_t, I>::type& fit_modifier() const {
         return boost::fusion::at_c<I>(_fit_modifier);
       }
+      // the modifiers change the fitness of the individuals, which the stats
+      // (e.g. stat::Archive) can share with the EA: the gen file of the
+      // previous generation must be serialized first
       void apply_modifier() {
+        _wait_stats();
         boost::fusion::for_each(_fit_modifier, ApplyModifier_f<Exact>(stc::exact(*this)));
       }
 
@@ -289,6 +465,7 @@ namespace sferes {
         boost::fusion::for_each(_stat, ShowStat_f(i, os, k));
       }
       void update_stats() {
+        _wait_stats();
         boost::fusion::for_each(_stat, RefreshStat_f<Exact>(stc::exact(*this)));
       }
       const std::string& res_dir() const {
@@ -310,11 +487,40 @@ namespace sferes {
       bool dump_enabled() const {
         return Params::pop::dump_period != -1;
       }
+      // the file is written when write() returns
       void write() const {
-        _write(gen());
+        write(gen());
       }
       void write(size_t g) const {
+        _wait_stats();
         _write(g);
+        _writer.wait();
+      }
+      // write the stats to fname as a columnar checkpoint (see checkpoint.hpp),
+      // e.g. to convert a gen file loaded with load()
+      void write_checkpoint(const std::string& fname) const {
+        _wait_stats();
+        _serialize_columnar(_writer.buffer());
+        _writer.submit(fname);
+        _writer.wait();
+      }
+      // the background writer of the gen files (e.g. for its latency)
+      const misc::AsyncWriter& writer() const {
+        return _writer;
+      }
+      // Delta checkpoints (off by default): with k > 1, the gen files are
+      // columnar checkpoints, and only one dump out of k is a full one; the
+      // other ones are deltas of the previous dump, which only store the
+      // individuals that entered the population since then (see
+      // checkpoint::History). The individuals are boost archives, so the
+      // deltas load the same stats as the default gen files. resume() /
+      // load() replay the chain of deltas, which must stay in the same
+      // directory.
+      void set_full_dump_period(size_t k) {
+        _history.set_period(k);
+      }
+      size_t full_dump_period() const {
+        return _history.period();
       }
       void stop() {
         _stop = true;
@@ -323,6 +529,28 @@ namespace sferes {
       bool is_stopped() const {
         return _stop;
       }
+      // Pipelined mode (Params::pop::pipelined, off by default): at the end
+      // of a generation, the population is copied (see Snapshot) and a
+      // background task refreshes the stats with this copy, then the writer
+      // thread serializes them to the gen file, while the next generation
+      // is selected and varied. The EA waits for the end of the refresh
+      // before the next evaluation or modifier (that the stats may read),
+      // and for the end of the serialization before the next refresh. The stats are thus refreshed in the same
+      // order and with the same data as in the default mode, but ea.stat()
+      // is only up-to-date after run() / resume(). Only the stats and the
+      // gen files overlap the next generation, not the evaluations (see
+      // AsyncNsga2 for that). The stats see a Snapshot instead of the EA:
+      // they can only use the accessors of Snapshot.
+      static bool pipelined() {
+        return ea::pipelined<Params>::value;
+      }
+      typedef Snapshot<Exact> snapshot_t;
+      // the copy of the population used in pipelined mode; override
+      // _fill_snapshot to add other populations
+      // (in that case, DO NOT FORGET to add SFERES_EA_FRIEND(YouAlgo);)
+      void fill_snapshot(snapshot_t& s) const {
+        stc::exact(this)->_fill_snapshot(s);
+      }
 
      protected:
       pop_t _pop;
@@ -334,13 +562,86 @@ namespace sferes {
       fit_t _fit_proto;
       bool _stop;
       std::string _exp_name;
-
+      mutable std::future<void> _stats_task;
+      mutable misc::AsyncWriter _writer;
+      mutable checkpoint::History _history;
+      mutable size_t _nb_write_errors;
+      // the generation of the last gen file submitted to the writer
+      mutable int _last_submitted;
+      mutable std::shared_future<void> _refreshed;
+
+      // the generations until nb_gen or a stop request (see misc/stop.hpp)
+      void _iterate() {
+        for (; _gen < Params::pop::nb_gen && !_stop; ++_gen) {
+          _iter();
+          if (misc::stop_requested() && !_stop)
+            _interrupt(_gen);
+        }
+      }
+      // stop after a stop request; last_gen is the last complete generation
+      // (-1 if none), which is written so that the run can be resumed
+      void _interrupt(int last_gen) {
+        std::cout << "stop requested (signal " << misc::stop_requested() << ")";
+        if (last_gen < (int)_gen)
+          std::cout << ", generation " << _gen << " abandoned";
+        std::cout << std::endl;
+        stop();
+        // (the gen file of last_gen can already be submitted, e.g. if
+        // last_gen % dump_period == 0)
+        _wait_stats();
+        if (last_gen >= 0 && last_gen != _last_submitted)
+          write(last_gen);
+      }
       void _iter() {
+        // the random numbers of a generation only depend on the seed and
+        // on the generation number (see misc/rand.hpp)
+        misc::rand_epoch((uint32_t)_gen + 1);
         epoch();
+        _end_gen(boost::mpl::bool_<ea::pipelined<Params>::value>());
+      }
+      void _end_gen(boost::mpl::false_) {
         update_stats();
         if (_gen % Params::pop::dump_period == 0)
           _write(_gen);
       }
+      void _end_gen(boost::mpl::true_) {
+        _launch_stats();
+      }
+
+      void _fill_snapshot(snapshot_t& s) const {
+        s.copy(_pop, s.pop());
+      }
+      void _launch_stats() {
+        _wait_stats();
+        boost::shared_ptr<snapshot_t> s(new snapshot_t(stc::exact(*this)));
+        fill_snapshot(*s);
+        boost::shared_ptr<std::promise<void> > refreshed(new std::promise<void>());
+        _refreshed = refreshed->get_future().share();
+        size_t gen = _gen;
+        _stats_task = std::async(std::launch::async, [this, s, refreshed, gen]() {
+          try {
+            boost::fusion::for_each(_stat, RefreshStat_f<snapshot_t>(*s));
+          } catch (...) {
+            refreshed->set_exception(std::current_exception());
+            throw;
+          }
+          refreshed->set_value();
+          if (gen % Params::pop::dump_period == 0)
+            _write(gen);
+        });
+      }
+      // the stats can be read / written by the EA
+      void _wait_refresh() const {
+        if (_refreshed.valid())
+          _refreshed.get();
+      }
+      // the gen file is submitted to the writer, and serialized
+      void _wait_stats() const {
+        if (_stats_task.valid())
+          _stats_task.get();
+        _refreshed = std::shared_future<void>();
+        _writer.wait_filled();
+      }
 
       // the status is a file that tells the state of the experiment
       // it is useful to tell to the rest of the world if the experiment has
@@ -355,6 +656,7 @@ namespace sferes {
       template<typename P>
       void _eval_pop(P& p, size_t start, size_t end) {
         dbg::trace trace("ea", DBG_HERE);
+        _wait_refresh();
         this->_eval.eval(p, start, end, this->_fit_proto);
       }
       // override _set_pop if you want to customize / add treatments
@@ -375,25 +677,85 @@ namespace sferes {
         boost::filesystem::path my_path(_res_dir);
         boost::filesystem::create_directory(my_path);
       }
+      // the stats are serialized to a buffer of the checkpoint writer, which
+      // writes it to the disk in background (see misc::AsyncWriter); the
+      // format is a boost archive, or a columnar checkpoint if
+      // SFERES_COLUMNAR_CHECKPOINT is defined or with delta checkpoints
       void _write(int gen) const {
         dbg::trace trace("ea", DBG_HERE);
         if (Params::pop::dump_period == -1)
           return;
         std::string fname = _res_dir + std::string("/gen_")
                             + boost::lexical_cast<std::string>(gen);
-        std::ofstream ofs(fname.c_str());
+        _last_submitted = gen;
+        _submit(fname, boost::mpl::bool_<ea::pipelined<Params>::value>());
+      }
+      // default mode: the stats point to the individuals of the EA, which
+      // the next generation changes, so they are serialized now
+      void _submit(const std::string& fname, boost::mpl::false_) const {
+        // a delta needs the result of the write of the previous file (see
+        // _serialize_gen), which is usually finished after dump_period
+        // generations
+        if (_history.period() > 1)
+          _writer.wait();
+        _serialize_gen(_writer.buffer());
+        _writer.submit(fname);
+      }
+      // pipelined mode: the stats point to the copies of a Snapshot, so
+      // they are serialized by the writer thread (the next refresh waits
+      // for it, see _wait_stats())
+      void _submit(const std::string& fname, boost::mpl::true_) const {
+        _writer.submit(fname, [this](std::string& buffer) {
+          _serialize_gen(buffer);
+        });
+      }
+      void _serialize_gen(std::string& buffer) const {
+        // a delta of a file that could not be written could not be loaded
+        if (_writer.nb_errors() != _nb_write_errors) {
+          _nb_write_errors = _writer.nb_errors();
+          _history.reset();
+        }
+        bool columnar = _history.period() > 1;
+#ifdef SFERES_COLUMNAR_CHECKPOINT
+        columnar = true;
+#endif
+        if (columnar)
+          _serialize_columnar(buffer, &_history);
+        else
+          _serialize(buffer);
+      }
+      void _serialize(std::string& buffer) const {
+        boost::iostreams::stream<boost::iostreams::back_insert_device<std::string> >
+        os(buffer);
 #ifdef  SFERES_XML_WRITE
         typedef boost::archive::xml_oarchive oa_t;
 #else
         typedef boost::archive::binary_oarchive oa_t;
 #endif
-        oa_t oa(ofs);
+        oa_t oa(os);
         boost::fusion::for_each(_stat, WriteStat_f<oa_t>(oa));
-        std::cout << fname << " written" << std::endl;
+      }
+      void _serialize_columnar(std::string& buffer,
+                               checkpoint::History* history = 0) const {
+        checkpoint::Builder builder(history);
+        boost::fusion::for_each(_stat, WriteColumnarStat_f(builder));
+        builder.finish(buffer);
       }
       void _load(const std::string& fname) {
         dbg::trace trace("ea", DBG_HERE);
         std::cout << "loading " << fname << std::endl;
+        if (checkpoint::is_checkpoint(fname)) {
+          try {
+            checkpoint::Mapped m(fname);
+            if (m.nb_blobs() != (size_t)boost::fusion::size(_stat))
+              throw std::runtime_error(fname + ": the stats do not match the checkpoint");
+            boost::fusion::for_each(_stat, ReadColumnarStat_f(m));
+          } catch (const std::exception& e) {
+            std::cerr << "Cannot load " << fname << ": " << e.what() << std::endl;
+            exit(1);
+          }
+          return;
+        }
         std::ifstream ifs(fname.c_str());
         if (ifs.fail()) {
           std::cerr << "Cannot open :" << fname
@@ -50,6 +50,8 @@
 #include <sferes/parallel.hpp>
 #include <sferes/ea/ea.hpp>
 #include <sferes/fit/fitness.hpp>
+#include <sferes/fit/obj_matrix.hpp>
+#include <sferes/fit/dominate_block.hpp>
 #include <sferes/ea/common.hpp>
 namespace sferes {
   namespace ea {
@@ -64,6 +66,7 @@ namespace sferes {
         parallel::p_for(parallel::range_t(0, this->_pop.size()),
                         random<Phen>(this->_pop));
         this->_eval_pop(this->_pop, 0, this->_pop.size());
+        _pop_objs.snapshot(this->_pop);
         // create archive
         add_to_archive(this->_pop.front());
         for (typename pop_t :: const_iterator it = this->_pop.begin();
@@ -74,6 +77,7 @@ namespace sferes {
 
       void epoch() {
         std::vector<indiv_t> indivs;
+        _pop_objs.snapshot(this->_pop);
 
         for (size_t i = 0; i < Params::pop::grain; ++i) {
           indiv_t i1 = pop_selection();
@@ -111,6 +115,9 @@ namespace sferes {
 
       pop_t _pareto_front;
 
+      // objectives of the population (kept in sync by pop_acceptance)
+      fit::ObjMatrix _pop_objs;
+
       // keep pareto_front & elite synchronized (for stat reporting)
       void sync_archive() {
         _pareto_front.clear();
@@ -121,10 +128,12 @@ namespace sferes {
       /// return a random + tournament individual in P
       indiv_t pop_selection() {
 
-        indiv_t i1 = this->_pop[misc::rand(this->_pop.size())];
-        indiv_t i2 = this->_pop[misc::rand(this->_pop.size())];
+        size_t k1 = misc::rand(this->_pop.size());
+        size_t k2 = misc::rand(this->_pop.size());
+        indiv_t i1 = this->_pop[k1];
+        indiv_t i2 = this->_pop[k2];
 
-        int flag = check_dominance(i1, i2);
+        int flag = _pop_objs.dominate_flag(k1, k2);
         switch (flag) {
         case 1: // a dom b
           return i1;
@@ -150,26 +159,20 @@ namespace sferes {
       /// return true if accepted
       bool pop_acceptance(indiv_t ind) {
         dbg::out(dbg::info, "epsmoea")<<"pop_acceptance :"<<indiv_str(ind)<<std::endl;
-        int flag = 0;
         std::vector<int> array;
-        int i = 0;
 
-        for (typename pop_t :: const_iterator it = this->_pop.begin();
-             it != this->_pop.end(); ++it) {
-          flag = check_dominance(ind, *it);
-          switch (flag) {
-          case 1:
-            array.push_back(i);
-            break;
-          case -1:
+        assert(_pop_objs.size() == this->_pop.size());
+        assert(ind->fit().objs().size() == _pop_objs.nb_objs());
+        const float* o = &ind->fit().objs()[0];
+        for (size_t b = 0; b < _pop_objs.size(); b += fit::ObjMatrix::block_size) {
+          unsigned dominating, dominated;
+          fit::dominate_block(o, _pop_objs, b, dominating, dominated);
+          if (dominated) {
             dbg::out(dbg::info, "epsmoea")<<"pop_acceptance -> rejected"<<std::endl;
             return false;
-          case 0:
-            break;
-          default:
-            assert(0);
           }
-          ++i;
+          for (; dominating; dominating &= dominating - 1)
+            array.push_back(b + __builtin_ctz(dominating));
         }
 
         int k;
@@ -181,6 +184,7 @@ namespace sferes {
                                       <<indiv_str(this->_pop[k])
                                       <<"  array.size()="<<array.size()<<std::endl;
         this->_pop[k] = ind;
+        _pop_objs.set_row(k, ind->fit().objs());
         dbg::out(dbg::info, "epsmoea")<<"pop_acceptance -> accepted (k="<<k<<")"<<std::endl;
         return true;
       }
@@ -0,0 +1,124 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+
+#ifndef FRONTS_HPP_
+#define FRONTS_HPP_
+
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+namespace sferes {
+  namespace ea {
+    // non-dominated fronts as index spans of a single buffer:
+    // front i is [begin(i), end(i)) (indices in the sorted population)
+    // clear() keeps the storage, so that a Fronts object owned by an EA
+    // does not allocate once the population size is stable
+    class Fronts {
+     public:
+      Fronts() : _begin(1, 0) {}
+
+      // remove all the fronts and make room for n indices
+      void clear(size_t n) {
+        _idx.resize(n);
+        _begin.resize(1);
+      }
+      // number of fronts
+      size_t size() const {
+        return _begin.size() - 1;
+      }
+      bool empty() const {
+        return size() == 0;
+      }
+      // number of indices in the fronts
+      size_t nb_indivs() const {
+        return _begin.back();
+      }
+      size_t front_size(size_t i) const {
+        assert(i < size());
+        return _begin[i + 1] - _begin[i];
+      }
+      // number of fronts needed to select n individuals
+      // (the last one is only partially selected if it is too large)
+      size_t nb_fronts_for(size_t n) const {
+        assert(n <= nb_indivs());
+        return std::lower_bound(_begin.begin() + 1, _begin.end(), n) - _begin.begin();
+      }
+      const size_t* begin(size_t i) const {
+        assert(i < size());
+        return _idx.data() + _begin[i];
+      }
+      const size_t* end(size_t i) const {
+        assert(i < size());
+        return _idx.data() + _begin[i + 1];
+      }
+      size_t* begin(size_t i) {
+        assert(i < size());
+        return _idx.data() + _begin[i];
+      }
+      size_t* end(size_t i) {
+        assert(i < size());
+        return _idx.data() + _begin[i + 1];
+      }
+
+      // buffer of indices, filled front by front by the sorting algorithms
+      size_t* data() {
+        return _idx.data();
+      }
+      // close the front that ends at position e of data()
+      void add_front(size_t e) {
+        assert(e >= _begin.back());
+        assert(e <= _idx.size());
+        _begin.push_back(e);
+      }
+      // copy f at the end of the buffer, as a new front
+      void push_back(const std::vector<size_t>& f) {
+        size_t b = _begin.back();
+        assert(b + f.size() <= _idx.size());
+        std::copy(f.begin(), f.end(), _idx.begin() + b);
+        add_front(b + f.size());
+      }
+     protected:
+      std::vector<size_t> _idx;
+      std::vector<size_t> _begin;
+    };
+  }
+}
+
+#endif
@@ -56,15 +56,19 @@ namespace sferes {
     // The generic NSGA2 is a NSGA2 with a template for the 'crowding distance'
     // abstracting this allows us to implement variants of NSGA2 that use a different
     // criteria to rank individuals that are on the same front (e.g. genotypic diversity)
+    // DomSort is the non-dominated sorting algorithm (see dom_sort.hpp), e.g.
+    // dom_sort_ens_ss_f is much faster than the default one with more than 2 objectives
+    // (it is after Exact so that the subclasses that pass Exact are not changed)
     template<typename Phen, typename Eval, typename Stat, typename FitModifier, typename Crowd, typename Params,
-             typename Exact = stc::Itself>
+             typename Exact = stc::Itself, typename DomSort = dom_sort_f>
     class GenericNsga2 : public Ea <Phen, Eval, Stat, FitModifier, Params,
-    typename stc::FindExact<GenericNsga2<Phen, Eval, Stat, FitModifier, Params, Exact>, Exact>::ret > {
+    typename stc::FindExact<GenericNsga2<Phen, Eval, Stat, FitModifier, Crowd, Params, Exact, DomSort>, Exact>::ret > {
     public:
       typedef boost::shared_ptr<crowd::Indiv<Phen> > indiv_t;
       typedef typename std::vector<indiv_t> pop_t;
       typedef typename pop_t::iterator it_t;
       typedef typename std::vector<std::vector<indiv_t> > front_t;
+      typedef typename Phen::gen_t gen_t;
       SFERES_EA_FRIEND(GenericNsga2);
 
       void random_pop() {
@@ -78,8 +82,6 @@ namespace sferes {
                         random<crowd::Indiv<Phen> >(init_pop));
         _eval_subpop(init_pop);
         _apply_modifier(init_pop);
-        front_t fronts;
-        _rank_crowd(init_pop, fronts);
         _fill_nondominated_sort(init_pop, _parent_pop);
       }
 
@@ -88,8 +90,7 @@ namespace sferes {
         // this->_pop.clear();
         // _pareto_front.clear();
         _selection (_parent_pop, _child_pop);
-        parallel::p_for(parallel::range_t(0, _child_pop.size()),
-                        mutate<crowd::Indiv<Phen> >(_child_pop));
+        _mutation(_child_pop);
 #ifndef EA_EVAL_ALL
         _eval_subpop(_child_pop);
         _merge(_parent_pop, _child_pop, _mixed_pop);
@@ -128,22 +129,42 @@ namespace sferes {
       const pop_t& child_pop() const {
         return _child_pop;
       }
+      // the stats (e.g. stat::ParetoFront) may read the pareto front
+      // (see Ea::pipelined())
+      void _fill_snapshot(typename GenericNsga2::snapshot_t& s) const {
+        s.copy(this->_pop, s.pop());
+        s.copy(_pareto_front, s.pareto_front());
+      }
 
     protected:
       std::vector<boost::shared_ptr<Phen> > _pareto_front;
       pop_t _parent_pop;
       pop_t _child_pop;
       pop_t _mixed_pop;
+      // ranking buffers, reused from one generation to the next
+      DomSort _dom_sorter;
+      fit::ObjMatrix _objs;
+      Fronts _fronts;
+      std::vector<size_t> _ranks;
+      std::vector<float> _crowd;
+      // genotypes for the batch variation operators
+      std::vector<gen_t*> _p1, _p2, _c1, _c2;
+      // tournament orders
+      std::vector<size_t> _a1, _a2;
+      std::vector<uint64_t> _perm_buf;
 
       // for resuming
       void _set_pop(const std::vector<boost::shared_ptr<Phen> >& pop) {
         assert(!pop.empty());
         _parent_pop.resize(pop.size());
         for (size_t i = 0; i < pop.size(); ++i)
-          _parent_pop[i] = boost::shared_ptr<crowd::Indiv<Phen> >(new crowd::Indiv<Phen>(*pop[i]));
+          _parent_pop[i] = misc::Pool<crowd::Indiv<Phen> >::create(*pop[i]);
       }
-      void _update_pareto_front(const front_t& fronts) {
-        _convert_pop(fronts.front(), _pareto_front);
+      void _update_pareto_front(const pop_t& pop) {
+        assert(!_fronts.empty());
+        _pareto_front.resize(_fronts.front_size(0));
+        for (size_t i = 0; i < _pareto_front.size(); ++i)
+          _pareto_front[i] = pop[_fronts.begin(0)[i]];
       }
 
       void _convert_pop(const pop_t& pop1,
@@ -163,32 +184,31 @@ namespace sferes {
       }
       void _fill_nondominated_sort(pop_t& mixed_pop, pop_t& new_pop) {
         assert(mixed_pop.size());
-        front_t fronts;
 #ifndef NDEBUG
         BOOST_FOREACH(indiv_t& ind, mixed_pop)
         for (size_t i = 0; i < ind->fit().objs().size(); ++i) {
           assert(!std::isnan(ind->fit().objs()[i]));
         }
 #endif
-        _rank_crowd(mixed_pop, fronts);
+        _rank_crowd(mixed_pop, Params::pop::size);
         new_pop.clear();
 
         // fill the i first layers
         size_t i;
-        for (i = 0; i < fronts.size(); ++i)
-          if (fronts[i].size() + new_pop.size() < Params::pop::size)
-            new_pop.insert(new_pop.end(), fronts[i].begin(), fronts[i].end());
+        for (i = 0; i < _fronts.size(); ++i)
+          if (_fronts.front_size(i) + new_pop.size() < Params::pop::size)
+            for (const size_t* it = _fronts.begin(i); it != _fronts.end(i); ++it)
+              new_pop.push_back(mixed_pop[*it]);
           else
             break;
 
         size_t size = Params::pop::size - new_pop.size();
         // sort the last layer
         if (new_pop.size() < Params::pop::size) {
-          std::sort(fronts[i].begin(), fronts[i].end(), crowd::compare_crowd());
-          for (size_t k = 0; k < size ; ++k) {
-            assert(i < fronts.size());
-            new_pop.push_back(fronts[i][k]);
-          }
+          assert(i < _fronts.size());
+          std::sort(_fronts.begin(i), _fronts.end(i), crowd::compare_crowd_idx(_crowd));
+          for (size_t k = 0; k < size ; ++k)
+            new_pop.push_back(mixed_pop[_fronts.begin(i)[k]]);
         }
         assert(new_pop.size() == Params::pop::size);
       }
@@ -204,21 +224,87 @@ namespace sferes {
       }
 
       // --- tournament selection ---
+      // each group of 4 children comes from 4 binary tournaments and 2
+      // cross-overs; the groups are processed in parallel, by blocks of
+      // batch_block_size / 2 groups that draw from their own random stream.
+      // If the genotype provides batch operators (gen::batch), the
+      // tournaments of a block are run first, then all its cross-overs at once
+      SFERES_CONST size_t groups_per_block = batch_block_size / 2;
+      struct _select_f {
+        GenericNsga2& _ea;
+        const pop_t& _old_pop;
+        pop_t& _new_pop;
+        uint32_t _stream;
+        ~_select_f() { }
+        _select_f(GenericNsga2& ea, const pop_t& old_pop, pop_t& new_pop) :
+          _ea(ea), _old_pop(old_pop), _new_pop(new_pop), _stream(misc::rand_stream()) {}
+        _select_f(const _select_f& ev) :
+          _ea(ev._ea), _old_pop(ev._old_pop), _new_pop(ev._new_pop), _stream(ev._stream) {}
+        void operator() (const parallel::range_t& r) const {
+          for (size_t k = r.begin(); k != r.end(); ++k) {
+            misc::rand_scope scope(_stream, k);
+            size_t begin = k * groups_per_block * 4;
+            size_t end = std::min(begin + groups_per_block * 4, _old_pop.size());
+            for (size_t i = begin; i < end; i += 4)
+              _ea._select_group(_old_pop, _new_pop, i);
+            if (gen::batch<gen_t>::enabled)
+              gen::batch<gen_t>::cross(&_ea._p1[begin / 2], &_ea._p2[begin / 2],
+                                       &_ea._c1[begin / 2], &_ea._c2[begin / 2],
+                                       (end - begin) / 2);
+          }
+        }
+      };
+
       void _selection(pop_t& old_pop, pop_t& new_pop) {
+        assert(old_pop.size() % 4 == 0);
         new_pop.resize(old_pop.size());
-        std::vector<size_t> a1, a2;
-        misc::rand_ind(a1, old_pop.size());
-        misc::rand_ind(a2, old_pop.size());
-        // todo : this loop could be parallelized
-        for (size_t i = 0; i < old_pop.size(); i += 4) {
-          const indiv_t& p1 = _tournament(old_pop[a1[i]], old_pop[a1[i + 1]]);
-          const indiv_t& p2 = _tournament(old_pop[a1[i + 2]], old_pop[a1[i + 3]]);
-          const indiv_t& p3 = _tournament(old_pop[a2[i]], old_pop[a2[i + 1]]);
-          const indiv_t& p4 = _tournament(old_pop[a2[i + 2]], old_pop[a2[i + 3]]);
-          assert(i + 3 < new_pop.size());
+        rand_perm(_a1, old_pop.size(), _perm_buf);
+        rand_perm(_a2, old_pop.size(), _perm_buf);
+        if (gen::batch<gen_t>::enabled) {
+          _p1.resize(old_pop.size() / 2);
+          _p2.resize(old_pop.size() / 2);
+          _c1.resize(old_pop.size() / 2);
+          _c2.resize(old_pop.size() / 2);
+        }
+        size_t nb_blocks = (old_pop.size() / 4 + groups_per_block - 1) / groups_per_block;
+        parallel::p_for(parallel::range_t(0, nb_blocks), _select_f(*this, old_pop, new_pop));
+      }
+      // children i..i+3
+      void _select_group(const pop_t& old_pop, pop_t& new_pop, size_t i) {
+        const indiv_t& p1 = _tournament(old_pop[_a1[i]], old_pop[_a1[i + 1]]);
+        const indiv_t& p2 = _tournament(old_pop[_a1[i + 2]], old_pop[_a1[i + 3]]);
+        const indiv_t& p3 = _tournament(old_pop[_a2[i]], old_pop[_a2[i + 1]]);
+        const indiv_t& p4 = _tournament(old_pop[_a2[i + 2]], old_pop[_a2[i + 3]]);
+        assert(i + 3 < new_pop.size());
+        if (!gen::batch<gen_t>::enabled) {
           p1->cross(p2, new_pop[i], new_pop[i + 1]);
           p3->cross(p4, new_pop[i + 2], new_pop[i + 3]);
+          return;
+        }
+        for (size_t j = i; j < i + 4; ++j)
+          if (!new_pop[j])
+            new_pop[j] = misc::Pool<crowd::Indiv<Phen> >::create();
+        size_t k = i / 2;
+        _p1[k] = &p1->gen();
+        _p2[k] = &p2->gen();
+        _c1[k] = &new_pop[i]->gen();
+        _c2[k] = &new_pop[i + 1]->gen();
+        _p1[k + 1] = &p3->gen();
+        _p2[k + 1] = &p4->gen();
+        _c1[k + 1] = &new_pop[i + 2]->gen();
+        _c2[k + 1] = &new_pop[i + 3]->gen();
+      }
+      void _mutation(pop_t& pop) {
+        if (!gen::batch<gen_t>::enabled) {
+          parallel::p_for(parallel::range_t(0, pop.size()),
+                          mutate<crowd::Indiv<Phen> >(pop));
+          return;
         }
+        _c1.resize(pop.size());
+        for (size_t i = 0; i < pop.size(); ++i)
+          _c1[i] = &pop[i]->gen();
+        parallel::p_for(parallel::range_t(0, batch_nb_blocks(pop.size())),
+                        batch_mutate<gen_t>(_c1));
       }
 
       const indiv_t& _tournament(const indiv_t& i1, const indiv_t& i2) {
@@ -248,22 +334,33 @@ namespace sferes {
 
       // --- rank & crowd ---
 
-      void _rank_crowd(pop_t& pop, front_t& fronts) {
-        std::vector<size_t> ranks;
+      // fronts (as indices in pop) are stored in _fronts; the crowding
+      // distance is only computed for the fronts needed to select size
+      // individuals (0 for the other ones)
+      void _rank_crowd(pop_t& pop, size_t size) {
 #ifndef NDEBUG
         BOOST_FOREACH(indiv_t& ind, pop)
         for (size_t i = 0; i < ind->fit().objs().size(); ++i) {
           assert(!std::isnan(ind->fit().objs()[i]));
         }
 #endif
-        dom_sort(pop, fronts, ranks);
-        _update_pareto_front(fronts);
-        parallel::p_for(parallel::range_t(0, fronts.size()),
-                        crowd::assign_crowd<indiv_t >(fronts));
-
-        for (size_t i = 0; i < ranks.size(); ++i)
-          pop[i]->set_rank(ranks[i]);
-        parallel::sort(pop.begin(), pop.end(), crowd::compare_ranks());
+        // ranks and crowding distances are computed on a snapshot
+        // of the objectives, then written back to the individuals
+        _objs.snapshot(pop);
+        _dom_sorter(_objs, _fronts, _ranks);
+        // the last of these fronts is truncated according to the crowding
+        // distance, and the tournaments of the next generation compare the
+        // crowding distances of the individuals of the other ones
+        _crowd.resize(pop.size());
+        std::fill(_crowd.begin(), _crowd.end(), 0.0f);
+        parallel::p_for(parallel::range_t(0, _fronts.nb_fronts_for(std::min(size, pop.size()))),
+                        crowd::crowd_fronts(_objs, _fronts, _crowd));
+
+        for (size_t i = 0; i < _ranks.size(); ++i) {
+          pop[i]->set_rank(_ranks[i]);
+          pop[i]->set_crowd(_crowd[i]);
+        }
+        _update_pareto_front(pop);
       }
 
       void _assign_rank(pop_t& pop) {
@@ -43,6 +43,7 @@
 #include <sferes/stc.hpp>
 #include <sferes/ea/ea.hpp>
 #include <sferes/fit/fitness.hpp>
+#include <sferes/misc/pool.hpp>
 
 #warning "DEPRECATED: rank_simple will be removed in future versions"
 
@@ -54,7 +55,7 @@ namespace sferes {
       void random_pop() {
         this->_pop.resize(Params::pop::size * Params::pop::initial_aleat);
         BOOST_FOREACH(boost::shared_ptr<Phen>& indiv, this->_pop) {
-          indiv = boost::shared_ptr<Phen>(new Phen());
+          indiv = misc::Pool<Phen>::create();
           indiv->random();
         }
         this->_eval_pop(this->_pop, 0, this->_pop.size());
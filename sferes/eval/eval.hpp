@@ -42,6 +42,7 @@
 #include <boost/shared_ptr.hpp>
 #include <sferes/dbg/dbg.hpp>
 #include <sferes/stc.hpp>
+#include <sferes/misc/stop.hpp>
 
 namespace sferes {
   namespace eval {
@@ -56,6 +57,7 @@ namespace sferes {
         assert(begin < pop.size());
         assert(end <= pop.size());
         for (size_t i = begin; i < end; ++i) {
+          misc::check_abandon();
           pop[i]->fit() = fit_proto;
           pop[i]->develop();
           pop[i]->fit().eval(*pop[i]);
@@ -38,8 +38,17 @@
 #ifndef EVAL_MPI_HPP_
 #define EVAL_MPI_HPP_
 
+#include <deque>
+#include <list>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
 #include <sferes/parallel.hpp>
+#include <sferes/misc/pool.hpp>
 #include <boost/mpi.hpp>
+#include <boost/optional.hpp>
+#include <boost/serialization/vector.hpp>
 
 //#ifndef BOOST_MPI_HAS_NOARG_INITIALIZATION
 //#error MPI need arguments (we require a full MPI2 implementation)
@@ -49,9 +58,101 @@
 namespace sferes {
 
   namespace eval {
+    namespace _mpi {
+      // the tags do not depend on the individuals (the population size is
+      // not limited by max_tag); each worker has 2 slots (double buffering)
+      // and a batch is sent with tag_work + slot, so that the answers to
+      // the two outstanding batches cannot be mixed up
+      SFERES_CONST int tag_work = 1;
+      SFERES_CONST int tag_result = 3;
+      SFERES_CONST int tag_quit = 5;
+      SFERES_CONST size_t nb_slots = 2;
+
+      // what a worker sends back: the fitnesses of a batch (same order as
+      // the genotypes), the time spent to evaluate them and the number of
+      // threads of the worker
+      template<typename Fit>
+      struct result {
+        std::vector<Fit> fits;
+        double time;
+        unsigned nb_threads;
+        template<class Archive>
+        void serialize(Archive& ar, const unsigned int version) {
+          ar & fits;
+          ar & time;
+          ar & nb_threads;
+        }
+      };
+
+      // a batch in flight: individuals [begin, end) of the population
+      template<typename Fit>
+      struct slot {
+        slot() : busy(false), begin(0), end(0), sent(0), deadline(0), alone(false) {}
+        bool busy;
+        size_t begin, end;
+        // the worker is declared dead if the results are not back
+        // before the deadline
+        double sent, deadline;
+        // true if the worker had nothing else to do when the batch was
+        // sent, i.e. the round-trip time is not polluted by the queue
+        bool alone;
+        // owned by a shared_ptr: the buffer of the request of a dead
+        // worker must outlive the slot (see Mpi::_late)
+        boost::shared_ptr<result<Fit> > res;
+        boost::mpi::request req, send_req;
+      };
+
+      // the answer to a batch of a dead worker, that might still arrive;
+      // call is the eval() call of the batch (see Mpi::_drain_late())
+      struct late {
+        size_t worker, call, begin, end;
+        boost::mpi::request req;
+        boost::shared_ptr<void> res;
+      };
+    }
+
+    // Master/worker evaluation: rank 0 runs the EA, the other ranks
+    // evaluate batches of genotypes until the master is destroyed.
+    // - each worker has up to 2 batches queued (isend/irecv), so that it
+    //   never waits for the master between two batches
+    // - the size of the batches is tuned for each worker so that the
+    //   communication overhead (measured round-trip time minus evaluation
+    //   time) stays below max_overhead of the evaluation time of a batch;
+    //   it is bounded by the share of the remaining individuals of the
+    //   worker (proportional to its throughput), so that the last batches
+    //   are small enough to balance the load
+    // - the workers live across successive eval() calls
+    // - a worker that does not answer before the deadline of a batch
+    //   (timeout_factor times the expected time, at least min_timeout())
+    //   is removed from the pool and its batches are sent to the other
+    //   workers; if no worker is left, the master evaluates the remaining
+    //   individuals (see stat::MpiWorkers for the throughput and the
+    //   failures of each worker); there is no deadline before the
+    //   evaluation time of the worker is known, unless min_timeout() is set
+    // - the receptions of a dead worker are not cancelled (this is not
+    //   reliable for serialized messages): its late answers are received,
+    //   and used if they arrive during the same eval() call (the batch is
+    //   not evaluated again if it has not been sent yet); once all of them
+    //   are in, the worker is only slow and goes back to the pool
+    // - while waiting for the results, the master polls the requests with
+    //   an exponential back-off (from min_poll to max_poll seconds), so
+    //   that it does not take a core from a worker of the same node
+    // - a batch is evaluated by eval_chunk(), which is serial here (see
+    //   MpiParallel for a multi-threaded version)
+    // - the evaluations are always finished, even after a stop request
+    //   with a deadline (see misc::check_abandon()): a worker cannot
+    //   abandon its batch, and neither can the master while requests are
+    //   outstanding
     SFERES_EVAL(Mpi, Eval) {
     public:
-      Mpi() {
+      SFERES_CONST double max_overhead = 0.1;
+      SFERES_CONST double smoothing = 0.5;
+      SFERES_CONST size_t max_batch_size = 4096;
+      SFERES_CONST double timeout_factor = 10;
+      SFERES_CONST double min_poll = 1e-5;
+      SFERES_CONST double max_poll = 1e-3;
+
+      Mpi() : _overhead(-1), _min_timeout(-1), _call(0), _nb_recovered(0) {
         static char* argv[] = {(char*)"sferes2", 0x0};
         char** argv2 = (char**) malloc(sizeof(char*) * 2);
         int argc = 1;
@@ -59,7 +160,9 @@ namespace sferes {
         argv2[1] = argv[1];
         using namespace boost;
         dbg::out(dbg::info, "mpi")<<"Initializing MPI..."<<std::endl;
-        _env = shared_ptr<mpi::environment>(new mpi::environment(argc, argv2, true));
+        // only the main thread of each rank calls MPI
+        _env = shared_ptr<mpi::environment>
+               (new mpi::environment(argc, argv2, mpi::threading::funneled, true));
         dbg::out(dbg::info, "mpi")<<"MPI initialized"<<std::endl;
         _world = shared_ptr<mpi::communicator>(new mpi::communicator());
         MPI_INFO << "communicator initialized"<<std::endl;
@@ -69,22 +172,90 @@ namespace sferes {
                 size_t begin, size_t end,
                 const typename Phen::fit_t& fit_proto) {
         dbg::trace("mpi", DBG_HERE);
-        if (_world->rank() == 0)
-        {
-          _master_loop(pop, begin, end);
+        if (_world->rank() == 0) {
+          if (_world->size() == 1)
+            stc::exact(this)->eval_chunk(pop, begin, end, fit_proto);
+          else
+            _master_loop(pop, begin, end, fit_proto);
           this->_nb_evals += (end - begin);
-        }
-        else
+        } else
           _slave_loop<Phen>(fit_proto);
       }
       ~Mpi() {
         MPI_INFO << "Finalizing MPI..."<<std::endl;
-        std::string s("bye");
+        // a dead worker might only be late: it also needs to be stopped,
+        // but we do not wait for it
         if (_world->rank() == 0)
-          for (size_t i = 1; i < _world->size(); ++i)
-            _world->send(i, _env->max_tag(), s);
+          for (int i = 1; i < _world->size(); ++i)
+            if (_alive.empty() || _alive[i - 1])
+              _world->send(i, _mpi::tag_quit);
+            else
+              _lost.push_back(_world->isend(i, _mpi::tag_quit));
         _finalize();
       }
+      // evaluate pop[begin..end[ in this process (used by the workers)
+      template<typename Phen>
+      void eval_chunk(std::vector<boost::shared_ptr<Phen> >& pop,
+                      size_t begin, size_t end,
+                      const typename Phen::fit_t& fit_proto) {
+        for (size_t i = begin; i < end; ++i) {
+          pop[i]->fit() = fit_proto;
+          pop[i]->develop();
+          pop[i]->fit().eval(*pop[i]);
+        }
+      }
+      // number of individuals that eval_chunk() evaluates at the same time
+      size_t nb_worker_threads() const {
+        return 1;
+      }
+      size_t nb_workers() const {
+        return _world->size() - 1;
+      }
+      // current number of genotypes per message for the worker w (w >= 1)
+      size_t batch_size(size_t w) const {
+        assert(w >= 1 && w <= _batch_size.size());
+        return _batch_size[w - 1];
+      }
+      // estimated time per individual of the worker w (s), -1 if unknown
+      double eval_time(size_t w) const {
+        assert(w >= 1 && w <= _eval_time.size());
+        return _eval_time[w - 1];
+      }
+      // estimated communication overhead of a batch (s)
+      double overhead() const {
+        return _overhead;
+      }
+      // number of individuals per second of the worker w, 0 if unknown
+      double throughput(size_t w) const {
+        return eval_time(w) > 0 ? 1.0 / eval_time(w) : 0;
+      }
+      bool alive(size_t w) const {
+        assert(w >= 1 && w <= _alive.size());
+        return _alive[w - 1];
+      }
+      // number of timeouts of the worker w
+      size_t failures(size_t w) const {
+        assert(w >= 1 && w <= _failures.size());
+        return _failures[w - 1];
+      }
+      // number of individuals evaluated by the worker w
+      size_t nb_evaluated(size_t w) const {
+        assert(w >= 1 && w <= _nb_evaluated.size());
+        return _nb_evaluated[w - 1];
+      }
+      // shortest time (s) before a worker is declared dead, and the only
+      // bound of the batches of the workers with an unknown evaluation time
+      // (< 0, the default: no bound for them)
+      double min_timeout() const {
+        return _min_timeout;
+      }
+      void set_min_timeout(double t) {
+        _min_timeout = t;
+      }
+      // number of individuals whose fitness came from a late answer
+      size_t nb_recovered() const {
+        return _nb_recovered;
+      }
     protected:
       void _finalize() {
         _world = boost::shared_ptr<boost::mpi::communicator>();
@@ -92,76 +263,344 @@ namespace sferes {
         _env = boost::shared_ptr<boost::mpi::environment>();
         dbg::out(dbg::info, "mpi")<<"environment destroyed"<<std::endl;
       }
+      void _init_workers() {
+        size_t nb_workers = _world->size() - 1;
+        if (_batch_size.size() == nb_workers)
+          return;
+        _batch_size.resize(nb_workers, 1);
+        _eval_time.resize(nb_workers, -1);
+        _nb_threads.resize(nb_workers, 1);
+        _alive.resize(nb_workers, true);
+        _failures.resize(nb_workers, 0);
+        _nb_evaluated.resize(nb_workers, 0);
+      }
+      // size of the next batch of the worker w, given the number of
+      // individuals that still have to be sent: the last batches are
+      // smaller, so that all the workers finish at about the same time
+      size_t _next_batch_size(size_t w, size_t remaining) const {
+        size_t nb_workers = _world->size() - 1;
+        // equal shares until all the workers have been measured
+        size_t nb_alive = std::count(_alive.begin(), _alive.end(), true);
+        double share = 1.0 / nb_alive;
+        double sum = 0;
+        bool measured = true;
+        for (size_t i = 0; i < nb_workers; ++i)
+          if (!_alive[i])
+            continue;
+          else if (_eval_time[i] > 0)
+            sum += 1.0 / _eval_time[i];
+          else
+            measured = false;
+        if (measured)
+          share = 1.0 / _eval_time[w - 1] / sum;
+        size_t bound = std::max(_nb_threads[w - 1],
+                                (size_t) (remaining * share / _mpi::nb_slots));
+        size_t k = std::min(_batch_size[w - 1], bound);
+        return std::max<size_t>(1, std::min(k, remaining));
+      }
+      void _update_batch_size(size_t w) {
+        if (_overhead < 0 || _eval_time[w - 1] <= 0)
+          return;
+        double k = std::min<double>(max_batch_size,
+                                    ceil(_overhead / (max_overhead * _eval_time[w - 1])));
+        // enough individuals to keep all the threads of the worker busy
+        _batch_size[w - 1] = std::max(_nb_threads[w - 1], (size_t) k);
+      }
+      // the individuals that still have to be sent: the batches of the
+      // dead workers (todo) then [current, end)
+      struct _work_t {
+        std::deque<std::pair<size_t, size_t> > todo;
+        size_t current, end;
+        size_t remaining() const {
+          size_t n = end - current;
+          for (size_t i = 0; i < todo.size(); ++i)
+            n += todo[i].second - todo[i].first;
+          return n;
+        }
+        // [b, e) does not have to be sent anymore
+        void remove(size_t b, size_t e) {
+          std::deque<std::pair<size_t, size_t> > t;
+          for (size_t i = 0; i < todo.size(); ++i) {
+            if (todo[i].second <= b || todo[i].first >= e) {
+              t.push_back(todo[i]);
+              continue;
+            }
+            if (todo[i].first < b)
+              t.push_back(std::make_pair(todo[i].first, b));
+            if (todo[i].second > e)
+              t.push_back(std::make_pair(e, todo[i].second));
+          }
+          todo.swap(t);
+        }
+        void next(size_t k, size_t& b, size_t& e) {
+          if (todo.empty()) {
+            b = current;
+            e = current = std::min(current + k, end);
+          } else {
+            b = todo.front().first;
+            e = std::min(b + k, todo.front().second);
+            if (e == todo.front().second)
+              todo.pop_front();
+            else
+              todo.front().first = e;
+          }
+        }
+      };
       template<typename Phen>
-      void _master_loop(std::vector<boost::shared_ptr<Phen> >& pop,
-                        size_t begin, size_t end) {
-        dbg::trace("mpi", DBG_HERE);
-        size_t current = begin;
-        std::vector<bool> evaluated(pop.size());
-        std::fill(evaluated.begin(), evaluated.end(), false);
-        // first round
-        for (size_t i = 1; i < _world->size() && current < end; ++i) {
-          MPI_INFO << "[master] [send-init...] ->" <<i<<" [indiv="<<current<<"]"<<std::endl;
-          _world->send(i, current, pop[current]->gen());
-          MPI_INFO << "[master] [send-init ok] ->" <<i<<" [indiv="<<current<<"]"<<std::endl;
-          ++current;
+      void _send(std::vector<boost::shared_ptr<Phen> >& pop,
+                 std::vector<_mpi::slot<typename Phen::fit_t> >& slots,
+                 int worker, size_t s, _work_t& work) {
+        typedef typename Phen::gen_t gen_t;
+        typedef _mpi::slot<typename Phen::fit_t> slot_t;
+        slot_t& sl = slots[(worker - 1) * _mpi::nb_slots + s];
+        assert(!sl.busy);
+        sl.send_req.wait();
+        work.next(_next_batch_size(worker, work.remaining()), sl.begin, sl.end);
+        std::vector<gen_t> gens;
+        gens.reserve(sl.end - sl.begin);
+        for (size_t i = sl.begin; i < sl.end; ++i)
+          gens.push_back(pop[i]->gen());
+        if (!sl.res)
+          sl.res.reset(new _mpi::result<typename Phen::fit_t>());
+        sl.busy = true;
+        sl.alone = true;
+        size_t queued = sl.end - sl.begin;
+        for (size_t t = 0; t < _mpi::nb_slots; ++t) {
+          const slot_t& o = slots[(worker - 1) * _mpi::nb_slots + t];
+          if (t != s && o.busy) {
+            sl.alone = false;
+            queued += o.end - o.begin;
+          }
         }
-        // send a new indiv each time we received a fitness
-        while (current < end) {
-          boost::mpi::status s = _recv(evaluated, pop);
-          MPI_INFO << "[master] [send...] ->" <<s.source()<<" [indiv="<<current<<"]"<<std::endl;
-          _world->send(s.source(), current, pop[current]->gen());
-          MPI_INFO << "[master] [send ok] ->" <<s.source()<<" [indiv="<<current<<"]"<<std::endl;
-          ++current;
+        sl.sent = MPI_Wtime();
+        if (_eval_time[worker - 1] > 0) {
+          double expected = queued * _eval_time[worker - 1] / _nb_threads[worker - 1]
+                            + std::max(0.0, _overhead);
+          sl.deadline = sl.sent + std::max(_min_timeout, timeout_factor * expected);
+        } else if (_min_timeout >= 0)
+          sl.deadline = sl.sent + _min_timeout;
+        else
+          sl.deadline = std::numeric_limits<double>::max();
+        MPI_INFO << "[master] [send] ->" << worker << " [indivs="
+                 << sl.begin << "-" << sl.end << "]" << std::endl;
+        // the genotypes are serialized by isend (the archive is kept alive
+        // by the request), gens can be destroyed
+        sl.send_req = _world->isend(worker, _mpi::tag_work + s, gens);
+        sl.req = _world->irecv(worker, _mpi::tag_result + s, *sl.res);
+      }
+      // remove the worker w from the pool; its batches will be sent to the
+      // other workers
+      template<typename Slot>
+      void _fail(size_t w, std::vector<Slot>& slots, _work_t& work) {
+        MPI_INFO << "[master] worker " << w << " timed out" << std::endl;
+        _alive[w - 1] = false;
+        ++_failures[w - 1];
+        for (size_t s = 0; s < _mpi::nb_slots; ++s) {
+          Slot& sl = slots[(w - 1) * _mpi::nb_slots + s];
+          if (!sl.busy)
+            continue;
+          // the answer might only be late (see _drain_late())
+          _mpi::late l;
+          l.worker = w;
+          l.call = _call;
+          l.begin = sl.begin;
+          l.end = sl.end;
+          l.req = sl.req;
+          l.res = sl.res;
+          _late.push_back(l);
+          sl.res.reset();
+          // the buffer of the request must outlive MPI
+          _lost.push_back(sl.send_req);
+          sl.req = boost::mpi::request();
+          sl.send_req = boost::mpi::request();
+          sl.busy = false;
+          work.todo.push_back(std::make_pair(sl.begin, sl.end));
         }
-        //join
-        bool done = true;
-        do {
-          dbg::out(dbg::info, "mpi")<<"joining..."<<std::endl;
-          done = true;
-          for (size_t i = begin; i < end; ++i)
-            if (!evaluated[i]) {
-              _recv(evaluated, pop);
-              done = false;
+      }
+      // receive the late answers of the dead workers: the fitnesses of the
+      // current eval() call are used (those of the previous calls are
+      // discarded); a worker that has no answer left to receive goes back
+      // to the pool
+      template<typename Phen>
+      void _drain_late(std::vector<boost::shared_ptr<Phen> >& pop, _work_t& work) {
+        typedef _mpi::result<typename Phen::fit_t> result_t;
+        for (std::list<_mpi::late>::iterator it = _late.begin(); it != _late.end();)
+          if (it->req.test()) {
+            size_t w = it->worker;
+            MPI_INFO << "[master] late answer of worker " << w << std::endl;
+            if (it->call == _call) {
+              const result_t& res = *boost::static_pointer_cast<result_t>(it->res);
+              assert(res.fits.size() == it->end - it->begin);
+              for (size_t j = it->begin; j < it->end; ++j)
+                pop[j]->fit() = res.fits[j - it->begin];
+              size_t remaining = work.remaining();
+              work.remove(it->begin, it->end);
+              _nb_recovered += remaining - work.remaining();
+              _nb_evaluated[w - 1] += it->end - it->begin;
             }
-        } while (!done);
+            it = _late.erase(it);
+            bool pending = false;
+            for (std::list<_mpi::late>::const_iterator l = _late.begin(); l != _late.end(); ++l)
+              pending = pending || l->worker == w;
+            if (!pending)
+              _alive[w - 1] = true;
+          } else
+            ++it;
       }
       template<typename Phen>
-      boost::mpi::status _recv(std::vector<bool>& evaluated,
-                               std::vector<boost::shared_ptr<Phen> >& pop) {
+      void _master_loop(std::vector<boost::shared_ptr<Phen> >& pop,
+                        size_t begin, size_t end,
+                        const typename Phen::fit_t& fit_proto) {
         dbg::trace("mpi", DBG_HERE);
-        using namespace boost::mpi;
-        status s = _world->probe();
-        MPI_INFO << "[rcv...]" << getpid() << " tag=" << s.tag() << std::endl;
-        _world->recv(s.source(), s.tag(), pop[s.tag()]->fit());
-        MPI_INFO << "[rcv ok]" << " tag=" << s.tag() << std::endl;
-        evaluated[s.tag()] = true;
-        return s;
+        typedef _mpi::slot<typename Phen::fit_t> slot_t;
+        _init_workers();
+        size_t nb_workers = _world->size() - 1;
+        std::vector<slot_t> slots(nb_workers * _mpi::nb_slots);
+        _work_t work;
+        work.current = begin;
+        work.end = end;
+        std::vector<boost::mpi::request> reqs;
+        std::vector<size_t> busy;
+        double poll = min_poll;
+        ++_call;
+        _drain_late(pop, work);
+        while (true) {
+          // fill the free slots of the live workers (one batch per worker
+          // first)
+          for (size_t s = 0; s < _mpi::nb_slots; ++s)
+            for (size_t w = 1; w <= nb_workers && work.remaining(); ++w)
+              if (_alive[w - 1] && !slots[(w - 1) * _mpi::nb_slots + s].busy)
+                _send(pop, slots, w, s, work);
+          // no worker left: evaluate the remaining individuals here, a few
+          // at a time, until a late answer brings a worker back
+          if (std::find(_alive.begin(), _alive.end(), true) == _alive.end()
+              && work.remaining()) {
+            MPI_INFO << "[master] no worker left" << std::endl;
+            size_t b, e;
+            while (work.remaining()
+                   && std::find(_alive.begin(), _alive.end(), true) == _alive.end()) {
+              work.next(stc::exact(this)->nb_worker_threads(), b, e);
+              stc::exact(this)->eval_chunk(pop, b, e, fit_proto);
+              _drain_late(pop, work);
+            }
+            continue;
+          }
+          reqs.clear();
+          busy.clear();
+          for (size_t i = 0; i < slots.size(); ++i)
+            if (slots[i].busy) {
+              reqs.push_back(slots[i].req);
+              busy.push_back(i);
+            }
+          if (reqs.empty())
+            break;
+          boost::optional<std::pair<boost::mpi::status,
+                std::vector<boost::mpi::request>::iterator> >
+                r = boost::mpi::test_any(reqs.begin(), reqs.end());
+          if (!r) {
+            double t = MPI_Wtime();
+            double deadline = std::numeric_limits<double>::max();
+            for (size_t j = 0; j < busy.size(); ++j)
+              if (slots[busy[j]].busy && t > slots[busy[j]].deadline)
+                _fail(busy[j] / _mpi::nb_slots + 1, slots, work);
+              else if (slots[busy[j]].busy)
+                deadline = std::min(deadline, slots[busy[j]].deadline);
+            _drain_late(pop, work);
+            // back-off (but do not sleep past the next deadline)
+            double d = std::max(0.0, std::min(poll, deadline - t));
+            std::this_thread::sleep_for(std::chrono::duration<double>(d));
+            poll = std::min(2 * poll, max_poll);
+            continue;
+          }
+          poll = min_poll;
+          size_t i = busy[r->second - reqs.begin()];
+          slot_t& sl = slots[i];
+          double rtt = MPI_Wtime() - sl.sent;
+          sl.busy = false;
+          const _mpi::result<typename Phen::fit_t>& res = *sl.res;
+          assert(res.fits.size() == sl.end - sl.begin);
+          MPI_INFO << "[master] [rcv] <-" << r->first.source() << " [indivs="
+                   << sl.begin << "-" << sl.end << "]" << std::endl;
+          for (size_t j = sl.begin; j < sl.end; ++j)
+            pop[j]->fit() = res.fits[j - sl.begin];
+          size_t w = i / _mpi::nb_slots + 1;
+          _nb_evaluated[w - 1] += sl.end - sl.begin;
+          _nb_threads[w - 1] = std::max(1u, res.nb_threads);
+          _update_times(w, sl.end - sl.begin, res.time, sl.alone ? rtt : -1);
+        }
+        for (size_t i = 0; i < slots.size(); ++i)
+          if (_alive[i / _mpi::nb_slots])
+            slots[i].send_req.wait();
+          else
+            _lost.push_back(slots[i].send_req);
+      }
+      // exponential moving averages of the evaluation time (per individual)
+      // and of the communication overhead (per batch); the overhead is only
+      // measured for batches that did not wait behind another batch
+      void _update_times(size_t w, size_t k, double time, double rtt) {
+        double t = time / k;
+        double& e = _eval_time[w - 1];
+        e = e < 0 ? t : smoothing * e + (1 - smoothing) * t;
+        if (rtt >= 0) {
+          double o = std::max(0.0, rtt - time);
+          _overhead = _overhead < 0 ? o : smoothing * _overhead + (1 - smoothing) * o;
+        }
+        _update_batch_size(w);
       }
       template<typename Phen>
       void _slave_loop(const typename Phen::fit_t& fit_proto) {
         dbg::trace("mpi", DBG_HERE);
+        typedef typename Phen::gen_t gen_t;
+        typedef _mpi::result<typename Phen::fit_t> result_t;
+        // the answer to the previous batch might still be in flight
+        // while we evaluate the next one
+        std::vector<result_t> res(_mpi::nb_slots);
+        std::vector<boost::mpi::request> sent(_mpi::nb_slots);
+        std::vector<bool> pending(_mpi::nb_slots, false);
+        std::vector<gen_t> gens;
+        std::vector<boost::shared_ptr<Phen> > pop;
         while(true) {
-          Phen p;
-          boost::mpi::status s = _world->probe();
-          if (s.tag() == _env->max_tag()) {
+          boost::mpi::status s = _world->probe(0, boost::mpi::any_tag);
+          if (s.tag() == _mpi::tag_quit) {
             MPI_INFO << "[slave] Quit requested" << std::endl;
+            for (size_t i = 0; i < _mpi::nb_slots; ++i)
+              if (pending[i])
+                sent[i].wait();
+            _world->recv(0, _mpi::tag_quit);
             MPI_Finalize();
             exit(0);
-          } else {
-            MPI_INFO <<"[slave] [rcv...] [" << getpid()<< "]" << std::endl;
-            _world->recv(0, s.tag(), p.gen());
-            MPI_INFO <<"[slave] [rcv ok] " << " tag="<<s.tag()<<std::endl;
-            p.fit() = fit_proto;
-            p.develop();
-            p.fit().eval(p);
-            MPI_INFO <<"[slave] [send...]"<<" tag=" << s.tag()<<std::endl;
-            _world->send(0, s.tag(), p.fit());
-            MPI_INFO <<"[slave] [send ok]"<<" tag=" << s.tag()<<std::endl;
-
           }
+          size_t slot = s.tag() - _mpi::tag_work;
+          assert(slot < _mpi::nb_slots);
+          if (pending[slot])
+            sent[slot].wait();
+          MPI_INFO <<"[slave] [rcv...] [" << getpid()<< "]" << std::endl;
+          _world->recv(0, s.tag(), gens);
+          MPI_INFO <<"[slave] [rcv ok] " << " size="<<gens.size()<<std::endl;
+          double t = MPI_Wtime();
+          pop.resize(gens.size());
+          for (size_t i = 0; i < gens.size(); ++i) {
+            pop[i] = misc::Pool<Phen>::create();
+            pop[i]->gen() = gens[i];
+          }
+          stc::exact(this)->eval_chunk(pop, 0, pop.size(), fit_proto);
+          res[slot].fits.resize(pop.size());
+          for (size_t i = 0; i < pop.size(); ++i)
+            res[slot].fits[i] = pop[i]->fit();
+          res[slot].time = MPI_Wtime() - t;
+          res[slot].nb_threads = stc::exact(this)->nb_worker_threads();
+          MPI_INFO <<"[slave] [send]"<<" slot=" << slot << std::endl;
+          sent[slot] = _world->isend(0, _mpi::tag_result + slot, res[slot]);
+          pending[slot] = true;
         }
       }
+      std::vector<size_t> _batch_size, _nb_threads, _failures, _nb_evaluated;
+      std::vector<double> _eval_time;
+      std::vector<bool> _alive;
+      std::vector<boost::mpi::request> _lost;
+      std::list<_mpi::late> _late;
+      double _overhead, _min_timeout;
+      size_t _call, _nb_recovered;
       boost::shared_ptr<boost::mpi::environment> _env;
       boost::shared_ptr<boost::mpi::communicator> _world;
     };
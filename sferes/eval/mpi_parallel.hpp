@@ -0,0 +1,73 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+#ifndef EVAL_MPI_PARALLEL_HPP_
+#define EVAL_MPI_PARALLEL_HPP_
+
+#include <sferes/parallel.hpp>
+#include <sferes/eval/parallel.hpp>
+#include <sferes/eval/mpi.hpp>
+
+namespace sferes {
+  namespace eval {
+    // Hybrid MPI+TBB evaluation: same protocol as Mpi, but each worker
+    // evaluates its batches with all its threads (like eval::Parallel).
+    // The intended setup is one rank per node, e.g.:
+    //   mpirun --map-by ppr:1:node ./my_exp
+    // so that the simulator is loaded once per node and there are fewer,
+    // larger messages. The batches are at least as large as the number of
+    // threads of the worker, and the master gives more individuals to the
+    // workers with a higher throughput. Like in Mpi, the evaluations are
+    // not abandoned after a stop request.
+    SFERES_EVAL(MpiParallel, Mpi) {
+    public:
+      template<typename Phen>
+      void eval_chunk(std::vector<boost::shared_ptr<Phen> >& pop,
+                      size_t begin, size_t end,
+                      const typename Phen::fit_t& fit_proto) {
+        parallel::init();
+        parallel::p_for(parallel::range_t(begin, end),
+                        _parallel_evaluate<Phen>(pop, fit_proto, false));
+      }
+      size_t nb_worker_threads() const {
+        return parallel::nb_threads();
+      }
+    };
+  }
+}
+
+#endif
@@ -38,26 +38,57 @@
 #ifndef EVAL_PARALLEL_HPP_
 #define EVAL_PARALLEL_HPP_
 
-#include <sferes/parallel.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/weak_ptr.hpp>
+#include <sferes/stc.hpp>
+#include <sferes/parallel.hpp>
+#include <sferes/misc/rand.hpp>
+#include <sferes/misc/stop.hpp>
 #include <sferes/eval/eval.hpp>
 
 namespace sferes {
 
   namespace eval {
+    // the fitness of Phen predicts the evaluation time of an individual
+    // before its evaluation: float expected_cost(const Phen&) const
+    template<typename Phen, typename Enable = void>
+    struct has_expected_cost {
+      SFERES_CONST bool value = false;
+    };
+    template<typename Phen>
+    struct has_expected_cost<Phen, typename stc::Void<decltype(std::declval<const typename Phen::fit_t&>().expected_cost(std::declval<const Phen&>()))>::type> {
+      SFERES_CONST bool value = true;
+    };
+
+    // abandon = false: the evaluations are always finished (e.g. by the MPI
+    // workers, which cannot throw misc::abandoned to the master)
     template<typename Phen>
     struct _parallel_evaluate {
       typedef std::vector<boost::shared_ptr<Phen> > pop_t;
       typedef typename Phen::fit_t fit_t;
-      pop_t _pop;
-      fit_t _fit;
+      pop_t& _pop;
+      const fit_t& _fit;
+      uint32_t _stream;
+      bool _abandon;
 
       ~_parallel_evaluate() { }
-      _parallel_evaluate(pop_t& pop, const fit_t& fit) : _pop(pop), _fit(fit) {}
-      _parallel_evaluate(const _parallel_evaluate& ev) : _pop(ev._pop), _fit(ev._fit) {}
+      _parallel_evaluate(pop_t& pop, const fit_t& fit, bool abandon = true) :
+        _pop(pop), _fit(fit), _stream(misc::rand_stream()), _abandon(abandon) {}
+      _parallel_evaluate(const _parallel_evaluate& ev) :
+        _pop(ev._pop), _fit(ev._fit), _stream(ev._stream), _abandon(ev._abandon) {}
       void operator() (const parallel::range_t& r) const {
         for (size_t i = r.begin(); i != r.end(); ++i) {
           assert(i < _pop.size());
+          if (_abandon)
+            misc::check_abandon();
+          misc::rand_scope scope(_stream, i);
           _pop[i]->fit() = _fit;
           _pop[i]->develop();
           _pop[i]->fit().eval(*_pop[i]);
@@ -68,21 +99,167 @@ namespace sferes {
       }
     };
 
+    // each iteration evaluates the next individual of order (whatever
+    // the range), so that the individuals are started in this order by
+    // the threads that become idle (list scheduling); the evaluation time
+    // of pop[order[k]] is written to costs[k]
+    template<typename Phen>
+    struct _ordered_evaluate {
+      typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+      typedef typename Phen::fit_t fit_t;
+      typedef std::chrono::steady_clock clock_t;
+      pop_t& _pop;
+      const fit_t& _fit;
+      const std::vector<size_t>& _order;
+      std::atomic<size_t>& _next;
+      std::vector<float>& _costs;
+      uint32_t _stream;
+
+      ~_ordered_evaluate() { }
+      _ordered_evaluate(pop_t& pop, const fit_t& fit,
+                        const std::vector<size_t>& order,
+                        std::atomic<size_t>& next,
+                        std::vector<float>& costs) :
+        _pop(pop), _fit(fit), _order(order), _next(next), _costs(costs),
+        _stream(misc::rand_stream()) {}
+      _ordered_evaluate(const _ordered_evaluate& ev) :
+        _pop(ev._pop), _fit(ev._fit), _order(ev._order), _next(ev._next), _costs(ev._costs),
+        _stream(ev._stream) {}
+      void operator() (const parallel::range_t& r) const {
+        for (size_t it = r.begin(); it != r.end(); ++it) {
+          size_t k = _next++;
+          assert(k < _order.size());
+          size_t i = _order[k];
+          assert(i < _pop.size());
+          // (the random numbers depend on the individual, not on the order)
+          misc::check_abandon();
+          misc::rand_scope scope(_stream, i);
+          clock_t::time_point t = clock_t::now();
+          _pop[i]->fit() = _fit;
+          _pop[i]->develop();
+          _pop[i]->fit().eval(*_pop[i]);
+          _costs[k] = std::chrono::duration<float>(clock_t::now() - t).count();
+          for (size_t j = 0; j < _pop[i]->fit().objs().size(); ++j) {
+            assert(!std::isnan(_pop[i]->fit().objs()[j]));
+          }
+        }
+      }
+    };
+
+    // - the population is not copied, and each task evaluates a single
+    //   individual (simple partitioner, grain size 1), so that idle
+    //   threads steal the remaining evaluations
+    // - the evaluation time of each individual is measured; an individual
+    //   that is evaluated again (e.g. a survivor in RankSimple, or with
+    //   EA_EVAL_ALL) is expected to take as long as the last time; the
+    //   time of a new one is predicted by the fitness if it defines
+    //   float expected_cost(const Phen&) const (from the genotype, e.g.
+    //   the size of a network; the individual is not developed yet), and
+    //   is the average time otherwise: the longest evaluations are started
+    //   first (LPT scheduling)
+    // - makespan(), idle_time() and costs() describe the last call to
+    //   eval() (see stat::EvalCost)
     SFERES_EVAL(Parallel, Eval) {
     public:
+      Parallel() : _makespan(0), _idle_time(0), _mean_cost(0) {}
+
       template<typename Phen>
       void eval(std::vector<boost::shared_ptr<Phen> >& pop, size_t begin, size_t end,
                 const typename Phen::fit_t& fit_proto) {
         dbg::trace trace("eval", DBG_HERE);
+        typedef std::chrono::steady_clock clock_t;
         assert(pop.size());
         assert(begin < pop.size());
         assert(end <= pop.size());
         parallel::init();
-        parallel::p_for(parallel::range_t(begin, end),
-                        _parallel_evaluate<Phen>(pop, fit_proto));
+
+        // longest (expected) evaluations first
+        _estimates.resize(end - begin);
+        _order.resize(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+          _estimates[i - begin] = estimate(pop[i]);
+          _order[i - begin] = i;
+        }
+        std::stable_sort(_order.begin(), _order.end(), _compare_estimates(_estimates, begin));
+
+        _costs.resize(end - begin);
+        std::atomic<size_t> next(0);
+        clock_t::time_point t = clock_t::now();
+        parallel::p_for_each(begin, end,
+                             _ordered_evaluate<Phen>(pop, fit_proto, _order, next, _costs));
+        _makespan = std::chrono::duration<float>(clock_t::now() - t).count();
         this->_nb_evals += (end - begin);
+
+        // costs in the order of the population
+        _last_costs.clear();
+        float total = 0;
+        for (size_t k = 0; k < _order.size(); ++k) {
+          const boost::shared_ptr<Phen>& p = pop[_order[k]];
+          _last_costs[p.get()] = std::make_pair(boost::weak_ptr<void>(p), _costs[k]);
+          _estimates[_order[k] - begin] = _costs[k];
+          total += _costs[k];
+        }
+        _costs.swap(_estimates);
+        _mean_cost = total / _costs.size();
+        _idle_time = std::max(0.0f, parallel::nb_threads() * _makespan - total);
+      }
+
+      // wall-clock time of the last call to eval() (in seconds)
+      float makespan() const {
+        return _makespan;
+      }
+      // time spent by the threads without evaluating anything during
+      // the last call to eval() (in seconds)
+      float idle_time() const {
+        return _idle_time;
       }
+      // evaluation time of each individual of the last call to eval()
+      // (in seconds, in the order of the population)
+      const std::vector<float>& costs() const {
+        return _costs;
+      }
+      // expected evaluation time of an individual: its last evaluation
+      // time if it was evaluated by the last call to eval(), the
+      // prediction of its fitness (see has_expected_cost) or the mean
+      // evaluation time otherwise
+      template<typename Phen>
+      float estimate(const boost::shared_ptr<Phen>& p) const {
+        typename cost_map_t::const_iterator it = _last_costs.find(p.get());
+        if (it == _last_costs.end() || !_same_owner(it->second.first, p))
+          return _predict(*p, std::integral_constant<bool, has_expected_cost<Phen>::value>());
+        return it->second.second;
+      }
+
+    protected:
+      // the addresses are recycled by misc::Pool: an estimate is only
+      // used if the individual at this address is still the one that was
+      // evaluated (same shared_ptr control block)
+      typedef std::unordered_map<const void*, std::pair<boost::weak_ptr<void>, float> > cost_map_t;
+      template<typename T>
+      static bool _same_owner(const boost::weak_ptr<void>& w, const boost::shared_ptr<T>& p) {
+        return !w.expired() && !w.owner_before(p) && !p.owner_before(w);
+      }
+      template<typename Phen>
+      float _predict(const Phen& p, std::true_type) const {
+        return p.fit().expected_cost(p);
+      }
+      template<typename Phen>
+      float _predict(const Phen& p, std::false_type) const {
+        return _mean_cost;
+      }
+      struct _compare_estimates {
+        const std::vector<float>& e;
+        size_t begin;
+        _compare_estimates(const std::vector<float>& e_, size_t b) : e(e_), begin(b) {}
+        bool operator()(size_t i1, size_t i2) const {
+          return e[i1 - begin] > e[i2 - begin];
+        }
+      };
 
+      float _makespan, _idle_time, _mean_cost;
+      std::vector<float> _costs, _estimates;
+      std::vector<size_t> _order;
+      cost_map_t _last_costs;
     };
 
   }
@@ -0,0 +1,317 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+#ifndef DESC_MATRIX_HPP_
+#define DESC_MATRIX_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <cassert>
+#include <type_traits>
+#include <sferes/stc.hpp>
+#include <sferes/misc/aligned_allocator.hpp>
+
+#if !defined(SFERES_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#elif !defined(SFERES_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sferes {
+  namespace fit {
+    // The (optional) behaviour descriptor contract, for the distance-based
+    // modifiers (modif::Novelty, modif::Diversity): a fitness that declares
+    //   SFERES_CONST size_t desc_size = N;
+    // and provides desc() (N floats, anything with operator[]) is compared
+    // with the euclidean distance between the descriptors, computed by
+    // blocks on a DescMatrix, instead of dist().
+    template<typename Fit, typename Enable = void>
+    struct has_desc : public std::false_type {};
+    template<typename Fit>
+    struct has_desc<Fit, typename stc::Void<decltype(Fit::desc_size)>::type>
+      : public std::true_type {};
+
+    // The descriptors of a set of individuals, stored like an ObjMatrix
+    // (component k of individual i is col(k)[i]), with their squared norms,
+    // so that the squared distances are ||a||^2 + ||b||^2 - 2 a.b, i.e. a
+    // product of matrices, computed by register blocks (see sq_dists()).
+    // These distances are not bit-identical to a direct (a - b)^2 sum, but
+    // the close points (for which the subtraction cancels) are computed
+    // directly, so that duplicates are at 0.
+    class DescMatrix {
+     public:
+      // the kernel of sq_dists() computes nb_queries x block_size distances
+      // at once, with AVX or SSE2 when available (define SFERES_NO_SIMD to
+      // use the scalar version)
+      SFERES_CONST size_t block_size = 8;
+      SFERES_CONST size_t nb_queries = 4;
+      // the callers of sq_dists() split the rows by tiles of tile_size, so
+      // that a tile stays in cache for a block of queries
+      SFERES_CONST size_t tile_size = 512;
+      // see sq_dists()
+      SFERES_CONST float refine_ratio = 1e-3f;
+
+      DescMatrix() : _size(0), _dim(0), _stride(0) {}
+
+      // empty, with descriptors of dim floats (keeps the storage if the
+      // dimension does not change)
+      void clear(size_t dim) {
+        if (dim != _dim) {
+          _dim = dim;
+          _stride = 0;
+          _data.clear();
+          _norms.clear();
+        }
+        _size = 0;
+      }
+      // room for n rows (the storage grows geometrically, so that push_back
+      // is amortized O(dim))
+      void reserve(size_t n) {
+        if (n <= _stride)
+          return;
+        size_t stride = std::max(n, 2 * _stride);
+        stride = (stride + block_size - 1) / block_size * block_size;
+        data_t data(stride * _dim);
+        for (size_t k = 0; k < _dim; ++k)
+          std::copy(col(k), col(k) + _size, &data[k * stride]);
+        _data.swap(data);
+        _norms.resize(stride);
+        _stride = stride;
+      }
+
+      template<typename Indiv>
+      void snapshot(const std::vector<Indiv>& pop) {
+        assert(!pop.empty());
+        clear(pop[0]->fit().desc_size);
+        reserve(pop.size());
+        _size = pop.size();
+        for (size_t i = 0; i < pop.size(); ++i)
+          set_row(i, pop[i]->fit().desc());
+      }
+      template<typename Desc>
+      void push_back(const Desc& x) {
+        reserve(_size + 1);
+        set_row(_size++, x);
+      }
+      template<typename Desc>
+      void set_row(size_t i, const Desc& x) {
+        assert(i < _size);
+        float n = 0;
+        for (size_t k = 0; k < _dim; ++k) {
+          col(k)[i] = x[k];
+          n += x[k] * x[k];
+        }
+        _norms[i] = n;
+      }
+      // removes the rows i such that removed[i], keeps the order of the others
+      void remove(const std::vector<bool>& removed) {
+        assert(removed.size() == _size);
+        size_t n = 0;
+        for (size_t i = 0; i < _size; ++i)
+          if (!removed[i]) {
+            for (size_t k = 0; k < _dim; ++k)
+              col(k)[n] = col(k)[i];
+            _norms[n++] = _norms[i];
+          }
+        _size = n;
+      }
+
+      size_t size() const {
+        return _size;
+      }
+      size_t dim() const {
+        return _dim;
+      }
+      size_t stride() const {
+        return _stride;
+      }
+      const float* col(size_t k) const {
+        assert(k < _dim);
+        return &_data[k * _stride];
+      }
+      float* col(size_t k) {
+        assert(k < _dim);
+        return &_data[k * _stride];
+      }
+      const float* norms() const {
+        return &_norms[0];
+      }
+      float operator()(size_t i, size_t k) const {
+        assert(i < _size);
+        assert(k < _dim);
+        return _data[k * _stride + i];
+      }
+
+      // the squared euclidean distances between the rows [b, e[ of q and
+      // the rows [jb, je[ of this matrix, to out[(i - b) * ld + (j - jb)]
+      // (the caller tiles [jb, je[, see tile_size; jb must be a multiple of
+      // block_size)
+      void sq_dists(const DescMatrix& q, size_t b, size_t e,
+                    size_t jb, size_t je, float* out, size_t ld) const {
+        assert(q.dim() == _dim);
+        assert(e <= q.size());
+        assert(je <= _size);
+        assert(jb % block_size == 0);
+        assert(je - jb <= ld);
+        const float* n = norms();
+        float dots[nb_queries * block_size];
+        for (size_t i = b; i < e; i += nb_queries) {
+          // (the last rows are repeated if e - i < nb_queries)
+          size_t rows[nb_queries];
+          for (size_t r = 0; r < nb_queries; ++r)
+            rows[r] = std::min(i + r, e - 1);
+          for (size_t j = jb; j < je; j += block_size) {
+            _dots(q, rows, j, dots);
+            size_t m = std::min(je - j, (size_t)block_size);
+            for (size_t r = 0; r < nb_queries && i + r < e; ++r) {
+              float* o = out + (i + r - b) * ld + (j - jb);
+              const float nq = q.norms()[rows[r]];
+              bool close = false;
+              for (size_t u = 0; u < m; ++u) {
+                o[u] = nq + n[j + u] - 2.0f * dots[r * block_size + u];
+                close |= o[u] < refine_ratio * (nq + n[j + u]);
+              }
+              // the close points lose most of their digits in the
+              // subtraction (e.g. a duplicate is not at 0): their distance
+              // is computed directly (they are few)
+              if (close)
+                for (size_t u = 0; u < m; ++u)
+                  if (o[u] < refine_ratio * (nq + n[j + u]))
+                    o[u] = _sq_dist(q, rows[r], j + u);
+            }
+          }
+        }
+      }
+     protected:
+      typedef std::vector<float, misc::aligned_allocator<float> > data_t;
+
+      // dots[r * block_size + u] = the dot product of the row rows[r] of q
+      // and the row j + u of this matrix (j is a multiple of block_size;
+      // the rows after size() are the padding)
+      void _dots(const DescMatrix& q, const size_t* rows, size_t j, float* dots) const {
+#if !defined(SFERES_NO_SIMD) && defined(__AVX__)
+        __m256 a[nb_queries][block_size / 8];
+        for (size_t r = 0; r < nb_queries; ++r)
+          for (size_t u = 0; u < block_size / 8; ++u)
+            a[r][u] = _mm256_setzero_ps();
+        for (size_t k = 0; k < _dim; ++k) {
+          const float* c = col(k) + j;
+          const float* x = q.col(k);
+          for (size_t u = 0; u < block_size / 8; ++u) {
+            __m256 v = _mm256_load_ps(c + u * 8);
+            for (size_t r = 0; r < nb_queries; ++r)
+              a[r][u] = _mm256_add_ps(a[r][u], _mm256_mul_ps(_mm256_set1_ps(x[rows[r]]), v));
+          }
+        }
+        for (size_t r = 0; r < nb_queries; ++r)
+          for (size_t u = 0; u < block_size / 8; ++u)
+            _mm256_storeu_ps(dots + r * block_size + u * 8, a[r][u]);
+#elif !defined(SFERES_NO_SIMD) && defined(__SSE2__)
+        __m128 a[nb_queries][block_size / 4];
+        for (size_t r = 0; r < nb_queries; ++r)
+          for (size_t u = 0; u < block_size / 4; ++u)
+            a[r][u] = _mm_setzero_ps();
+        for (size_t k = 0; k < _dim; ++k) {
+          const float* c = col(k) + j;
+          const float* x = q.col(k);
+          for (size_t u = 0; u < block_size / 4; ++u) {
+            __m128 v = _mm_load_ps(c + u * 4);
+            for (size_t r = 0; r < nb_queries; ++r)
+              a[r][u] = _mm_add_ps(a[r][u], _mm_mul_ps(_mm_set1_ps(x[rows[r]]), v));
+          }
+        }
+        for (size_t r = 0; r < nb_queries; ++r)
+          for (size_t u = 0; u < block_size / 4; ++u)
+            _mm_storeu_ps(dots + r * block_size + u * 4, a[r][u]);
+#else
+        std::fill(dots, dots + nb_queries * block_size, 0.0f);
+        for (size_t k = 0; k < _dim; ++k) {
+          const float* c = col(k) + j;
+          const float* x = q.col(k);
+          for (size_t r = 0; r < nb_queries; ++r)
+            for (size_t u = 0; u < block_size; ++u)
+              dots[r * block_size + u] += x[rows[r]] * c[u];
+        }
+#endif
+      }
+
+      float _sq_dist(const DescMatrix& q, size_t i, size_t j) const {
+        float s = 0;
+        for (size_t k = 0; k < _dim; ++k) {
+          float d = q.col(k)[i] - col(k)[j];
+          s += d * d;
+        }
+        return s;
+      }
+
+      size_t _size, _dim, _stride;
+      data_t _data;
+      data_t _norms;
+    };
+
+    // sum of the square roots of x[0 .. n[ (e.g. a row of sq_dists()), with
+    // AVX or SSE2 when available (the order of the sum is not the one of a
+    // simple loop)
+    inline float sum_sqrt(const float* x, size_t n) {
+      size_t i = 0;
+      float s = 0;
+#if !defined(SFERES_NO_SIMD) && defined(__AVX__)
+      __m256 a = _mm256_setzero_ps();
+      for (; i + 8 <= n; i += 8)
+        a = _mm256_add_ps(a, _mm256_sqrt_ps(_mm256_loadu_ps(x + i)));
+      float t[8];
+      _mm256_storeu_ps(t, a);
+      for (size_t u = 0; u < 8; ++u)
+        s += t[u];
+#elif !defined(SFERES_NO_SIMD) && defined(__SSE2__)
+      __m128 a = _mm_setzero_ps();
+      for (; i + 4 <= n; i += 4)
+        a = _mm_add_ps(a, _mm_sqrt_ps(_mm_loadu_ps(x + i)));
+      float t[4];
+      _mm_storeu_ps(t, a);
+      for (size_t u = 0; u < 4; ++u)
+        s += t[u];
+#endif
+      for (; i < n; ++i)
+        s += sqrtf(x[i]);
+      return s;
+    }
+  }
+}
+
+#endif
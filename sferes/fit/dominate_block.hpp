@@ -0,0 +1,151 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+
+#ifndef DOMINATE_BLOCK_HPP_
+#define DOMINATE_BLOCK_HPP_
+
+#include <cassert>
+#include <vector>
+#include <sferes/fit/obj_matrix.hpp>
+
+#if !defined(SFERES_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#elif !defined(SFERES_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// dominance kernel: compares one individual to a block of
+// ObjMatrix::block_size individuals of an ObjMatrix at once, using
+// AVX or SSE2 when available (define SFERES_NO_SIMD to use the scalar
+// version); the result is always the same as ObjMatrix::dominate_flag
+namespace sferes {
+  namespace fit {
+    namespace _dominate_block {
+      // bit j of better (resp. worse) is set if o is greater (resp. lower)
+      // than c[j]; c must be aligned (it is a column of an ObjMatrix)
+      inline void compare(float o, const float* c,
+                          unsigned& better, unsigned& worse) {
+#if !defined(SFERES_NO_SIMD) && defined(__AVX__)
+        __m256 v = _mm256_set1_ps(o);
+        for (size_t j = 0; j < ObjMatrix::block_size; j += 8) {
+          __m256 x = _mm256_load_ps(c + j);
+          better |= _mm256_movemask_ps(_mm256_cmp_ps(v, x, _CMP_GT_OQ)) << j;
+          worse |= _mm256_movemask_ps(_mm256_cmp_ps(v, x, _CMP_LT_OQ)) << j;
+        }
+#elif !defined(SFERES_NO_SIMD) && defined(__SSE2__)
+        __m128 v = _mm_set1_ps(o);
+        for (size_t j = 0; j < ObjMatrix::block_size; j += 4) {
+          __m128 x = _mm_load_ps(c + j);
+          better |= _mm_movemask_ps(_mm_cmpgt_ps(v, x)) << j;
+          worse |= _mm_movemask_ps(_mm_cmplt_ps(v, x)) << j;
+        }
+#else
+        for (size_t j = 0; j < ObjMatrix::block_size; ++j)
+          if (o > c[j])
+            better |= 1u << j;
+          else if (o < c[j])
+            worse |= 1u << j;
+#endif
+      }
+
+      inline unsigned valid(const ObjMatrix& objs, size_t b) {
+        size_t n = objs.size() - b;
+        return n >= ObjMatrix::block_size ? (1u << ObjMatrix::block_size) - 1 : (1u << n) - 1;
+      }
+    }
+
+    // compare o (the nb_objs() objectives of an individual) to the
+    // individuals b ... b + block_size - 1 of objs:
+    // - bit j of dominating is set if o dominates b + j
+    // - bit j of dominated is set if b + j dominates o
+    // (the bits beyond objs.size() are never set)
+    // M is the number of objectives (0 means objs.nb_objs())
+    template<size_t M>
+    inline void dominate_block(const float* o, const ObjMatrix& objs, size_t b,
+                               unsigned& dominating, unsigned& dominated) {
+      assert(M == 0 || M == objs.nb_objs());
+      assert(b % ObjMatrix::block_size == 0);
+      assert(b < objs.size());
+      const size_t nb_objs = M ? M : objs.nb_objs();
+      unsigned better = 0, worse = 0;
+      for (size_t k = 0; k < nb_objs; ++k)
+        _dominate_block::compare(o[k], objs.col(k) + b, better, worse);
+      unsigned v = _dominate_block::valid(objs, b);
+      dominating = better & ~worse & v;
+      dominated = worse & ~better & v;
+    }
+
+    // same, with the number of objectives known at run time
+    inline void dominate_block(const float* o, const ObjMatrix& objs, size_t b,
+                               unsigned& dominating, unsigned& dominated) {
+      switch (objs.nb_objs()) {
+      case 2:
+        dominate_block<2>(o, objs, b, dominating, dominated);
+        break;
+      case 3:
+        dominate_block<3>(o, objs, b, dominating, dominated);
+        break;
+      case 4:
+        dominate_block<4>(o, objs, b, dominating, dominated);
+        break;
+      case 5:
+        dominate_block<5>(o, objs, b, dominating, dominated);
+        break;
+      case 6:
+        dominate_block<6>(o, objs, b, dominating, dominated);
+        break;
+      default:
+        dominate_block<0>(o, objs, b, dominating, dominated);
+      }
+    }
+
+    // true if one of the individuals of objs dominates o
+    inline bool is_dominated(const float* o, const ObjMatrix& objs) {
+      for (size_t b = 0; b < objs.size(); b += ObjMatrix::block_size) {
+        unsigned dominating, dominated;
+        dominate_block(o, objs, b, dominating, dominated);
+        if (dominated)
+          return true;
+      }
+      return false;
+    }
+  }
+}
+
+#endif
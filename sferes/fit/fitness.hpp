@@ -62,6 +62,9 @@ namespace sferes {
       float value() const {
         return _value;
       }
+      void set_value(float v) {
+        _value = v;
+      }
       const std::vector<float>& objs() const {
         return _objs;
       }
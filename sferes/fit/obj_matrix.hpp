@@ -0,0 +1,211 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef OBJ_MATRIX_HPP_
+#define OBJ_MATRIX_HPP_
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <boost/shared_ptr.hpp>
+#include <sferes/stc.hpp>
+#include <sferes/misc/aligned_allocator.hpp>
+
+namespace sferes {
+  namespace fit {
+    // A snapshot of the objectives of a population, to be used by the
+    // O(N^2) loops (dominance, crowding, sorting) instead of following
+    // shared_ptr -> fit() -> objs() for each comparison.
+    // The storage is a structure of arrays: objective k of individual i
+    // is col(k)[i]; each column is aligned and padded to a multiple of
+    // block_size, so that several individuals can be compared at once.
+    class ObjMatrix {
+     public:
+      SFERES_CONST size_t block_size = 16;
+
+      ObjMatrix() : _size(0), _nb_objs(0), _stride(0) {}
+
+      // does not shrink the storage, so that a matrix can be reused
+      // from one generation to the next without allocation
+      void resize(size_t size, size_t nb_objs) {
+        _size = size;
+        _nb_objs = nb_objs;
+        _stride = (size + block_size - 1) / block_size * block_size;
+        if (_data.size() < _stride * nb_objs)
+          _data.resize(_stride * nb_objs);
+        // padding
+        for (size_t k = 0; k < nb_objs; ++k)
+          std::fill(col(k) + size, col(k) + _stride, 0.0f);
+      }
+
+      template<typename Indiv>
+      void snapshot(const std::vector<Indiv>& pop) {
+        assert(!pop.empty());
+        resize(pop.size(), pop[0]->fit().objs().size());
+        for (size_t i = 0; i < pop.size(); ++i)
+          set_row(i, pop[i]->fit().objs());
+      }
+
+      void set_row(size_t i, const std::vector<float>& objs) {
+        assert(i < _size);
+        assert(objs.size() == _nb_objs);
+        for (size_t k = 0; k < _nb_objs; ++k) {
+          assert(!std::isnan(objs[k]));
+          col(k)[i] = objs[k];
+        }
+      }
+
+      // copy the row j of objs to the row i
+      void set_row(size_t i, const ObjMatrix& objs, size_t j) {
+        assert(i < _size);
+        assert(j < objs.size());
+        assert(objs.nb_objs() == _nb_objs);
+        for (size_t k = 0; k < _nb_objs; ++k)
+          col(k)[i] = objs.col(k)[j];
+      }
+
+      // copy the objectives of the individual i to o (contiguous)
+      void row(size_t i, std::vector<float>& o) const {
+        assert(i < _size);
+        o.resize(_nb_objs);
+        for (size_t k = 0; k < _nb_objs; ++k)
+          o[k] = col(k)[i];
+      }
+
+      size_t size() const {
+        return _size;
+      }
+      size_t nb_objs() const {
+        return _nb_objs;
+      }
+      size_t stride() const {
+        return _stride;
+      }
+      const float* col(size_t k) const {
+        assert(k < _nb_objs);
+        return &_data[k * _stride];
+      }
+      float* col(size_t k) {
+        assert(k < _nb_objs);
+        return &_data[k * _stride];
+      }
+      float operator()(size_t i, size_t k) const {
+        assert(i < _size);
+        assert(k < _nb_objs);
+        return _data[k * _stride + i];
+      }
+
+      // same as fit::dominate_flag, i.e. :
+      //  1 if i1 dominates i2
+      // -1 if i2 dominates i1
+      // 0 if both a and b are non-dominated
+      int dominate_flag(size_t i1, size_t i2) const {
+        assert(i1 < _size);
+        assert(i2 < _size);
+        bool flag1 = false, flag2 = false;
+        for (size_t k = 0; k < _nb_objs; ++k) {
+          const float* c = col(k);
+          if (c[i1] > c[i2])
+            flag1 = true;
+          else if (c[i2] > c[i1])
+            flag2 = true;
+        }
+        return _flag(flag1, flag2);
+      }
+      // o (a vector of nb_objs() objectives) vs individual i2
+      int dominate_flag(const std::vector<float>& o, size_t i2) const {
+        assert(o.size() == _nb_objs);
+        assert(i2 < _size);
+        bool flag1 = false, flag2 = false;
+        for (size_t k = 0; k < _nb_objs; ++k) {
+          float v = col(k)[i2];
+          if (o[k] > v)
+            flag1 = true;
+          else if (v > o[k])
+            flag2 = true;
+        }
+        return _flag(flag1, flag2);
+      }
+     protected:
+      static int _flag(bool flag1, bool flag2) {
+        if (flag1 && !flag2)
+          return 1;
+        else if (!flag1 && flag2)
+          return -1;
+        else
+          return 0;
+      }
+
+      size_t _size, _nb_objs, _stride;
+      std::vector<float, misc::aligned_allocator<float> > _data;
+    };
+
+    // lexicographic order on the individuals of an ObjMatrix (best first),
+    // ties are broken by index so that the order is deterministic
+    struct compare_rows_lex {
+      const ObjMatrix& objs;
+      compare_rows_lex(const ObjMatrix& o) : objs(o) {}
+      bool operator()(size_t i1, size_t i2) const {
+        for (size_t k = 0; k < objs.nb_objs(); ++k) {
+          const float* c = objs.col(k);
+          if (c[i1] > c[i2])
+            return true;
+          else if (c[i1] < c[i2])
+            return false;
+        }
+        return i1 < i2;
+      }
+    };
+
+    // order of the individuals of an ObjMatrix according to the k-th objective
+    // (best first, ties broken by index)
+    struct compare_rows_obj {
+      const float* c;
+      compare_rows_obj(const ObjMatrix& objs, size_t k) : c(objs.col(k)) {}
+      bool operator()(size_t i1, size_t i2) const {
+        if (c[i1] > c[i2])
+          return true;
+        else if (c[i1] < c[i2])
+          return false;
+        return i1 < i2;
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,71 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef GEN_BATCH_HPP_
+#define GEN_BATCH_HPP_
+
+#include <cstddef>
+#include <sferes/stc.hpp>
+
+namespace sferes {
+  namespace gen {
+    // population-level variation operators: a genotype can specialize this
+    // class to mutate / cross a whole batch of genotypes at once (e.g.
+    // gen::EvoFloat); the EAs use them only if enabled is true, and the
+    // per-individual mutate() / cross() of the phenotypes otherwise
+    // (the batch operators bypass Phen::mutate() / cross(): a genotype
+    // should only enable them when the parameters ask for it, e.g.
+    // Params::evo_float::batch_variation)
+    template<typename Gen>
+    struct batch {
+      SFERES_CONST bool enabled = false;
+      static void mutate(Gen* const* gens, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+          gens[i]->mutate();
+      }
+      // (p1[i], p2[i]) -> (c1[i], c2[i])
+      static void cross(Gen* const* p1, Gen* const* p2,
+                        Gen* const* c1, Gen* const* c2, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+          p1[i]->cross(*p2[i], *c1[i], *c2[i]);
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,83 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef GEN_COLUMNS_HPP_
+#define GEN_COLUMNS_HPP_
+
+#include <cstddef>
+#include <sferes/stc.hpp>
+
+namespace sferes {
+  namespace gen {
+    // storage of the genotypes as the rows of a matrix of scalars (see the
+    // columnar checkpoints, ea/checkpoint.hpp): a genotype can specialize
+    // this class if its genes are a fixed number of scalars; otherwise the
+    // population is serialized with boost::serialization
+    template<typename Gen>
+    struct columns {
+      SFERES_CONST bool enabled = false;
+      typedef float scalar_t;
+      static size_t size() {
+        return 0;
+      }
+      static void get(const Gen& g, scalar_t* row) {}
+      static void set(Gen& g, const scalar_t* row) {}
+    };
+
+    // a fixed-size array of float genes, with data() and data(i, v)
+    // (e.g. gen::Float, gen::EvoFloat)
+    template<typename Gen>
+    struct float_columns {
+      SFERES_CONST bool enabled = true;
+      typedef float scalar_t;
+      static size_t size() {
+        return Gen::gen_size;
+      }
+      static void get(const Gen& g, scalar_t* row) {
+        for (size_t i = 0; i < Gen::gen_size; ++i)
+          row[i] = g.data()[i];
+      }
+      static void set(Gen& g, const scalar_t* row) {
+        for (size_t i = 0; i < Gen::gen_size; ++i)
+          g.data(i, row[i]);
+      }
+    };
+  }
+}
+
+#endif
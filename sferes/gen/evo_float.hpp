@@ -47,6 +47,7 @@
 #include <sferes/misc.hpp>
 #include <sferes/dbg/dbg.hpp>
 #include <sferes/gen/float.hpp>
+#include <sferes/gen/batch.hpp>
 #include <iostream>
 #include <cmath>
 namespace sferes {
@@ -67,6 +68,37 @@ namespace sferes {
           assert(0);
         }
       };
+
+      // Params::evo_float::batch_variation (optional, false by default):
+      // use the batch operators in the EAs that support them (the
+      // phenotype must not override mutate() or cross())
+      template<typename P, typename Enable = void>
+      struct batch_variation {
+        SFERES_CONST bool value = false;
+      };
+      template<typename P>
+      struct batch_variation<P, typename stc::Void<decltype(P::evo_float::batch_variation)>::type> {
+        SFERES_CONST bool value = P::evo_float::batch_variation;
+      };
+
+      // batch versions (see gen::batch), the default is per individual
+      template<typename Ev, int T>
+      struct BatchMutation_f {
+        SFERES_CONST bool enabled = false;
+        void operator()(Ev* const* gens, size_t n) {
+          for (size_t i = 0; i < n; ++i)
+            gens[i]->mutate();
+        }
+      };
+      template<typename Ev, int T>
+      struct BatchCrossOver_f {
+        SFERES_CONST bool enabled = false;
+        void operator()(Ev* const* p1, Ev* const* p2,
+                        Ev* const* c1, Ev* const* c2, size_t n) {
+          for (size_t i = 0; i < n; ++i)
+            p1[i]->cross(*p2[i], *c1[i], *c2[i]);
+        }
+      };
     }
 
     /// in range [0;1]
@@ -80,6 +112,9 @@ namespace sferes {
 
       EvoFloat() {}
 
+      template<typename, int> friend struct evo_float::BatchMutation_f;
+      template<typename, int> friend struct evo_float::BatchCrossOver_f;
+
       //@{
       void mutate() {
         for (size_t i = 0; i < Size; i++)
@@ -245,7 +280,201 @@ namespace sferes {
         }
       };
 
+      // --- batch operators ---
+      // The genes of the whole batch are processed as flat arrays: the
+      // random numbers are drawn in bulk (misc::rand_fill), the mutated
+      // genes are gathered in a contiguous buffer, and the math is written
+      // without branches so that the loops can be vectorized (pow(x, e) is
+      // computed as exp(e * log(x))). The distributions are the same as
+      // the ones of the per-gene operators above, but the random numbers
+      // are drawn in a different order.
+      namespace _batch {
+        inline float pow(float x, float e) {
+          return std::exp(e * std::log(x));
+        }
+        inline float clamp01(float x) {
+          return std::min(1.0f, std::max(0.0f, x));
+        }
+        // buffers reused from one call to the next (one per thread)
+        struct buffers {
+          std::vector<float> r1, r2, a, b;
+          std::vector<float*> gens, genes;
+        };
+        inline buffers& get_buffers() {
+          static thread_local buffers b;
+          return b;
+        }
+        // pointers to the genes of the genotypes b.gens (size genes each)
+        // that are selected for mutation (in b.genes)
+        inline void select_genes(size_t size, float rate, buffers& b) {
+          size_t n = b.gens.size();
+          b.r1.resize(n * size);
+          misc::rand_fill(b.r1.data(), b.r1.size());
+          b.genes.clear();
+          for (size_t i = 0; i < n; ++i) {
+            float* g = b.gens[i];
+            const float* r = &b.r1[i * size];
+            for (size_t j = 0; j < size; ++j)
+              if (r[j] < rate)
+                b.genes.push_back(g + j);
+          }
+        }
+      }
+
+      template<typename Ev>
+      struct BatchMutation_f<Ev, polynomial> {
+        SFERES_CONST bool enabled = true;
+        void operator()(Ev* const* gens, size_t n) {
+          SFERES_CONST float eta_m = Ev::params_t::evo_float::eta_m;
+          SFERES_CONST float e = 1.0f / (eta_m + 1.0f);
+          assert(eta_m != -1.0f);
+          _batch::buffers& b = _batch::get_buffers();
+          b.gens.resize(n);
+          for (size_t i = 0; i < n; ++i)
+            b.gens[i] = gens[i]->_data.data();
+          _batch::select_genes(Ev::gen_size, Ev::params_t::evo_float::mutation_rate, b);
+          size_t m = b.genes.size();
+          b.a.resize(m);
+          b.r2.resize(m);
+          misc::rand_fill(b.r2.data(), m);
+          for (size_t k = 0; k < m; ++k)
+            b.a[k] = *b.genes[k];
+          float* x = b.a.data();
+          const float* ri = b.r2.data();
+          for (size_t k = 0; k < m; ++k) {
+            bool low = ri[k] < 0.5f;
+            float base = low ? 2.0f * ri[k] : 2.0f * (1.0f - ri[k]);
+            float p = _batch::pow(base, e);
+            float delta = low ? p - 1.0f : 1.0f - p;
+            x[k] = _batch::clamp01(x[k] + delta);
+          }
+          for (size_t k = 0; k < m; ++k)
+            *b.genes[k] = b.a[k];
+        }
+      };
+
+      template<typename Ev>
+      struct BatchMutation_f<Ev, gaussian> {
+        SFERES_CONST bool enabled = true;
+        void operator()(Ev* const* gens, size_t n) {
+          // as in Mutation_f<Ev, gaussian>, sigma * sigma is the standard
+          // deviation given to misc::gaussian_rand
+          SFERES_CONST float sigma = Ev::params_t::evo_float::sigma;
+          SFERES_CONST float sd = sigma * sigma;
+          SFERES_CONST float two_pi = 6.28318530717958647692f;
+          _batch::buffers& b = _batch::get_buffers();
+          b.gens.resize(n);
+          for (size_t i = 0; i < n; ++i)
+            b.gens[i] = gens[i]->_data.data();
+          _batch::select_genes(Ev::gen_size, Ev::params_t::evo_float::mutation_rate, b);
+          size_t m = b.genes.size();
+          // Box-Muller: one normal number per pair of uniform numbers
+          b.a.resize(m);
+          b.r2.resize(2 * m);
+          misc::rand_fill(b.r2.data(), 2 * m);
+          for (size_t k = 0; k < m; ++k)
+            b.a[k] = *b.genes[k];
+          float* x = b.a.data();
+          const float* u = b.r2.data();
+          for (size_t k = 0; k < m; ++k) {
+            float z = std::sqrt(-2.0f * std::log(1.0f - u[2 * k]))
+                      * std::cos(two_pi * u[2 * k + 1]);
+            x[k] = _batch::clamp01(x[k] + sd * z);
+          }
+          for (size_t k = 0; k < m; ++k)
+            *b.genes[k] = b.a[k];
+        }
+      };
+
+      template<typename Ev>
+      struct BatchCrossOver_f<Ev, sbx> {
+        SFERES_CONST bool enabled = true;
+        void operator()(Ev* const* p1, Ev* const* p2,
+                        Ev* const* c1, Ev* const* c2, size_t n) {
+          SFERES_CONST float eta_c = Ev::params_t::evo_float::eta_c;
+          SFERES_CONST float e = 1.0f / (eta_c + 1.0f);
+          SFERES_CONST size_t size = Ev::gen_size;
+          assert(eta_c != -1);
+          _batch::buffers& b = _batch::get_buffers();
+          // which pairs are crossed (the others are copied in a random order)
+          b.r1.resize(2 * n);
+          misc::rand_fill(b.r1.data(), 2 * n);
+          std::vector<float*>& out = b.genes;
+          out.clear();
+          b.a.clear();
+          b.b.clear();
+          for (size_t i = 0; i < n; ++i)
+            if (b.r1[i] < Ev::params_t::evo_float::cross_rate) {
+              b.a.insert(b.a.end(), p1[i]->_data.begin(), p1[i]->_data.end());
+              b.b.insert(b.b.end(), p2[i]->_data.begin(), p2[i]->_data.end());
+              out.push_back(c1[i]->_data.data());
+              out.push_back(c2[i]->_data.data());
+            } else if (b.r1[n + i] < 0.5f) {
+              *c1[i] = *p1[i];
+              *c2[i] = *p2[i];
+            } else {
+              *c1[i] = *p2[i];
+              *c2[i] = *p1[i];
+            }
+          size_t m = b.a.size();
+          // one number for betaq, one for the coin flip
+          b.r2.resize(2 * m);
+          misc::rand_fill(b.r2.data(), 2 * m);
+          float* x1 = b.a.data();
+          float* x2 = b.b.data();
+          const float* r = b.r2.data();
+          const float* coin = b.r2.data() + m;
+          for (size_t k = 0; k < m; ++k) {
+            float y1 = std::min(x1[k], x2[k]);
+            float y2 = std::max(x1[k], x2[k]);
+            bool same = !(std::fabs(y1 - y2) > std::numeric_limits<float>::epsilon());
+            float d = same ? 1.0f : y2 - y1;
+            float ra = r[k];
+            float beta = 1.0f + 2.0f * y1 / d;
+            float alpha = 2.0f - _batch::pow(beta, -(eta_c + 1.0f));
+            float base = ra <= 1.0f / alpha ? ra * alpha : 1.0f / (2.0f - ra * alpha);
+            float v1 = 0.5f * ((y1 + y2) - _batch::pow(base, e) * d);
+            beta = 1.0f + 2.0f * (1.0f - y2) / d;
+            alpha = 2.0f - _batch::pow(beta, -(eta_c + 1.0f));
+            base = ra <= 1.0f / alpha ? ra * alpha : 1.0f / (2.0f - ra * alpha);
+            float v2 = 0.5f * ((y1 + y2) + _batch::pow(base, e) * d);
+            v1 = _batch::clamp01(v1);
+            v2 = _batch::clamp01(v2);
+            bool swap = !same && coin[k] >= 0.5f;
+            x1[k] = same ? y1 : (swap ? v2 : v1);
+            x2[k] = same ? y2 : (swap ? v1 : v2);
+          }
+          for (size_t i = 0; i < out.size() / 2; ++i) {
+            std::copy(x1 + i * size, x1 + (i + 1) * size, out[2 * i]);
+            std::copy(x2 + i * size, x2 + (i + 1) * size, out[2 * i + 1]);
+          }
+        }
+      };
     } //evo_float
+
+    template<int Size, typename Params, typename Exact>
+    struct batch<EvoFloat<Size, Params, Exact> > {
+      typedef EvoFloat<Size, Params, Exact> gen_t;
+      typedef evo_float::BatchMutation_f<gen_t, Params::evo_float::mutation_type> mutation_t;
+      typedef evo_float::BatchCrossOver_f<gen_t, Params::evo_float::cross_over_type> cross_over_t;
+#if defined(SFERES_NO_BATCH_VARIATION) || defined(TRACK_FIT)
+      SFERES_CONST bool enabled = false;
+#else
+      SFERES_CONST bool enabled = evo_float::batch_variation<Params>::value
+                                  && mutation_t::enabled && cross_over_t::enabled;
+#endif
+      static void mutate(gen_t* const* gens, size_t n) {
+        mutation_t()(gens, n);
+      }
+      static void cross(gen_t* const* p1, gen_t* const* p2,
+                        gen_t* const* c1, gen_t* const* c2, size_t n) {
+        cross_over_t()(p1, p2, c1, c2, n);
+      }
+    };
+
+    template<int Size, typename Params, typename Exact>
+    struct columns<EvoFloat<Size, Params, Exact> > :
+      public float_columns<EvoFloat<Size, Params, Exact> > {};
   } // gen
 } // sferes
 
@@ -36,13 +36,17 @@
 #define FLOAT_HPP_
 
 #include <vector>
+#include <array>
 #include <limits>
 #include <boost/foreach.hpp>
+#include <boost/archive/archive_exception.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/nvp.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <sferes/stc.hpp>
 #include <sferes/misc.hpp>
 #include <sferes/dbg/dbg.hpp>
+#include <sferes/gen/columns.hpp>
 #include <iostream>
 #include <cmath>
 
@@ -51,14 +55,18 @@ namespace sferes {
   namespace gen {
     // A basic class that represent an array of float, typically in range [0;1]
     // it is used by CMAES and EvoFloat derives from this class
+    // The genes are stored inline (no allocation, copies are memcpy), but
+    // they are serialized as a std::vector<float>, so that the files written
+    // with the previous (heap) storage can still be loaded.
     template<int Size, typename Params, typename Exact = stc::Itself>
     class Float : public stc::Any<Exact> {
      public:
       typedef Params params_t;
       typedef Float<Size, Params, Exact> this_t;
+      typedef std::array<float, Size> data_t;
       SFERES_CONST size_t gen_size = Size;
 
-      Float() : _data(Size) {
+      Float() {
         std::fill(_data.begin(), _data.end(), 0.5f);
       }
 
@@ -75,7 +83,7 @@ namespace sferes {
       //@}
 
       //@{
-      const std::vector<float>& data() const {
+      const data_t& data() const {
         return this->_data;
       }
       float data(size_t i) const {
@@ -97,12 +105,27 @@ namespace sferes {
       }
       //@}
       template<class Archive>
-      void serialize(Archive & ar, const unsigned int version) {
+      void save(Archive & ar, const unsigned int version) const {
+        std::vector<float> _data(this->_data.begin(), this->_data.end());
         ar & BOOST_SERIALIZATION_NVP(_data);
       }
+      template<class Archive>
+      void load(Archive & ar, const unsigned int version) {
+        std::vector<float> _data;
+        ar & BOOST_SERIALIZATION_NVP(_data);
+        // e.g. a genotype of another size in a dump
+        if (_data.size() != Size)
+          throw boost::archive::archive_exception(boost::archive::archive_exception::array_size_too_short);
+        std::copy(_data.begin(), _data.end(), this->_data.begin());
+      }
+      BOOST_SERIALIZATION_SPLIT_MEMBER()
      protected:
-      std::vector<float> _data;
+      alignas(16) data_t _data;
     };
+
+    template<int Size, typename Params, typename Exact>
+    struct columns<Float<Size, Params, Exact> > :
+      public float_columns<Float<Size, Params, Exact> > {};
   } // gen
 } // sferes
 
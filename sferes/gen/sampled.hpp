@@ -37,11 +37,14 @@
 #define GEN_SAMPLED_HPP_
 
 #include <vector>
+#include <array>
 #include <limits>
 #include <bitset>
 #include <boost/foreach.hpp>
+#include <boost/archive/archive_exception.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/nvp.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <sferes/stc.hpp>
 #include <sferes/misc.hpp>
 #include <sferes/dbg/dbg.hpp>
@@ -50,13 +53,16 @@
 
 namespace sferes {
   namespace gen {
+    // the indices are stored inline, but serialized as a std::vector<size_t>
+    // (same format as the previous heap storage)
     template<int Size, typename Params, typename Exact = stc::Itself>
     class Sampled : public stc::Any<Exact> {
      public:
       typedef Params params_t;
       typedef Sampled<Size, Params, Exact> this_t;
       typedef typename Params::sampled::values_t values_t;
-      Sampled() : _data(Size) {
+      Sampled() {
+        std::fill(_data.begin(), _data.end(), 0);
       }
 
       //@{
@@ -131,9 +137,20 @@ namespace sferes {
       //@}
 
       template<class Archive>
-      void serialize(Archive& ar, const unsigned int version) {
+      void save(Archive& ar, const unsigned int version) const {
+        std::vector<size_t> _data(this->_data.begin(), this->_data.end());
         ar& BOOST_SERIALIZATION_NVP(_data);
       }
+      template<class Archive>
+      void load(Archive& ar, const unsigned int version) {
+        std::vector<size_t> _data;
+        ar& BOOST_SERIALIZATION_NVP(_data);
+        // e.g. a genotype of another size in a dump
+        if (_data.size() != Size)
+          throw boost::archive::archive_exception(boost::archive::archive_exception::array_size_too_short);
+        std::copy(_data.begin(), _data.end(), this->_data.begin());
+      }
+      BOOST_SERIALIZATION_SPLIT_MEMBER()
      protected:
       void _check_invariant() const {
 #ifndef NDEBUG
@@ -143,7 +160,7 @@ namespace sferes {
         }
 #endif
       }
-      std::vector<size_t> _data;
+      alignas(16) std::array<size_t, Size> _data;
     };
 
   } // gen
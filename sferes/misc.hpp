@@ -41,4 +41,8 @@
 #include "misc/rand.hpp"
 #include "misc/range.hpp"
 #include "misc/sys.hpp"
+#include "misc/aligned_allocator.hpp"
+#include "misc/pool.hpp"
+#include "misc/async_writer.hpp"
+#include "misc/stop.hpp"
 #endif
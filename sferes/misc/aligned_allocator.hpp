@@ -0,0 +1,89 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef ALIGNED_ALLOCATOR_HPP_
+#define ALIGNED_ALLOCATOR_HPP_
+
+#include <cstdlib>
+#include <new>
+#include <limits>
+
+namespace sferes {
+  namespace misc {
+    // a minimal C++11 allocator that aligns the storage on Align bytes
+    // (e.g. for SIMD loads in std::vector<float, aligned_allocator<float> >)
+    template<typename T, size_t Align = 64>
+    class aligned_allocator {
+     public:
+      typedef T value_type;
+      template<typename U>
+      struct rebind {
+        typedef aligned_allocator<U, Align> other;
+      };
+
+      aligned_allocator() {}
+      template<typename U>
+      aligned_allocator(const aligned_allocator<U, Align>&) {}
+
+      T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+          throw std::bad_alloc();
+        void* p = 0x0;
+        if (posix_memalign(&p, Align, n * sizeof(T)) != 0)
+          throw std::bad_alloc();
+        return static_cast<T*>(p);
+      }
+      void deallocate(T* p, size_t) {
+        free(p);
+      }
+    };
+
+    template<typename T, typename U, size_t Align>
+    inline bool operator==(const aligned_allocator<T, Align>&,
+                           const aligned_allocator<U, Align>&) {
+      return true;
+    }
+    template<typename T, typename U, size_t Align>
+    inline bool operator!=(const aligned_allocator<T, Align>&,
+                           const aligned_allocator<U, Align>&) {
+      return false;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,277 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef ASYNC_WRITER_HPP_
+#define ASYNC_WRITER_HPP_
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sferes {
+  namespace misc {
+    // Writes files on a background thread, with two buffers: the caller
+    // fills buffer() (e.g. with a serialized archive) then submit()s it, and
+    // fills the other buffer while the first one is written; buffer() only
+    // waits when both buffers are still being written. The buffer can also
+    // be filled on the background thread (see submit(fname, fill)).
+    // A file is written to fname.tmp, fsync'ed, then renamed to fname (and
+    // the directory is fsync'ed), so that a crash during the write never
+    // leaves a truncated fname.
+    // The buffers keep their capacity from one file to the next.
+    class AsyncWriter {
+     public:
+      typedef std::function<void(std::string&)> fill_t;
+
+      AsyncWriter() : _next(0), _quit(false), _nb_filling(0), _nb_written(0), _total_bytes(0),
+        _last_bytes(0), _last_latency(0), _nb_errors(0) {
+        _busy[0] = _busy[1] = false;
+      }
+      ~AsyncWriter() {
+        wait();
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _quit = true;
+        }
+        _cond.notify_all();
+        if (_thread.joinable())
+          _thread.join();
+      }
+
+      // a free buffer, to be filled then submitted
+      std::string& buffer() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]() {
+          return !_busy[_next];
+        });
+        _buffers[_next].clear();
+        return _buffers[_next];
+      }
+      // write the last buffer() to fname (in background)
+      void submit(const std::string& fname) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _push(_job_t(_next, fname));
+      }
+      // fill a free buffer with fill(buffer) then write it to fname, both
+      // in background; what fill reads must not change before
+      // wait_filled() returns
+      void submit(const std::string& fname, const fill_t& fill) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]() {
+          return !_busy[_next];
+        });
+        _job_t job(_next, fname);
+        job.fill = fill;
+        ++_nb_filling;
+        _push(job);
+      }
+      // wait until the buffers of all the submitted files are filled
+      void wait_filled() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]() {
+          return _nb_filling == 0;
+        });
+      }
+      // wait until all the submitted files are written
+      void wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]() {
+          return !_busy[0] && !_busy[1];
+        });
+      }
+
+      size_t nb_written() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _nb_written;
+      }
+      size_t total_bytes() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _total_bytes;
+      }
+      // size of the last written file (bytes)
+      size_t last_bytes() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _last_bytes;
+      }
+      // time between the submission and the rename of the last written
+      // file (seconds)
+      double last_latency() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _last_latency;
+      }
+      size_t nb_errors() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _nb_errors;
+      }
+
+     protected:
+      typedef std::chrono::steady_clock clock_t;
+      struct _job_t {
+        _job_t(int b, const std::string& f) : buffer(b), fname(f), t(clock_t::now()) {}
+        int buffer;
+        std::string fname;
+        clock_t::time_point t;
+        fill_t fill;
+      };
+
+      // (locked)
+      void _push(const _job_t& job) {
+        if (!_thread.joinable())
+          _thread = std::thread(&AsyncWriter::_loop, this);
+        _busy[job.buffer] = true;
+        _jobs.push_back(job);
+        _next = 1 - _next;
+        _cond.notify_all();
+      }
+
+      void _loop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+          _cond.wait(lock, [this]() {
+            return _quit || !_jobs.empty();
+          });
+          if (_jobs.empty())
+            return;
+          _job_t job = _jobs.front();
+          _jobs.pop_front();
+          lock.unlock();
+          std::string& data = _buffers[job.buffer];
+          bool ok = true;
+          if (job.fill) {
+            data.clear();
+            ok = _fill(job.fill, data, job.fname);
+            lock.lock();
+            --_nb_filling;
+            _cond.notify_all();
+            lock.unlock();
+          }
+          ok = ok && _write(job.fname, data);
+          double latency = std::chrono::duration<double>(clock_t::now() - job.t).count();
+          lock.lock();
+          if (ok) {
+            ++_nb_written;
+            _total_bytes += data.size();
+            _last_bytes = data.size();
+            _last_latency = latency;
+          } else
+            ++_nb_errors;
+          _busy[job.buffer] = false;
+          _cond.notify_all();
+        }
+      }
+
+      static bool _write(const std::string& fname, const std::string& data) {
+        std::string tmp = fname + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+          return _error("cannot open", tmp);
+        size_t done = 0;
+        while (done < data.size()) {
+          ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+          if (n < 0 && errno == EINTR)
+            continue;
+          if (n < 0) {
+            ::close(fd);
+            return _error("cannot write", tmp);
+          }
+          done += n;
+        }
+        if (::fsync(fd) != 0) {
+          ::close(fd);
+          return _error("cannot sync", tmp);
+        }
+        if (::close(fd) != 0)
+          return _error("cannot close", tmp);
+        if (::rename(tmp.c_str(), fname.c_str()) != 0)
+          return _error("cannot rename", tmp);
+        // the rename is only durable once the directory is synced
+        size_t slash = fname.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : fname.substr(0, slash + 1);
+        int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dfd < 0)
+          return _error("cannot open", dir);
+        if (::fsync(dfd) != 0) {
+          ::close(dfd);
+          return _error("cannot sync", dir);
+        }
+        ::close(dfd);
+        return true;
+      }
+      static bool _fill(const fill_t& fill, std::string& data, const std::string& fname) {
+        try {
+          fill(data);
+        } catch (const std::exception& e) {
+          std::cerr << "ERROR: cannot serialize " << fname << ": " << e.what() << std::endl;
+          return false;
+        }
+        return true;
+      }
+      static bool _error(const char* what, const std::string& fname) {
+        std::cerr << "ERROR: " << what << " " << fname << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+      }
+
+      std::string _buffers[2];
+      bool _busy[2];
+      int _next;
+      bool _quit;
+      size_t _nb_filling;
+      std::deque<_job_t> _jobs;
+      mutable std::mutex _mutex;
+      std::condition_variable _cond;
+      std::thread _thread;
+      size_t _nb_written, _total_bytes, _last_bytes;
+      double _last_latency;
+      size_t _nb_errors;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,113 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef PHILOX_HPP_
+#define PHILOX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sferes {
+  namespace misc {
+    // Philox4x32-10, the counter-based generator of Salmon et al.
+    // ("Parallel random numbers: as easy as 1, 2, 3", SC 2011): a bijection
+    // of a 128-bit counter parametrized by a 64-bit key. Each counter gives
+    // 4 random 32-bit words that do not depend on any other draw, so that a
+    // random number can be identified by (key, counter) whatever the thread
+    // that computes it (see rand.hpp).
+    namespace philox {
+      static const uint32_t m0 = 0xD2511F53, m1 = 0xCD9E8D57;
+      static const uint32_t w0 = 0x9E3779B9, w1 = 0xBB67AE85;
+      static const size_t nb_rounds = 10;
+
+      inline void block(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+        uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+        uint32_t k0 = key[0], k1 = key[1];
+        for (size_t r = 0; r < nb_rounds; ++r) {
+          uint64_t p0 = (uint64_t)m0 * c0;
+          uint64_t p1 = (uint64_t)m1 * c2;
+          c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+          c1 = (uint32_t)p1;
+          c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+          c3 = (uint32_t)p0;
+          k0 += w0;
+          k1 += w1;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+      }
+
+      // the blocks of nb_lanes consecutive counters (ctr[0], ctr[0] + 1, ...)
+      // computed in lockstep, so that the compiler can vectorize the rounds;
+      // out[4 * l + j] is the word j of the counter ctr[0] + l
+      static const size_t nb_lanes = 8;
+      inline void blocks(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4 * nb_lanes]) {
+        uint32_t c0[nb_lanes], c1[nb_lanes], c2[nb_lanes], c3[nb_lanes];
+        for (size_t l = 0; l < nb_lanes; ++l) {
+          c0[l] = ctr[0] + (uint32_t)l;
+          c1[l] = ctr[1];
+          c2[l] = ctr[2];
+          c3[l] = ctr[3];
+        }
+        uint32_t k0 = key[0], k1 = key[1];
+        for (size_t r = 0; r < nb_rounds; ++r) {
+          for (size_t l = 0; l < nb_lanes; ++l) {
+            uint64_t p0 = (uint64_t)m0 * c0[l];
+            uint64_t p1 = (uint64_t)m1 * c2[l];
+            c0[l] = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+            c1[l] = (uint32_t)p1;
+            c2[l] = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+            c3[l] = (uint32_t)p0;
+          }
+          k0 += w0;
+          k1 += w1;
+        }
+        for (size_t l = 0; l < nb_lanes; ++l) {
+          out[4 * l] = c0[l];
+          out[4 * l + 1] = c1[l];
+          out[4 * l + 2] = c2[l];
+          out[4 * l + 3] = c3[l];
+        }
+      }
+    }
+  }
+}
+
+#endif
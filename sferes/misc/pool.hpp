@@ -0,0 +1,173 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+#ifndef POOL_HPP_
+#define POOL_HPP_
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/pool/pool_alloc.hpp>
+
+namespace sferes {
+  namespace misc {
+    // A recycling pool for the individuals: create() returns a
+    // boost::shared_ptr<T> (so that the populations and their serialization
+    // are unchanged), but when the last copy is destroyed the object is
+    // destroyed (its state is released) and its memory goes back to the
+    // pool instead of being deleted; the next object is constructed in it.
+    // The control blocks of the shared_ptr come from a
+    // boost::fast_pool_allocator.
+    // Each thread has its own list of free blocks (no lock), of at most
+    // capacity() blocks (the others are deleted). nb_free() and clear()
+    // are about the list of the calling thread.
+    template<typename T>
+    class Pool {
+     public:
+      static boost::shared_ptr<T> create() {
+        void* m = _get();
+        T* p = 0x0;
+        try {
+          p = new (m) T();
+        } catch (...) {
+          ::operator delete(m);
+          throw;
+        }
+        return _own(p);
+      }
+      // a copy of src (e.g. crowd::Indiv<Phen> from a Phen)
+      template<typename U>
+      static boost::shared_ptr<T> create(const U& src) {
+        return _create(src, std::is_constructible<T, const U&>());
+      }
+      static Pool& instance() {
+        static Pool pool;
+        return pool;
+      }
+      // number of blocks waiting to be reused by the calling thread
+      size_t nb_free() {
+        _list* l = _local();
+        return l ? l->blocks.size() : 0;
+      }
+      // give the free blocks of the calling thread back to the system
+      void clear() {
+        _list* l = _local();
+        if (l)
+          l->clear();
+      }
+      // maximum number of free blocks per thread (default: 16384)
+      static size_t capacity() {
+        return _capacity();
+      }
+      static void set_capacity(size_t c) {
+        _capacity() = c;
+      }
+     protected:
+      Pool() {}
+      struct _list {
+        bool& done;
+        std::vector<void*> blocks;
+        _list(bool& d) : done(d) {}
+        ~_list() {
+          clear();
+          done = true;
+        }
+        void clear() {
+          for (size_t i = 0; i < blocks.size(); ++i)
+            ::operator delete(blocks[i]);
+          blocks.clear();
+        }
+      };
+      struct _recycle {
+        void operator()(T* p) const {
+          p->~T();
+          _list* l = _local();
+          if (l && l->blocks.size() < _capacity())
+            l->blocks.push_back(p);
+          else
+            ::operator delete(p);
+        }
+      };
+      // the list of the calling thread, or 0x0 during its destruction
+      // (objects destroyed by the destructors of other thread_local or
+      // static objects)
+      static _list* _local() {
+        static thread_local bool done = false;
+        if (done)
+          return 0x0;
+        static thread_local _list l(done);
+        return &l;
+      }
+      static std::atomic<size_t>& _capacity() {
+        static std::atomic<size_t> c(16384);
+        return c;
+      }
+      static void* _get() {
+        _list* l = _local();
+        if (!l || l->blocks.empty())
+          return ::operator new(sizeof(T));
+        void* m = l->blocks.back();
+        l->blocks.pop_back();
+        return m;
+      }
+      // (if the control block cannot be allocated, the deleter recycles p)
+      static boost::shared_ptr<T> _own(T* p) {
+        return boost::shared_ptr<T>(p, _recycle(), boost::fast_pool_allocator<T>());
+      }
+      template<typename U>
+      static boost::shared_ptr<T> _create(const U& src, std::true_type) {
+        void* m = _get();
+        T* p = 0x0;
+        try {
+          p = new (m) T(src);
+        } catch (...) {
+          ::operator delete(m);
+          throw;
+        }
+        return _own(p);
+      }
+      template<typename U>
+      static boost::shared_ptr<T> _create(const U& src, std::false_type) {
+        boost::shared_ptr<T> p = create();
+        static_cast<U&>(*p) = src;
+        return p;
+      }
+    };
+  }
+}
+
+#endif
@@ -35,21 +35,216 @@
 #ifndef RAND_HPP_
 #define RAND_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <list>
 #include <random>
 #include <stdlib.h>
+#include <thread>
 #include <type_traits>
 
 // a few external tools for seeding (GPL-licensed)
 #include "sferes/misc/rand_utils.hpp"
+#include "sferes/misc/philox.hpp"
 
 namespace sferes {
     namespace misc {     
-        using generator_t = std::mt19937;
-        inline generator_t make_rgen() { return generator_t(randutils::auto_seed_128{}.base()); }
+        // Random streams
+        // -------------
+        // All the random numbers come from a counter-based generator
+        // (Philox4x32-10, see philox.hpp) keyed by the seed of the run: the
+        // n-th draw of a stream is philox(counter = (n, index, stream, epoch),
+        // key = seed), so it does not depend on the thread that makes it.
+        // - the epoch is set by the EA (0 for the initial population,
+        //   g + 1 for the generation g, see ea::Ea)
+        // - rand_stream() returns a new stream number (from serial code,
+        //   e.g. before a parallel loop); it is reset at each epoch
+        // - a rand_scope(stream, index) makes the current thread draw from
+        //   (stream, index), typically for the individual index of a
+        //   parallel loop; the framework loops (random, mutation,
+        //   cross-over, evaluation) do it for each individual
+        // - outside of any scope, each thread draws from its own stream;
+        //   this is reproducible for the thread that set the seed or the
+        //   epoch (the main thread) but not for the other ones.
+        // Hence a run is identical for any number of threads as long as the
+        // parallel code draws its numbers within a scope.
+        namespace _rand {
+            static const uint32_t free_stream = 0xFFFFFFFFu;
+
+            // a new seed from the entropy of the system
+            inline uint64_t random_seed()
+            {
+                uint32_t s[2];
+                randutils::auto_seed_128{}.base().generate(s, s + 2);
+                return ((uint64_t)s[1] << 32) | s[0];
+            }
+
+            struct global {
+                std::atomic<uint64_t> seed;
+                std::atomic<uint32_t> epoch;
+                std::atomic<uint32_t> nb_streams;
+                std::atomic<uint32_t> nb_threads;
+                // incremented when the seed or the epoch change
+                std::atomic<uint32_t> version;
+                std::thread::id main;
+                global() : seed(random_seed()), epoch(0), nb_streams(0), nb_threads(0), version(0)
+                {
+                    main = std::this_thread::get_id();
+                }
+            };
+            inline global& state()
+            {
+                static global g;
+                return g;
+            }
+
+            class stream {
+            public:
+                stream() : _version(-1), _pos(4)
+                {
+                    global& g = state();
+                    _thread = std::this_thread::get_id() == g.main ? 0 : ++g.nb_threads;
+                    _set(free_stream, _thread);
+                }
+                // select the stream (s, index) of the current epoch
+                void set(uint32_t s, uint32_t index)
+                {
+                    _set(s, index);
+                    _version = state().version;
+                }
+                struct saved_t {
+                    uint32_t s, index, n, pos, version;
+                };
+                saved_t save() const
+                {
+                    saved_t r = {_ctr[2], _ctr[1], _ctr[0], _pos, _version};
+                    return r;
+                }
+                // (a free stream still restarts if the seed or the epoch
+                // changed since save())
+                void restore(const saved_t& r)
+                {
+                    set(r.s, r.index);
+                    _version = r.version;
+                    _ctr[0] = r.n;
+                    uint32_t pos = r.pos;
+                    if (pos < 4) {
+                        --_ctr[0];
+                        _next_block();
+                        _pos = pos;
+                    }
+                }
+                uint32_t next()
+                {
+                    _check();
+                    if (_pos == 4)
+                        _next_block();
+                    return _buf[_pos++];
+                }
+                // n floats uniformly drawn in [0, 1)
+                void fill(float* v, size_t n)
+                {
+                    _check();
+                    const size_t nb = 4 * philox::nb_lanes;
+                    uint32_t tmp[nb];
+                    size_t i = 0;
+                    while (i < n) {
+                        philox::blocks(_ctr, _key, tmp);
+                        _ctr[0] += philox::nb_lanes;
+                        size_t k = std::min(nb, n - i);
+                        for (size_t j = 0; j < k; ++j)
+                            v[i + j] = (tmp[j] >> 8) * (1.0f / 16777216.0f);
+                        i += k;
+                    }
+                    _pos = 4;
+                }
+
+            protected:
+                void _set(uint32_t s, uint32_t index)
+                {
+                    global& g = state();
+                    uint64_t seed = g.seed;
+                    _key[0] = (uint32_t)seed;
+                    _key[1] = (uint32_t)(seed >> 32);
+                    _ctr[0] = 0;
+                    _ctr[1] = index;
+                    _ctr[2] = s;
+                    _ctr[3] = g.epoch;
+                    _pos = 4;
+                }
+                // the free stream restarts when the seed or the epoch change
+                void _check()
+                {
+                    uint32_t v = state().version.load(std::memory_order_relaxed);
+                    if (v != _version && _ctr[2] == free_stream) {
+                        _set(free_stream, _thread);
+                        _version = v;
+                    }
+                }
+                void _next_block()
+                {
+                    philox::block(_ctr, _key, _buf);
+                    ++_ctr[0];
+                    _pos = 0;
+                }
+                uint32_t _key[2], _ctr[4], _buf[4];
+                uint32_t _version, _pos, _thread;
+            };
+
+            inline stream& current()
+            {
+                static thread_local stream s;
+                return s;
+            }
+
+            // std::UniformRandomBitGenerator on the current stream
+            struct engine {
+                typedef uint32_t result_type;
+                static constexpr result_type min() { return 0; }
+                static constexpr result_type max() { return 0xFFFFFFFFu; }
+                result_type operator()() { return current().next(); }
+            };
+        } // namespace _rand
+
+        inline void rand_seed(uint64_t seed)
+        {
+            _rand::global& g = _rand::state();
+            g.seed = seed;
+            g.main = std::this_thread::get_id();
+            ++g.version;
+        }
+        inline uint64_t rand_seed() { return _rand::state().seed; }
+        // a new seed from the entropy of the system (the seed of the run
+        // is not changed)
+        inline uint64_t random_seed() { return _rand::random_seed(); }
+
+        inline void rand_epoch(uint32_t epoch)
+        {
+            _rand::global& g = _rand::state();
+            g.epoch = epoch;
+            g.nb_streams = 0;
+            ++g.version;
+        }
+        inline uint32_t rand_epoch() { return _rand::state().epoch; }
+
+        inline uint32_t rand_stream() { return _rand::state().nb_streams++; }
+
+        class rand_scope {
+        public:
+            rand_scope(uint32_t stream, uint32_t index) : _saved(_rand::current().save())
+            {
+                _rand::current().set(stream, index);
+            }
+            ~rand_scope() { _rand::current().restore(_saved); }
+
+        protected:
+            _rand::stream::saved_t _saved;
+        };
 
         // rand for floating point types (see the dispatcher below)
         // this is supposed to generate a number in [min, max)
@@ -59,7 +254,7 @@ namespace sferes {
         inline T rand(T min, T max, std::false_type)
         {
             assert(max > min);
-            static thread_local generator_t rgen = make_rgen();
+            _rand::engine rgen;
             std::uniform_real_distribution<T> dist(min, max);
             T v;
             do
@@ -77,7 +272,7 @@ namespace sferes {
         inline T rand(T min, T max, std::true_type)
         {
             assert(max > min);
-            static thread_local generator_t rgen = make_rgen();;
+            _rand::engine rgen;
             // uniform_int is in [a,b], not [a,b)...
             std::uniform_int_distribution<size_t> dist(min, max - 1);
             T v = dist(rgen);
@@ -102,7 +297,7 @@ namespace sferes {
         template <typename T>
         inline T gaussian_rand(T m = 0.0, T v = 1.0)
         {
-            static thread_local generator_t rgen = make_rgen();;
+            _rand::engine rgen;
             std::normal_distribution<T> dist(m, v);
             return dist(rgen);
         }
@@ -133,12 +328,18 @@ namespace sferes {
 
         inline bool flip_coin()
         {
-            static thread_local generator_t rgen = make_rgen();;
+            _rand::engine rgen;
             // uniform_int is in [a,b], not [a,b)...
             std::uniform_int_distribution<size_t> dist(0, 1);
             return (dist(rgen) == 0);
         }
 
+        // fill v with n uniform numbers in [0, 1)
+        inline void rand_fill(float* v, size_t n)
+        {
+            _rand::current().fill(v, n);
+        }
+
         // todo : remove this
         template <typename L>
         inline typename L::iterator rand_l(L& l)
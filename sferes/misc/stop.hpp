@@ -0,0 +1,120 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef MISC_STOP_HPP_
+#define MISC_STOP_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <time.h>
+
+namespace sferes {
+  namespace misc {
+    // Stop requests, e.g. from a signal handler (see run_ea):
+    // - request_stop() only stores to lock-free atomics (and reads the
+    //   monotonic clock), so it is async-signal-safe
+    // - the EA checks stop_requested() at the end of each generation, then
+    //   writes the last complete generation and sets its status to
+    //   "interrupted" (see Ea::stop())
+    // - the evaluators call check_abandon() before each individual: once
+    //   the stop deadline has passed since the request, it throws
+    //   misc::abandoned, and the current generation is abandoned; an
+    //   evaluation that has started is never interrupted, so a single long
+    //   evaluation can overrun the deadline
+    // - the MPI evaluators (eval::Mpi, eval::MpiParallel) never abandon
+    //   their evaluations
+    namespace _stop {
+      template<typename T = void>
+      struct state {
+        static std::atomic<int> signal;
+        static std::atomic<int64_t> time_ns;
+        static std::atomic<int64_t> deadline_ns;
+      };
+      template<typename T> std::atomic<int> state<T>::signal(0);
+      template<typename T> std::atomic<int64_t> state<T>::time_ns(0);
+      // -1: the current evaluations are always finished
+      template<typename T> std::atomic<int64_t> state<T>::deadline_ns(-1);
+
+      inline int64_t now_ns() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+      }
+    }
+
+    struct abandoned : public std::exception {
+      const char* what() const throw() {
+        return "evaluations abandoned after a stop request";
+      }
+    };
+
+    // sig: the signal number (-1 if the stop is not due to a signal)
+    inline void request_stop(int sig = -1) {
+      if (_stop::state<>::signal.load() != 0)
+        return;
+      _stop::state<>::time_ns.store(_stop::now_ns());
+      _stop::state<>::signal.store(sig);
+    }
+    // the signal of the request, or 0 if no stop is requested
+    inline int stop_requested() {
+      return _stop::state<>::signal.load(std::memory_order_relaxed);
+    }
+    inline void clear_stop() {
+      _stop::state<>::signal.store(0);
+    }
+    // after a stop request, the evaluations are abandoned after s seconds
+    // (s < 0: they are always finished, the default)
+    inline void set_stop_deadline(double s) {
+      _stop::state<>::deadline_ns.store(s < 0 ? -1 : (int64_t)(s * 1e9));
+    }
+    inline double stop_deadline() {
+      int64_t d = _stop::state<>::deadline_ns.load();
+      return d < 0 ? -1.0 : d * 1e-9;
+    }
+    inline void check_abandon() {
+      if (_stop::state<>::signal.load() == 0)
+        return;
+      int64_t d = _stop::state<>::deadline_ns.load();
+      if (d >= 0 && _stop::now_ns() - _stop::state<>::time_ns.load() >= d)
+        throw abandoned();
+    }
+  }
+}
+
+#endif
@@ -38,29 +38,204 @@
 #ifndef MODIFIER_DIV_HPP
 #define MODIFIER_DIV_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include <sferes/stc.hpp>
+#include <sferes/parallel.hpp>
+#include <sferes/misc/rand.hpp>
+#include <sferes/fit/desc_matrix.hpp>
 
 namespace sferes {
   namespace modif {
     namespace modifier_div {
+      // add d to the last objective of p
+      template<typename Phen>
+      void _add_div(Phen& p, float d) {
+        int l =  p.fit().objs().size() - 1;
+        assert(l > 0);
+        d += p.fit().obj(l);
+        p.fit().set_obj(l, d);
+      }
+
+      // the rows r of the (symmetric) matrix of the distances: d(i, j) is
+      // computed for j >= i only, and copied from the matrix of the previous
+      // generation if both individuals were there (prev[i] is the index of
+      // i in the previous population, or npos)
+      template<typename Phen>
+      struct _dist_matrix {
+        typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+        SFERES_CONST size_t npos = std::numeric_limits<size_t>::max();
+        const pop_t& _pop;
+        const std::vector<size_t>& _prev;
+        const std::vector<float>& _prev_dists;
+        size_t _prev_size;
+        std::vector<float>& _dists;
+
+        ~_dist_matrix() { }
+        _dist_matrix(const pop_t& pop, const std::vector<size_t>& prev,
+                     const std::vector<float>& prev_dists, size_t prev_size,
+                     std::vector<float>& dists) :
+          _pop(pop), _prev(prev), _prev_dists(prev_dists),
+          _prev_size(prev_size), _dists(dists) {}
+        _dist_matrix(const _dist_matrix& ev) :
+          _pop(ev._pop), _prev(ev._prev), _prev_dists(ev._prev_dists),
+          _prev_size(ev._prev_size), _dists(ev._dists) {}
+        void operator() (const parallel::range_t& r) const {
+          size_t n = _pop.size();
+          for (size_t i = r.begin(); i != r.end(); ++i)
+            for (size_t j = i; j < n; ++j) {
+              float d;
+              if (_prev[i] != npos && _prev[j] != npos)
+                d = _prev_dists[_prev[i] * _prev_size + _prev[j]];
+              else
+                d = _pop[i]->fit().dist(*_pop[j]);
+              _dists[i * n + j] = d;
+              _dists[j * n + i] = d;
+            }
+        }
+      };
+
+      // the sums of the rows of the matrix of the distances, without the
+      // matrix: d(i, j) is computed for j >= i only, and added to the rows
+      // i and j of the accumulator of the chunk (one chunk per thread);
+      // the rows i and n - 1 - i are in the same chunk, so that the chunks
+      // have about the same number of pairs
+      template<typename Phen>
+      struct _dist_sums {
+        typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+        const pop_t& _pop;
+        std::vector<std::vector<float> >& _sums;
+
+        ~_dist_sums() { }
+        _dist_sums(const pop_t& pop, std::vector<std::vector<float> >& sums) :
+          _pop(pop), _sums(sums) {}
+        _dist_sums(const _dist_sums& ev) : _pop(ev._pop), _sums(ev._sums) {}
+        void operator() (const parallel::range_t& r) const {
+          size_t n = _pop.size(), h = (n + 1) / 2, nb_chunks = _sums.size();
+          for (size_t c = r.begin(); c != r.end(); ++c) {
+            std::vector<float>& s = _sums[c];
+            s.assign(n, 0.0f);
+            for (size_t i = c * h / nb_chunks; i < (c + 1) * h / nb_chunks; ++i) {
+              _row(i, s);
+              if (n - 1 - i != i)
+                _row(n - 1 - i, s);
+            }
+          }
+        }
+        void _row(size_t i, std::vector<float>& s) const {
+          for (size_t j = i; j < _pop.size(); ++j) {
+            float d = _pop[i]->fit().dist(*_pop[j]);
+            s[i] += d;
+            if (j != i)
+              s[j] += d;
+          }
+        }
+      };
+
+      // the mean distance, from the sums of the chunks
+      template<typename Phen>
+      struct _parallel_div_sums {
+        typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+        const pop_t& _pop;
+        const std::vector<std::vector<float> >& _sums;
+
+        ~_parallel_div_sums() { }
+        _parallel_div_sums(const pop_t& pop, const std::vector<std::vector<float> >& sums) :
+          _pop(pop), _sums(sums) {}
+        _parallel_div_sums(const _parallel_div_sums& ev) : _pop(ev._pop), _sums(ev._sums) {}
+        void operator() (const parallel::range_t& r) const {
+          for (size_t i = r.begin(); i != r.end(); ++i) {
+            float d = 0.0f;
+            for (size_t c = 0; c < _sums.size(); ++c)
+              d += _sums[c][i];
+            _add_div(*_pop[i], d / _pop.size());
+          }
+        }
+      };
+
+      // mean of the rows of the matrix of the distances (in the order of
+      // the population, i.e. the same sum as a loop on dist())
       template<typename Phen>
       struct _parallel_div {
         typedef std::vector<boost::shared_ptr<Phen> > pop_t;
-        pop_t _pop;
+        const pop_t& _pop;
+        const std::vector<float>& _dists;
 
         ~_parallel_div() { }
-        _parallel_div(pop_t& pop) : _pop(pop) {}
-        _parallel_div(const _parallel_div& ev) : _pop(ev._pop) {}
+        _parallel_div(const pop_t& pop, const std::vector<float>& dists) :
+          _pop(pop), _dists(dists) {}
+        _parallel_div(const _parallel_div& ev) : _pop(ev._pop), _dists(ev._dists) {}
+        void operator() (const parallel::range_t& r) const {
+          size_t n = _pop.size();
+          for (size_t i = r.begin(); i != r.end(); ++i) {
+            float d = 0.0f;
+            for (size_t j = 0; j < n; ++j)
+              d += _dists[i * n + j];
+            d /= n;
+            _add_div(*_pop[i], d);
+          }
+        }
+      };
+
+      // the mean distance to the individuals of the sample only
+      template<typename Phen>
+      struct _parallel_div_sampled {
+        typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+        const pop_t& _pop;
+        const std::vector<size_t>& _sample;
+
+        ~_parallel_div_sampled() { }
+        _parallel_div_sampled(const pop_t& pop, const std::vector<size_t>& sample) :
+          _pop(pop), _sample(sample) {}
+        _parallel_div_sampled(const _parallel_div_sampled& ev) :
+          _pop(ev._pop), _sample(ev._sample) {}
         void operator() (const parallel::range_t& r) const {
           for (size_t i = r.begin(); i != r.end(); ++i) {
             float d = 0.0f;
-            for (size_t j = 0; j < _pop.size(); ++j)
-              d += _pop[i]->fit().dist(*_pop[j]);
-            d /= _pop.size();
-            int l =  _pop[i]->fit().objs().size() - 1;
-            assert(l > 0);
-            d += _pop[i]->fit().obj(l);
-            _pop[i]->fit().set_obj(l, d);
+            for (size_t j = 0; j < _sample.size(); ++j)
+              d += _pop[i]->fit().dist(*_pop[_sample[j]]);
+            d /= _sample.size();
+            _add_div(*_pop[i], d);
+          }
+        }
+      };
+
+      // the same with the behaviour descriptors (see fit/desc_matrix.hpp):
+      // mean euclidean distance to the points (the population or the
+      // sample), computed by blocks of individuals and tiles of the points
+      template<typename Phen>
+      struct _parallel_div_desc {
+        typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+        SFERES_CONST size_t block_size = 8;
+        SFERES_CONST size_t tile_size = fit::DescMatrix::tile_size;
+        const pop_t& _pop;
+        const fit::DescMatrix& _desc;
+        const fit::DescMatrix& _points;
+
+        ~_parallel_div_desc() { }
+        _parallel_div_desc(const pop_t& pop, const fit::DescMatrix& desc,
+                           const fit::DescMatrix& points) :
+          _pop(pop), _desc(desc), _points(points) {}
+        _parallel_div_desc(const _parallel_div_desc& ev) :
+          _pop(ev._pop), _desc(ev._desc), _points(ev._points) {}
+        void operator() (const parallel::range_t& r) const {
+          std::vector<float> dists(block_size * tile_size);
+          float s[block_size];
+          for (size_t b = r.begin(); b < r.end(); b += block_size) {
+            size_t e = std::min(r.end(), b + block_size);
+            std::fill(s, s + block_size, 0.0f);
+            for (size_t t = 0; t < _points.size(); t += tile_size) {
+              size_t te = std::min(_points.size(), t + tile_size);
+              _points.sq_dists(_desc, b, e, t, te, &dists[0], tile_size);
+              for (size_t i = b; i < e; ++i)
+                s[i - b] += fit::sum_sqrt(&dists[(i - b) * tile_size], te - t);
+            }
+            for (size_t i = b; i < e; ++i)
+              _add_div(*_pop[i], s[i - b] / _points.size());
           }
         }
       };
@@ -71,15 +246,134 @@ namespace sferes {
     // you HAVE to initialize this value to a "good" one (depending on
     // your constraints scheme)
     // you FITNESS class must have a float dist(const
-    // Phen& o) method (the dist method must be thread-safe)
+    // Phen& o) method (the dist method must be thread-safe and symmetric),
+    // or a behaviour descriptor (see fit/desc_matrix.hpp), in which case
+    // the distance is the euclidean distance between the descriptors
+    //
+    // With dist(), each pair is computed once per generation, and summed
+    // without storing the matrix of the distances (N floats per thread). With
+    // set_cache(true) (off by default), the distances between the
+    // individuals that stay in the population (e.g. the parents in NSGA-II)
+    // are kept for the next generation, so that only the pairs with a new
+    // individual are computed (this keeps two matrices of N^2 floats and
+    // the individuals of the last generation). For very large populations,
+    // set_sample_size(m) estimates the mean distance from m random
+    // individuals (N.m distances, no cache).
     SFERES_CLASS(Diversity) {
     public:
+      Diversity() : _sample_size(0), _cache(false) {}
+
+      // 0 (default): exact mean distance
+      void set_sample_size(size_t m) {
+        _sample_size = m;
+      }
+      size_t sample_size() const {
+        return _sample_size;
+      }
+      // the cache identifies the individuals by their address (it keeps
+      // them alive, so that an address is not reused), i.e. dist() must
+      // not change once an individual is evaluated; do not enable it
+      // otherwise (e.g. noisy fitnesses re-evaluated at each generation)
+      void set_cache(bool c) {
+        _cache = c;
+        if (!c)
+          clear_cache();
+      }
+      bool cache() const {
+        return _cache;
+      }
+      void clear_cache() {
+        _prev.clear();
+        std::vector<float>().swap(_prev_dists);
+        std::vector<float>().swap(_dists);
+      }
+
       template<typename Ea>
       void apply(Ea& ea) {
+        typedef typename Ea::phen_t phen_t;
+        if (ea.pop().empty())
+          return;
+        _sample.clear();
+        if (_sample_size > 0 && _sample_size < ea.pop().size())
+          _draw_sample(ea.pop().size());
         // parallel compute
         parallel::init();
-        parallel::p_for(parallel::range_t(0, ea.pop().size()),
-                        modifier_div::_parallel_div<typename Ea::phen_t>(ea.pop()));
+        _apply(ea.pop(), fit::has_desc<typename phen_t::fit_t>());
+      }
+    protected:
+      size_t _sample_size;
+      bool _cache;
+      std::vector<size_t> _sample;
+      // the matrix of the distances, and the population it was computed on
+      // (with the cache only)
+      std::vector<float> _dists, _prev_dists;
+      std::vector<boost::shared_ptr<void> > _prev;
+      fit::DescMatrix _desc, _sample_desc;
+
+      // (Floyd's sampling of m distinct individuals, in the order of the
+      // population)
+      void _draw_sample(size_t n) {
+        std::vector<bool> chosen(n, false);
+        for (size_t j = n - _sample_size; j < n; ++j) {
+          size_t t = misc::rand<size_t>(0, j + 1);
+          chosen[chosen[t] ? j : t] = true;
+        }
+        for (size_t i = 0; i < n; ++i)
+          if (chosen[i])
+            _sample.push_back(i);
+      }
+
+      template<typename Phen>
+      void _apply(const std::vector<boost::shared_ptr<Phen> >& pop, std::false_type) {
+        typedef modifier_div::_dist_matrix<Phen> dist_matrix_t;
+        if (!_sample.empty()) {
+          clear_cache();
+          parallel::p_for(parallel::range_t(0, pop.size()),
+                          modifier_div::_parallel_div_sampled<Phen>(pop, _sample));
+          return;
+        }
+        size_t n = pop.size();
+        if (!_cache) {
+          std::vector<std::vector<float> > sums(std::min(n, (size_t)parallel::nb_threads()));
+          parallel::p_for(parallel::range_t(0, sums.size()),
+                          modifier_div::_dist_sums<Phen>(pop, sums));
+          parallel::p_for(parallel::range_t(0, n),
+                          modifier_div::_parallel_div_sums<Phen>(pop, sums));
+          return;
+        }
+        std::vector<size_t> prev(n, (size_t)dist_matrix_t::npos);
+        if (!_prev.empty()) {
+          std::unordered_map<const void*, size_t> index;
+          for (size_t i = 0; i < _prev.size(); ++i)
+            index[_prev[i].get()] = i;
+          for (size_t i = 0; i < n; ++i) {
+            std::unordered_map<const void*, size_t>::const_iterator it =
+              index.find(pop[i].get());
+            if (it != index.end())
+              prev[i] = it->second;
+          }
+        }
+        _dists.resize(n * n);
+        parallel::p_for(parallel::range_t(0, n),
+                        dist_matrix_t(pop, prev, _prev_dists, _prev.size(), _dists));
+        parallel::p_for(parallel::range_t(0, n),
+                        modifier_div::_parallel_div<Phen>(pop, _dists));
+        _prev.assign(pop.begin(), pop.end());
+        _prev_dists.swap(_dists);
+      }
+      template<typename Phen>
+      void _apply(const std::vector<boost::shared_ptr<Phen> >& pop, std::true_type) {
+        _desc.snapshot(pop);
+        const fit::DescMatrix* points = &_desc;
+        if (!_sample.empty()) {
+          _sample_desc.clear(_desc.dim());
+          _sample_desc.reserve(_sample.size());
+          for (size_t i = 0; i < _sample.size(); ++i)
+            _sample_desc.push_back(pop[_sample[i]]->fit().desc());
+          points = &_sample_desc;
+        }
+        parallel::p_for(parallel::range_t(0, pop.size()),
+                        modifier_div::_parallel_div_desc<Phen>(pop, _desc, *points));
       }
     };
   }
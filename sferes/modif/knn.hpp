@@ -0,0 +1,519 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef MODIFIER_KNN_HPP
+#define MODIFIER_KNN_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <sferes/stc.hpp>
+#include <sferes/fit/desc_matrix.hpp>
+
+namespace sferes {
+  namespace modif {
+    // Nearest-neighbour indexes for the distance-based modifiers (see
+    // Novelty). An index holds the points that were add()ed (e.g. the
+    // archive of novelty search); knn() gives, for each query, the k
+    // smallest values of query->fit().dist(x) (in ascending order) for x
+    // in the index and in an extra population (e.g. the current one), i.e.
+    // the same values as a partial_sort of the full row of distances.
+    // knn() is const and thread-safe (if dist() is thread-safe), add(),
+    // remove() and prepare() are not; remove() keeps the order of the
+    // remaining points, and prepare(extra) is called before the knn()
+    // calls with the same extra population.
+    // entry_bytes() is the memory used by a point (for the individuals,
+    // without what they allocate themselves, e.g. their genome).
+    namespace knn {
+      // the elements of v that are not removed, in the same order
+      template<typename T>
+      void _compact(std::vector<T>& v, const std::vector<bool>& removed, size_t stride = 1) {
+        assert(v.size() == removed.size() * stride);
+        size_t n = 0;
+        for (size_t i = 0; i < removed.size(); ++i)
+          if (!removed[i]) {
+            if (n != i)
+              std::copy(v.begin() + i * stride, v.begin() + (i + 1) * stride,
+                        v.begin() + n * stride);
+            ++n;
+          }
+        v.resize(n * stride);
+      }
+
+      // the k smallest values pushed so far, in ascending order, in out
+      class TopK {
+       public:
+        TopK(size_t k, float* out) : _k(k), _n(0), _out(out) {}
+        void push(float d) {
+          if (_n == _k) {
+            if (!(d < _out[_k - 1]))
+              return;
+            --_n;
+          }
+          size_t i = _n++;
+          for (; i > 0 && d < _out[i - 1]; --i)
+            _out[i] = _out[i - 1];
+          _out[i] = d;
+        }
+        bool full() const {
+          return _n == _k;
+        }
+        float worst() const {
+          return full() ? _out[_k - 1] : std::numeric_limits<float>::max();
+        }
+        size_t size() const {
+          return _n;
+        }
+       protected:
+        size_t _k, _n;
+        float* _out;
+      };
+
+      // Calls dist() for every pair (what Novelty used to do), but without
+      // storing the matrix: the queries are processed by blocks, and the
+      // points by tiles, so that a tile of points stays in cache for the
+      // whole block of queries. Works with any dist().
+      template<typename Phen>
+      class BruteForce {
+       public:
+        typedef boost::shared_ptr<Phen> indiv_t;
+        typedef std::vector<indiv_t> pop_t;
+        SFERES_CONST size_t tile_size = 256;
+        SFERES_CONST size_t block_size = 8;
+
+        void add(const indiv_t& p) {
+          _points.push_back(p);
+        }
+        void remove(const std::vector<bool>& removed) {
+          _compact(_points, removed);
+        }
+        void prepare(const pop_t& extra) {}
+        const pop_t& points() const {
+          return _points;
+        }
+        size_t size() const {
+          return _points.size();
+        }
+        static size_t entry_bytes() {
+          return sizeof(indiv_t) + sizeof(Phen);
+        }
+        // the k nearest neighbours of queries[begin..end[ among the points
+        // and extra, to out[(i - begin) * k .. (i - begin + 1) * k[
+        void knn(const pop_t& queries, size_t begin, size_t end,
+                 const pop_t& extra, size_t k, float* out) const {
+          assert(_points.size() + extra.size() >= k);
+          for (size_t b = begin; b < end; b += block_size) {
+            size_t e = std::min(end, b + block_size);
+            std::vector<TopK> top;
+            top.reserve(e - b);
+            for (size_t i = b; i < e; ++i)
+              top.push_back(TopK(k, out + (i - begin) * k));
+            _tiles(queries, b, e, _points, top);
+            _tiles(queries, b, e, extra, top);
+          }
+        }
+       protected:
+        static void _tiles(const pop_t& queries, size_t b, size_t e,
+                           const pop_t& points, std::vector<TopK>& top) {
+          for (size_t t = 0; t < points.size(); t += tile_size) {
+            size_t te = std::min(points.size(), t + tile_size);
+            for (size_t i = b; i < e; ++i)
+              for (size_t j = t; j < te; ++j)
+                top[i - b].push(queries[i]->fit().dist(*points[j]));
+          }
+        }
+        pop_t _points;
+      };
+
+      // A k-d tree on the behaviour descriptors of the points, for
+      // low-dimensional descriptors (say Dim <= 10; use BruteForce
+      // otherwise). The fitness must provide desc(), a vector of Dim floats
+      // (anything with operator[]), and dist() must be a non-decreasing
+      // function of the euclidean distance between the descriptors (e.g.
+      // the distance or the squared distance): the tree only selects the
+      // candidates, and the values are those of dist(), so that they are
+      // the same as with BruteForce.
+      // The tree is built on the first points; the points added since then
+      // are searched linearly, until they are more than rebuild_ratio of the
+      // points in the tree (amortized O(log n) per added point).
+      template<typename Phen, size_t Dim>
+      class KdTree {
+       public:
+        typedef boost::shared_ptr<Phen> indiv_t;
+        typedef std::vector<indiv_t> pop_t;
+        SFERES_CONST size_t leaf_size = 16;
+        SFERES_CONST size_t min_tree_size = 256;
+        SFERES_CONST float rebuild_ratio = 0.25f;
+        // relative slack on the distances of the candidates, so that the
+        // rounding errors of dist() do not change the k nearest ones
+        SFERES_CONST float slack = 1e-3f;
+
+        KdTree() : _nb_indexed(0) {}
+        void add(const indiv_t& p) {
+          _points.push_back(p);
+          for (size_t d = 0; d < Dim; ++d)
+            _desc.push_back(p->fit().desc()[d]);
+          if (_points.size() - _nb_indexed > std::max((float)min_tree_size,
+              rebuild_ratio * _nb_indexed))
+            _build();
+        }
+        void remove(const std::vector<bool>& removed) {
+          _compact(_points, removed);
+          _compact(_desc, removed, Dim);
+          _nb_indexed = 0;
+          if (_points.size() > min_tree_size)
+            _build();
+        }
+        void prepare(const pop_t& extra) {}
+        const pop_t& points() const {
+          return _points;
+        }
+        size_t size() const {
+          return _points.size();
+        }
+        static size_t entry_bytes() {
+          return sizeof(indiv_t) + sizeof(Phen) + Dim * sizeof(float);
+        }
+        void knn(const pop_t& queries, size_t begin, size_t end,
+                 const pop_t& extra, size_t k, float* out) const {
+          assert(_points.size() + extra.size() >= k);
+          std::vector<float> e(k);
+          std::vector<size_t> candidates;
+          for (size_t i = begin; i < end; ++i) {
+            Phen& q = *queries[i];
+            float x[Dim];
+            for (size_t d = 0; d < Dim; ++d)
+              x[d] = q.fit().desc()[d];
+            TopK top(k, out + (i - begin) * k);
+            if (_nb_indexed > 0) {
+              // the k smallest euclidean distances in the tree, then all
+              // the points within the k-th one (+ slack)
+              TopK top_e(k, &e[0]);
+              _search(0, x, top_e);
+              float r = top_e.worst() * (1.0f + slack) + std::numeric_limits<float>::min();
+              candidates.clear();
+              _range(0, x, r, candidates);
+              for (size_t c = 0; c < candidates.size(); ++c)
+                top.push(q.fit().dist(*_points[candidates[c]]));
+            }
+            for (size_t j = _nb_indexed; j < _points.size(); ++j)
+              top.push(q.fit().dist(*_points[j]));
+            for (size_t j = 0; j < extra.size(); ++j)
+              top.push(q.fit().dist(*extra[j]));
+          }
+        }
+
+       protected:
+        struct node_t {
+          size_t begin, end; // in _perm
+          size_t left, right; // 0 for a leaf (the root is never a child)
+          size_t dim;
+          float split;
+        };
+
+        float _dist2(const float* x, size_t j) const {
+          const float* y = &_desc[j * Dim];
+          float s = 0;
+          for (size_t d = 0; d < Dim; ++d)
+            s += (x[d] - y[d]) * (x[d] - y[d]);
+          return s;
+        }
+        struct _compare_dim {
+          const float* desc;
+          size_t dim;
+          _compare_dim(const float* d, size_t di) : desc(d), dim(di) {}
+          bool operator()(size_t a, size_t b) const {
+            return desc[a * Dim + dim] < desc[b * Dim + dim];
+          }
+        };
+        void _build() {
+          _nb_indexed = _points.size();
+          _perm.resize(_nb_indexed);
+          for (size_t i = 0; i < _nb_indexed; ++i)
+            _perm[i] = i;
+          _nodes.clear();
+          _build(0, _nb_indexed);
+        }
+        size_t _build(size_t begin, size_t end) {
+          size_t n = _nodes.size();
+          _nodes.push_back(node_t());
+          _nodes[n].begin = begin;
+          _nodes[n].end = end;
+          _nodes[n].left = _nodes[n].right = 0;
+          if (end - begin <= leaf_size)
+            return n;
+          // split the widest dimension at the median
+          size_t dim = 0;
+          float width = -1;
+          for (size_t d = 0; d < Dim; ++d) {
+            float lo = std::numeric_limits<float>::max(), hi = -lo;
+            for (size_t i = begin; i < end; ++i) {
+              lo = std::min(lo, _desc[_perm[i] * Dim + d]);
+              hi = std::max(hi, _desc[_perm[i] * Dim + d]);
+            }
+            if (hi - lo > width) {
+              width = hi - lo;
+              dim = d;
+            }
+          }
+          size_t mid = (begin + end) / 2;
+          std::nth_element(_perm.begin() + begin, _perm.begin() + mid, _perm.begin() + end,
+                           _compare_dim(&_desc[0], dim));
+          _nodes[n].dim = dim;
+          _nodes[n].split = _desc[_perm[mid] * Dim + dim];
+          size_t l = _build(begin, mid);
+          size_t r = _build(mid, end);
+          _nodes[n].left = l;
+          _nodes[n].right = r;
+          return n;
+        }
+        // (the left subtree is <= split, the right one >= split)
+        void _search(size_t n, const float* x, TopK& top) const {
+          const node_t& node = _nodes[n];
+          if (node.left == 0) {
+            for (size_t i = node.begin; i < node.end; ++i)
+              top.push(_dist2(x, _perm[i]));
+            return;
+          }
+          float diff = x[node.dim] - node.split;
+          size_t first = diff < 0 ? node.left : node.right;
+          size_t second = diff < 0 ? node.right : node.left;
+          _search(first, x, top);
+          if (diff * diff <= top.worst())
+            _search(second, x, top);
+        }
+        void _range(size_t n, const float* x, float r, std::vector<size_t>& out) const {
+          const node_t& node = _nodes[n];
+          if (node.left == 0) {
+            for (size_t i = node.begin; i < node.end; ++i)
+              if (_dist2(x, _perm[i]) <= r)
+                out.push_back(_perm[i]);
+            return;
+          }
+          float diff = x[node.dim] - node.split;
+          if (diff <= 0 || diff * diff <= r)
+            _range(node.left, x, r, out);
+          if (diff >= 0 || diff * diff <= r)
+            _range(node.right, x, r, out);
+        }
+
+        pop_t _points;
+        std::vector<float> _desc;
+        size_t _nb_indexed;
+        std::vector<size_t> _perm;
+        std::vector<node_t> _nodes;
+      };
+
+      // distances between descriptors, for Compact and Blocked (which only
+      // uses from_squared())
+      struct l2_squared {
+        float operator()(const float* a, const float* b, size_t dim) const {
+          float s = 0;
+          for (size_t d = 0; d < dim; ++d)
+            s += (a[d] - b[d]) * (a[d] - b[d]);
+          return s;
+        }
+        static float from_squared(float d2) {
+          return d2;
+        }
+      };
+      struct l2 {
+        float operator()(const float* a, const float* b, size_t dim) const {
+          return sqrtf(l2_squared()(a, b, dim));
+        }
+        static float from_squared(float d2) {
+          return sqrtf(d2);
+        }
+      };
+
+      // Only keeps the behaviour descriptors (fit().desc(), Dim floats) of
+      // the points, contiguously, instead of the individuals: the archive
+      // does not keep the individuals alive, and is much smaller in the gen
+      // files (see stat::CompactArchive). The distances are Metric on the
+      // descriptors (dist() is not used, even for the extra population).
+      template<typename Phen, size_t Dim, typename Metric = l2>
+      class Compact {
+       public:
+        typedef boost::shared_ptr<Phen> indiv_t;
+        typedef std::vector<indiv_t> pop_t;
+
+        void add(const indiv_t& p) {
+          for (size_t d = 0; d < Dim; ++d)
+            _desc.push_back(p->fit().desc()[d]);
+        }
+        void remove(const std::vector<bool>& removed) {
+          _compact(_desc, removed, Dim);
+        }
+        void prepare(const pop_t& extra) {}
+        size_t size() const {
+          return _desc.size() / Dim;
+        }
+        static size_t dim() {
+          return Dim;
+        }
+        // size() rows of Dim floats
+        const std::vector<float>& descriptors() const {
+          return _desc;
+        }
+        static size_t entry_bytes() {
+          return Dim * sizeof(float);
+        }
+        void knn(const pop_t& queries, size_t begin, size_t end,
+                 const pop_t& extra, size_t k, float* out) const {
+          assert(size() + extra.size() >= k);
+          std::vector<float> x(extra.size() * Dim);
+          for (size_t j = 0; j < extra.size(); ++j)
+            for (size_t d = 0; d < Dim; ++d)
+              x[j * Dim + d] = extra[j]->fit().desc()[d];
+          Metric m;
+          for (size_t i = begin; i < end; ++i) {
+            float q[Dim];
+            for (size_t d = 0; d < Dim; ++d)
+              q[d] = queries[i]->fit().desc()[d];
+            TopK top(k, out + (i - begin) * k);
+            for (size_t j = 0; j < size(); ++j)
+              top.push(m(q, &_desc[j * Dim], Dim));
+            for (size_t j = 0; j < extra.size(); ++j)
+              top.push(m(q, &x[j * Dim], Dim));
+          }
+        }
+       protected:
+        std::vector<float> _desc;
+      };
+
+      // For the fitnesses with a behaviour descriptor (see
+      // fit/desc_matrix.hpp): the descriptors of the points and of the extra
+      // population (see prepare()) are kept in DescMatrix'es, and the
+      // distances are computed by blocks of queries and tiles of points
+      // (||a||^2 + ||b||^2 - 2 a.b); dist() is not used. Metric is l2 or
+      // l2_squared. This is the default index of Novelty for these
+      // fitnesses (see default_index).
+      template<typename Phen, typename Metric = l2>
+      class Blocked {
+       public:
+        typedef boost::shared_ptr<Phen> indiv_t;
+        typedef std::vector<indiv_t> pop_t;
+        typedef typename Phen::fit_t fit_t;
+        SFERES_CONST size_t dim = fit_t::desc_size;
+        SFERES_CONST size_t block_size = 8;
+        SFERES_CONST size_t tile_size = fit::DescMatrix::tile_size;
+
+        Blocked() {
+          _desc.clear(dim);
+          _extra.clear(dim);
+        }
+        void add(const indiv_t& p) {
+          _points.push_back(p);
+          _desc.push_back(p->fit().desc());
+        }
+        void remove(const std::vector<bool>& removed) {
+          _compact(_points, removed);
+          _desc.remove(removed);
+        }
+        void prepare(const pop_t& extra) {
+          _extra.clear(dim);
+          _extra.reserve(extra.size());
+          for (size_t i = 0; i < extra.size(); ++i)
+            _extra.push_back(extra[i]->fit().desc());
+        }
+        const pop_t& points() const {
+          return _points;
+        }
+        const fit::DescMatrix& descriptors() const {
+          return _desc;
+        }
+        size_t size() const {
+          return _points.size();
+        }
+        static size_t entry_bytes() {
+          return sizeof(indiv_t) + sizeof(Phen) + (dim + 1) * sizeof(float);
+        }
+        void knn(const pop_t& queries, size_t begin, size_t end,
+                 const pop_t& extra, size_t k, float* out) const {
+          assert(_points.size() + extra.size() >= k);
+          assert(_extra.size() == extra.size());
+          fit::DescMatrix q;
+          q.clear(dim);
+          q.reserve(end - begin);
+          for (size_t i = begin; i < end; ++i)
+            q.push_back(queries[i]->fit().desc());
+          std::vector<float> d(block_size * tile_size);
+          for (size_t b = 0; b < q.size(); b += block_size) {
+            size_t e = std::min(q.size(), b + block_size);
+            std::vector<TopK> top;
+            top.reserve(e - b);
+            for (size_t i = b; i < e; ++i)
+              top.push_back(TopK(k, out + i * k));
+            _tiles(q, b, e, _desc, d, top);
+            _tiles(q, b, e, _extra, d, top);
+          }
+          for (size_t i = 0; i < (end - begin) * k; ++i)
+            out[i] = Metric::from_squared(out[i]);
+        }
+       protected:
+        static void _tiles(const fit::DescMatrix& q, size_t b, size_t e,
+                           const fit::DescMatrix& points, std::vector<float>& d,
+                           std::vector<TopK>& top) {
+          for (size_t t = 0; t < points.size(); t += tile_size) {
+            size_t te = std::min(points.size(), t + tile_size);
+            points.sq_dists(q, b, e, t, te, &d[0], tile_size);
+            for (size_t i = b; i < e; ++i)
+              for (size_t j = t; j < te; ++j)
+                top[i - b].push(d[(i - b) * tile_size + j - t]);
+          }
+        }
+        pop_t _points;
+        fit::DescMatrix _desc, _extra;
+      };
+
+      // Blocked if the fitness has a behaviour descriptor, BruteForce
+      // (dist()) otherwise
+      template<typename Phen>
+      struct default_index {
+        typedef typename std::conditional<fit::has_desc<typename Phen::fit_t>::value,
+                Blocked<Phen>, BruteForce<Phen> >::type type;
+      };
+    }
+  }
+}
+
+#endif
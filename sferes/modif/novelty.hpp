@@ -35,51 +35,59 @@
 #ifndef MODIFIER_NOVELTY_HPP
 #define MODIFIER_NOVELTY_HPP
 
-#ifdef EIGEN3_ENABLED
-#include <Eigen/Core>
-#else
+#include <algorithm>
+#include <cstdint>
 #include <vector>
-#endif
+#include <Eigen/Core>
 
 #include "sferes/parallel.hpp"
+#include "sferes/modif/knn.hpp"
 
 namespace sferes {
   namespace modif {
     namespace novelty {
-
-      // compute the matrix of distances
-      template<typename Phen>
-      struct _distance_f {
+      // the sparseness of each individual of the population (the mean of
+      // its k nearest neighbours in the index and in the population, see
+      // knn.hpp), stored in its last objective and in sparseness; the
+      // distances and the sum use scratch buffers of the range
+      template<typename Phen, typename Index, size_t K>
+      struct _sparseness_f {
         typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+        const Index& _index;
         const pop_t& _pop;
-        const pop_t& _archive;
-#ifdef EIGEN3_ENABLED
-        Eigen::MatrixXf& distances;
-#else
-        std::vector<std::vector<float> > distances;
-#endif
+        std::vector<float>& _sparseness;
 
-        ~_distance_f() { }
-#ifdef EIGEN3_ENABLED
-        _distance_f(const pop_t& pop, const pop_t& archive, Eigen::MatrixXf& d) :
-#else
-        _distance_f(const pop_t& pop, const pop_t& archive, std::vector<std::vector<float> >& d) :
-#endif
-          _pop(pop), _archive(archive), distances(d) {}
-        _distance_f(const _distance_f& ev) :
-          _pop(ev._pop), _archive(ev._archive), distances(ev.distances) {}
+        ~_sparseness_f() { }
+        _sparseness_f(const Index& index, const pop_t& pop, std::vector<float>& sparseness) :
+          _index(index), _pop(pop), _sparseness(sparseness) {}
+        _sparseness_f(const _sparseness_f& ev) :
+          _index(ev._index), _pop(ev._pop), _sparseness(ev._sparseness) {}
 
         void operator() (const parallel::range_t& r) const {
+          std::vector<float> knn((r.end() - r.begin()) * K);
+          _index.knn(_pop, r.begin(), r.end(), _pop, K, &knn[0]);
+          // (an aligned vector, so that the sum is always in the same order)
+          Eigen::VectorXf vd(K);
           for (size_t i = r.begin(); i != r.end(); ++i) {
-            for (size_t j = 0; j < _archive.size(); ++j)
-#ifdef EIGEN3_ENABLED
-              distances(i, j) = _pop[i]->fit().dist(*_archive[j]);
-#else
-              distances[i][j] = _pop[i]->fit().dist(*_archive[j]);
-#endif
+            std::copy(&knn[(i - r.begin()) * K], &knn[(i - r.begin()) * K] + K, vd.data());
+            float n = vd.head<K>().sum() / K;
+            _sparseness[i] = n;
+            size_t nb_objs = _pop[i]->fit().objs().size();
+            _pop[i]->fit().set_obj(nb_objs - 1, n);
           }
         }
       };
+
+      // which points leave a full archive (see Novelty::set_capacity)
+      enum eviction_t { fifo, least_novel, random };
+
+      struct _compare_scores {
+        const std::vector<float>& scores;
+        _compare_scores(const std::vector<float>& s) : scores(s) {}
+        bool operator()(size_t a, size_t b) const {
+          return scores[a] < scores[b] || (scores[a] == scores[b] && a < b);
+        }
+      };
     }
 
     // The novelty score will be stored in the last objective 'slot'
@@ -97,55 +105,80 @@ namespace sferes {
     // [2] Mouret, Jean-Baptiste. "Novelty-based multiobjectivization."
     // New Horizons in Evolutionary Robotics. Springer Berlin Heidelberg,
     // 2011. 139-154.
-    template<typename Phen, typename Params, typename Exact = stc::Itself>
+    //
+    // The archive is kept in a nearest-neighbour index (see knn.hpp):
+    // knn::BruteForce (the default) works with any dist(), and
+    // knn::KdTree<Phen, Dim> is much faster for low-dimensional behaviour
+    // descriptors; both give the same sparseness. knn::Compact only stores
+    // the descriptors (and Novelty the ids, see ids()). If the fitness
+    // declares a behaviour descriptor (see fit/desc_matrix.hpp), the
+    // default is knn::Blocked, i.e. the euclidean distance between the
+    // descriptors instead of dist().
+    //
+    // The archive is unbounded by default; see set_capacity() and
+    // set_memory_budget() to bound it.
+    template<typename Phen, typename Params,
+             typename Index = typename knn::default_index<Phen>::type,
+             typename Exact = stc::Itself>
     class Novelty {
      public:
       typedef boost::shared_ptr<Phen> phen_t;
       typedef std::vector<phen_t> pop_t;
-
-      Novelty() : _rho_min(Params::novelty::rho_min_init), _not_added(0) {}
+      typedef Index index_t;
+
+      Novelty() : _rho_min(Params::novelty::rho_min_init), _not_added(0),
+        _capacity(0), _eviction(novelty::fifo) {}
+
+      // at most n points in the archive (0: unbounded); when it is full,
+      // the oldest ones (fifo), the ones that were the least novel when they
+      // were added (least_novel), or random ones leave it at the end of
+      // apply()
+      void set_capacity(size_t n, novelty::eviction_t e = novelty::fifo) {
+        _capacity = n;
+        _eviction = e;
+      }
+      // the same, with the capacity given by the memory of the archive
+      // (approximate for the indexes that keep the individuals, see
+      // knn.hpp)
+      void set_memory_budget(size_t bytes, novelty::eviction_t e = novelty::fifo) {
+        size_t n = bytes / (Index::entry_bytes() + sizeof(uint64_t) + sizeof(float));
+        set_capacity(std::max(n, (size_t)Params::novelty::k), e);
+      }
+      size_t capacity() const {
+        return _capacity;
+      }
 
       template<typename Ea>
       void apply(Ea& ea) {
         SFERES_CONST size_t k = Params::novelty::k;
-        // merge the population and the archive in a single archive
-        pop_t archive = _archive;
-        archive.insert(archive.end(), ea.pop().begin(), ea.pop().end());
-
-        // we compute all the distances from pop(i) to archive(j) and store them
-#ifdef EIGEN3_ENABLED
-        Eigen::MatrixXf distances(ea.pop().size(), archive.size());
-#else
-        std::vector<std::vector<float> > distances(ea.pop().size(), std::vector<float>(archive.size()));
-#endif
-        novelty::_distance_f<Phen> f(ea.pop(), archive, distances);
+        // the sparseness of each individual, from the k smallest distances
+        // to the archive and the population (without the matrix of all the
+        // distances)
+        _sparseness.resize(ea.pop().size());
+        _archive.prepare(ea.pop());
         parallel::init();
-        parallel::p_for(parallel::range_t(0, ea.pop().size()), f);
-
-        // compute the sparseness of each individual of the population
-        // and potentially add some of them to the archive
-        int added = 0;
-        for (size_t i = 0; i < ea.pop().size(); ++i) {
-          size_t nb_objs = ea.pop()[i]->fit().objs().size();
-          Eigen::VectorXf vd = distances.row(i);
-
-          double n = 0.0;
-          std::partial_sort(vd.data(),
-                            vd.data() + k,
-                            vd.data() + vd.size());
-
-          n = vd.head<k>().sum() / k;
-          ea.pop()[i]->fit().set_obj(nb_objs - 1, n);
-          // add to the archive
-          if (n > _rho_min
+        parallel::p_for(parallel::range_t(0, ea.pop().size()),
+                        novelty::_sparseness_f<Phen, Index, k>(_archive, ea.pop(), _sparseness));
+
+        // potentially add some of them to the archive, in the order of the
+        // population (the random draws are the same as with a serial loop),
+        // after all the sparseness computations
+        _added.clear();
+        for (size_t i = 0; i < ea.pop().size(); ++i)
+          if (_sparseness[i] > _rho_min
               || misc::rand<float>() < Params::novelty::add_to_archive_prob) {
-            _archive.push_back(ea.pop()[i]);
+            _added.push_back(i);
             _not_added = 0;
-            ++added;
           } else {
             ++_not_added;
           }
-        } // end for all individuals
+        for (size_t j = 0; j < _added.size(); ++j) {
+          size_t i = _added[j];
+          _archive.add(ea.pop()[i]);
+          _ids.push_back(((uint64_t)ea.gen() << 32) | i);
+          _scores.push_back(_sparseness[i]);
+        }
+        int added = _added.size();
 
         // update rho_min
         if (_not_added > Params::novelty::stalled_tresh) { //2500
@@ -155,12 +188,57 @@ namespace sferes {
         if (_archive.size() > Params::novelty::k
             && added > Params::novelty::adding_tresh)//4
           _rho_min *= 1.05f;
+
+        if (_capacity > 0 && _archive.size() > _capacity)
+          _evict(_archive.size() - _capacity);
       }
-      const pop_t& archive() const { return _archive; }
+      // (not available with knn::Compact)
+      const pop_t& archive() const { return _archive.points(); }
+      const index_t& index() const { return _archive; }
+      // for each point of the archive: (generation << 32) | index in the
+      // population when it was added, and its sparseness then
+      const std::vector<uint64_t>& ids() const { return _ids; }
+      const std::vector<float>& scores() const { return _scores; }
      protected:
-      pop_t _archive;
+      index_t _archive;
+      std::vector<uint64_t> _ids;
+      std::vector<float> _scores;
+      std::vector<float> _sparseness;
+      std::vector<size_t> _added;
       float _rho_min;
       size_t _not_added;
+      size_t _capacity;
+      novelty::eviction_t _eviction;
+
+      void _evict(size_t n) {
+        size_t size = _archive.size();
+        std::vector<bool> removed(size, false);
+        switch (_eviction) {
+        case novelty::fifo:
+          std::fill(removed.begin(), removed.begin() + n, true);
+          break;
+        case novelty::least_novel: {
+          std::vector<size_t> order(size);
+          for (size_t i = 0; i < size; ++i)
+            order[i] = i;
+          std::nth_element(order.begin(), order.begin() + n, order.end(),
+                           novelty::_compare_scores(_scores));
+          for (size_t i = 0; i < n; ++i)
+            removed[order[i]] = true;
+          break;
+        }
+        case novelty::random:
+          // (Floyd's sampling of n distinct points)
+          for (size_t j = size - n; j < size; ++j) {
+            size_t t = misc::rand<size_t>(0, j + 1);
+            removed[removed[t] ? j : t] = true;
+          }
+          break;
+        }
+        _archive.remove(removed);
+        knn::_compact(_ids, removed);
+        knn::_compact(_scores, removed);
+      }
     };
   } // modif
 } // sferes
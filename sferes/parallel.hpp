@@ -44,6 +44,7 @@
 #include <tbb/blocked_range.h>
 #include <tbb/partitioner.h>
 #include <tbb/parallel_sort.h>
+#include <tbb/task_arena.h>
 #else
 #include <algorithm>
 #endif
@@ -66,6 +67,11 @@ namespace sferes {
     }
 #endif
 
+    // number of threads that can work at the same time
+    inline int nb_threads() {
+      return tbb::this_task_arena::max_concurrency();
+    }
+
     template<typename Range, typename Body>
     inline void p_for(const Range& range, const Body& body) {
       tbb::parallel_for(range, body);
@@ -77,6 +83,13 @@ namespace sferes {
     }
 
 
+    // one task per iteration (the iterations are not grouped by the
+    // partitioner), e.g. for long tasks of very different durations
+    template<typename Body>
+    inline void p_for_each(size_t begin, size_t end, const Body& body) {
+      tbb::parallel_for(range_t(begin, end, 1), body, tbb::simple_partitioner());
+    }
+
     template<typename T1, typename T2, typename T3>
     void sort(T1 i1, T2 i2, T3 comp) {
       tbb::parallel_sort(i1, i2, comp);
@@ -99,6 +112,10 @@ namespace sferes {
 
     static void init() {}
 
+    inline int nb_threads() {
+      return 1;
+    }
+
     template<typename Range, typename Body>
     inline void p_for(const Range& range, const Body& body) {
       body(range);
@@ -109,6 +126,11 @@ namespace sferes {
       body(range);
     }
 
+    template<typename Body>
+    inline void p_for_each(size_t begin, size_t end, const Body& body) {
+      body(range_t(begin, end));
+    }
+
     template<typename T1, typename T2, typename T3>
     void sort(T1 i1, T2 i2, T3 comp) {
       std::sort(i1, i2, comp);
@@ -42,6 +42,7 @@
 #include <boost/serialization/nvp.hpp>
 #include <sferes/stc.hpp>
 #include <sferes/dbg/dbg.hpp>
+#include <sferes/misc/pool.hpp>
 
 #define SFERES_INDIV(Class, Parent)					\
   template <typename Gen, typename Fit, typename Params, typename Exact = stc::Itself> \
@@ -78,9 +79,9 @@ namespace sferes {
                  boost::shared_ptr<Exact>& o2) {
         dbg::trace trace("phen", DBG_HERE);
         if (!o1)
-          o1 = boost::shared_ptr<Exact>(new Exact());
+          o1 = misc::Pool<Exact>::create();
         if (!o2)
-          o2 = boost::shared_ptr<Exact>(new Exact());
+          o2 = misc::Pool<Exact>::create();
         _gen.cross(i2->gen(), o1->gen(), o2->gen());
       }
       void random() {
@@ -38,36 +38,38 @@
 #include <iostream>
 #include <fstream>
 
+#include <csignal>
+#include <cstring>
 #include <boost/program_options.hpp>
 #include <boost/archive/xml_iarchive.hpp>
 #include <boost/foreach.hpp>
 
-// this is UGLY hack to avoid the name clash between
-// the C function stat() [man 2 stat] and our stat::
-// namespace
-// (asio include stat but we do not use it...)
-#define stat stat_test
-#include <boost/asio/signal_set.hpp>
-#undef stat
-
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
 
 #include <sferes/parallel.hpp>
 #include <sferes/dbg/dbg.hpp>
+#include <sferes/misc/rand.hpp>
+#include <sferes/misc/stop.hpp>
 
 namespace sferes {
   // private functions for run
   namespace run {
-    template<typename EA>
-    static void _sig_handler(EA& ea,
-                             const boost::system::error_code& error,
-                             int signal_number) {
-      if (!error) {
-        std::cout<<"sferes received signal:"<<signal_number<<std::endl;
-        ea.stop();
-      } else
-        std::cerr<<"error in sig handler:" << error.message() << std::endl;
+    // only async-signal-safe calls here: the EA stops at the end of the
+    // generation (see misc/stop.hpp); the handler is reset, so that a
+    // second signal kills the process
+    inline void _sig_handler(int signal_number) {
+      misc::request_stop(signal_number);
+    }
+    inline void _set_sig_handler() {
+      struct sigaction sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = _sig_handler;
+      sa.sa_flags = SA_RESETHAND | SA_RESTART;
+      sigemptyset(&sa.sa_mask);
+      sigaction(SIGINT, &sa, 0);
+      sigaction(SIGTERM, &sa, 0);
+      sigaction(SIGQUIT, &sa, 0);
     }
 
     void _verbose(const boost::program_options::variables_map& vm) {
@@ -114,10 +116,23 @@ namespace sferes {
       }
 
     }
+
+    template<typename Ea>
+    void _convert(const boost::program_options::variables_map& vm, Ea& ea) {
+      if (!vm.count("out")) {
+        std::cerr<<"You must specifiy an out file"<<std::endl;
+        return;
+      }
+      ea.load(vm["convert"].as<std::string>());
+      ea.write_checkpoint(vm["out"].as<std::string>());
+    }
   }// namespace run
 
   // run_ea is the main function (a wrapper to run a sferes ea)
   // it handles the command line options & set the sig handler
+  // init_rand: draw a new seed (otherwise the seed set before with
+  // misc::rand_seed() is kept); --seed overrides both; --resume restores
+  // the seed of the resumed run (see stat::State)
   template<typename Ea>
   static void run_ea(int argc,
                      char **argv,
@@ -128,22 +143,13 @@ namespace sferes {
                      bool init_rand = true) {
     ea.set_fit_proto(fit_proto);
 
-    // handler (dump in case of sigterm/sigkill)
-    /*    boost::asio::io_service io_service;
-    boost::asio::signal_set signals(io_service, SIGINT, SIGTERM, SIGQUIT);
-    signals.async_wait(boost::bind(run::_sig_handler<Ea>, boost::ref(ea), _1, _2));
-    boost::shared_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(io_service));
-    boost::thread t(boost::bind(&boost::asio::io_service::run, &io_service));
-    t.detach();*/
+    // handler (dump in case of sigint/sigterm/sigquit; sigkill cannot
+    // be caught)
+    run::_set_sig_handler();
 
     // command-line options
     namespace po = boost::program_options;
     std::cout<<"sferes2 version: "<<VERSION<<std::endl;
-    if (init_rand) {
-      time_t t = time(0) + ::getpid();
-      std::cout<<"seed: " << t << std::endl;
-      srand(t);
-    }
     po::options_description desc("Available sferes2 options");
     desc.add(add_opts);
     desc.add_options()
@@ -153,7 +159,11 @@ namespace sferes {
     ("out,o", po::value<std::string>(), "output file (when loading)")
     ("number,n", po::value<int>(), "number in stat (when loading)")
     ("dir,d", po::value<std::string>(), "custom directory for gen files (when evolving)")
+    ("seed", po::value<uint64_t>(), "seed of the random numbers (the same seed gives the same run, whatever the number of threads)")
     ("resume,r", po::value<std::string>(), "load a full state and resume the algorithm")
+    ("full-dump-period", po::value<size_t>(), "write a full gen file every k dumps, and deltas of the previous dump in between")
+    ("stop-deadline", po::value<double>(), "after SIGINT/SIGTERM/SIGQUIT, abandon the current evaluations after this time in seconds (default: finish them), then write the last complete generation")
+    ("convert", po::value<std::string>(), "convert a gen file to a columnar checkpoint (written to --out)")
     ("verbose,v", po::value<std::vector<std::string> >()->multitoken(),
      "verbose output, available default streams : all, ea, fit, phen, trace \
         (e.g. use -v ea -v trace to see the trace of the ea)")
@@ -171,19 +181,35 @@ namespace sferes {
     if (vm.count("verbose")) {
       run::_verbose(vm);
     }
+    // the seed is printed so that the run can be replayed
+    if (vm.count("seed"))
+      misc::rand_seed(vm["seed"].as<uint64_t>());
+    else if (init_rand)
+      misc::rand_seed(misc::random_seed());
+    if (!vm.count("resume"))
+      std::cout<<"seed: " << misc::rand_seed() << std::endl;
     if (vm.count("dir")) {
       ea.set_res_dir(vm["dir"].as<std::string>());
     }
+    if (vm.count("stop-deadline"))
+      misc::set_stop_deadline(vm["stop-deadline"].as<double>());
+    if (vm.count("full-dump-period"))
+      ea.set_full_dump_period(vm["full-dump-period"].as<size_t>());
     parallel::init();
     if (vm.count("load")) {
       run::_load(vm, ea);
+    } else if (vm.count("convert")) {
+      run::_convert(vm, ea);
     } else if (vm.count("resume")) {
       ea.resume(vm["resume"].as<std::string>());
-      ea.write();
+      // (when interrupted, the ea has written the last complete generation)
+      if (!ea.is_stopped())
+        ea.write();
       std::cout<<"final state written -- "<<ea.gen()<<std::endl;
     } else {
       ea.run(argv[0]);
-      ea.write();
+      if (!ea.is_stopped())
+        ea.write();
       std::cout<<"final state written -- "<<ea.gen()<<std::endl;
     }
   }
@@ -0,0 +1,102 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef STAT_COMPACT_ARCHIVE_
+#define STAT_COMPACT_ARCHIVE_
+
+#include <cstdint>
+#include <vector>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <sferes/stat/stat.hpp>
+
+namespace sferes {
+  namespace stat {
+    /// Stat to be used with Novelty Search and a knn::Compact index: save
+    /// the ids and the behaviour descriptors of the archive (see Archive to
+    /// save the individuals)
+    /// Warning: it assumes that the Novelty modifier is the first modifier!
+    SFERES_STAT(CompactArchive, Stat) {
+    public:
+      CompactArchive() : _dim(0) {}
+      template<typename E>
+      void refresh(const E& ea) {
+        _ids = ea.template fit_modifier<0>().ids();
+        _descriptors = ea.template fit_modifier<0>().index().descriptors();
+        _dim = ea.template fit_modifier<0>().index().dim();
+
+        if (ea.dump_enabled()) {
+          this->_create_log_file(ea, "archive.dat");
+          (*this->_log_file) << ea.gen() << " " << ea.nb_evals() << " " << _ids.size() << std::endl;
+        }
+      }
+      // the id then the descriptor of the point k
+      void show(std::ostream& os, size_t k) const {
+        os << _ids[k];
+        for (size_t d = 0; d < _dim; ++d)
+          os << " " << _descriptors[k * _dim + d];
+        os << std::endl;
+      }
+      size_t size() const {
+        return _ids.size();
+      }
+      // see Novelty::ids()
+      const std::vector<uint64_t>& ids() const {
+        return _ids;
+      }
+      // size() rows of dim() floats
+      const std::vector<float>& descriptors() const {
+        return _descriptors;
+      }
+      size_t dim() const {
+        return _dim;
+      }
+      template<class Archive>
+      void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_ids);
+        ar & BOOST_SERIALIZATION_NVP(_descriptors);
+        ar & BOOST_SERIALIZATION_NVP(_dim);
+      }
+    protected:
+      std::vector<uint64_t> _ids;
+      std::vector<float> _descriptors;
+      size_t _dim;
+    };
+  }
+}
+#endif
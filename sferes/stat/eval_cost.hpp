@@ -0,0 +1,112 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+
+#ifndef EVAL_COST_
+#define EVAL_COST_
+
+#include <algorithm>
+#include <vector>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/vector.hpp>
+#include <sferes/stat/stat.hpp>
+
+namespace sferes {
+  namespace stat {
+    // load of the evaluator (eval::Parallel) for the last generation:
+    // makespan, idle time of the threads, and histogram of the evaluation
+    // times (nb_bins bins between 0 and the longest evaluation)
+    // log format (eval_cost.dat):
+    // gen nb_evals makespan idle_time max_cost bin_0 ... bin_{nb_bins-1}
+    SFERES_STAT(EvalCost, Stat) {
+    public:
+      SFERES_CONST size_t nb_bins = 10;
+
+      EvalCost() : _makespan(0), _idle_time(0), _max_cost(0), _histogram(nb_bins, 0) {}
+
+      template<typename E>
+      void refresh(const E& ea) {
+        _makespan = ea.eval().makespan();
+        _idle_time = ea.eval().idle_time();
+        const std::vector<float>& costs = ea.eval().costs();
+        _max_cost = costs.empty() ? 0 : *std::max_element(costs.begin(), costs.end());
+        std::fill(_histogram.begin(), _histogram.end(), 0);
+        for (size_t i = 0; i < costs.size(); ++i) {
+          size_t b = _max_cost > 0 ? (size_t)(costs[i] / _max_cost * nb_bins) : 0;
+          ++_histogram[std::min(b, nb_bins - 1)];
+        }
+
+        this->_create_log_file(ea, "eval_cost.dat");
+        if (ea.dump_enabled()) {
+          (*this->_log_file) << ea.gen() << " " << ea.nb_evals() << " "
+                             << _makespan << " " << _idle_time << " " << _max_cost;
+          for (size_t i = 0; i < _histogram.size(); ++i)
+            (*this->_log_file) << " " << _histogram[i];
+          (*this->_log_file) << std::endl;
+        }
+      }
+      void show(std::ostream& os, size_t k) const {
+        os << "makespan:" << _makespan << " idle:" << _idle_time
+           << " max cost:" << _max_cost << std::endl;
+      }
+      float makespan() const {
+        return _makespan;
+      }
+      float idle_time() const {
+        return _idle_time;
+      }
+      float max_cost() const {
+        return _max_cost;
+      }
+      const std::vector<size_t>& histogram() const {
+        return _histogram;
+      }
+      template<class Archive>
+      void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_makespan);
+        ar & BOOST_SERIALIZATION_NVP(_idle_time);
+        ar & BOOST_SERIALIZATION_NVP(_max_cost);
+        ar & BOOST_SERIALIZATION_NVP(_histogram);
+      }
+    protected:
+      float _makespan, _idle_time, _max_cost;
+      std::vector<size_t> _histogram;
+    };
+  }
+}
+#endif
@@ -0,0 +1,117 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#ifndef MPI_WORKERS_
+#define MPI_WORKERS_
+
+#include <vector>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/vector.hpp>
+#include <sferes/stat/stat.hpp>
+
+namespace sferes {
+  namespace stat {
+    // state of the workers of the MPI evaluator (eval::Mpi, eval::MpiParallel)
+    // log format (mpi_workers.dat), one line per generation:
+    // gen nb_evals nb_alive [throughput nb_evaluated failures] for each worker
+    // (throughput in individuals per second)
+    SFERES_STAT(MpiWorkers, Stat) {
+    public:
+      MpiWorkers() : _nb_alive(0) {}
+
+      template<typename E>
+      void refresh(const E& ea) {
+        size_t n = ea.eval().nb_workers();
+        _throughput.resize(n);
+        _nb_evaluated.resize(n);
+        _failures.resize(n);
+        _nb_alive = 0;
+        // eval() has not been called yet on the master
+        if (ea.nb_evals() == 0)
+          return;
+        for (size_t w = 1; w <= n; ++w) {
+          _throughput[w - 1] = ea.eval().throughput(w);
+          _nb_evaluated[w - 1] = ea.eval().nb_evaluated(w);
+          _failures[w - 1] = ea.eval().failures(w);
+          if (ea.eval().alive(w))
+            ++_nb_alive;
+        }
+
+        this->_create_log_file(ea, "mpi_workers.dat");
+        if (ea.dump_enabled()) {
+          (*this->_log_file) << ea.gen() << " " << ea.nb_evals() << " " << _nb_alive;
+          for (size_t i = 0; i < n; ++i)
+            (*this->_log_file) << " " << _throughput[i] << " "
+                               << _nb_evaluated[i] << " " << _failures[i];
+          (*this->_log_file) << std::endl;
+        }
+      }
+      void show(std::ostream& os, size_t k) const {
+        os << "alive workers:" << _nb_alive << std::endl;
+        for (size_t i = 0; i < _throughput.size(); ++i)
+          os << "worker " << i + 1 << " throughput:" << _throughput[i]
+             << " evaluated:" << _nb_evaluated[i]
+             << " failures:" << _failures[i] << std::endl;
+      }
+      size_t nb_alive() const {
+        return _nb_alive;
+      }
+      const std::vector<double>& throughput() const {
+        return _throughput;
+      }
+      const std::vector<size_t>& nb_evaluated() const {
+        return _nb_evaluated;
+      }
+      const std::vector<size_t>& failures() const {
+        return _failures;
+      }
+      template<class Archive>
+      void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_nb_alive);
+        ar & BOOST_SERIALIZATION_NVP(_throughput);
+        ar & BOOST_SERIALIZATION_NVP(_nb_evaluated);
+        ar & BOOST_SERIALIZATION_NVP(_failures);
+      }
+    protected:
+      size_t _nb_alive;
+      std::vector<double> _throughput;
+      std::vector<size_t> _nb_evaluated, _failures;
+    };
+  }
+}
+#endif
@@ -38,11 +38,13 @@
 #ifndef PARETO_FRONT_HPP_
 #define PARETO_FRONT_HPP_
 
+#include <algorithm>
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <sferes/stc.hpp>
 #include <sferes/parallel.hpp>
 #include <sferes/fit/fitness.hpp>
+#include <sferes/fit/obj_matrix.hpp>
 #include <sferes/stat/stat.hpp>
 
 namespace sferes {
@@ -53,9 +55,7 @@ namespace sferes {
       // assume a ea.pareto_front() method
       template<typename E>
       void refresh(const E& ea) {
-        _pareto_front = ea.pareto_front();
-        parallel::sort(_pareto_front.begin(), _pareto_front.end(),
-                       fit::compare_objs_lex());
+        _sort_lex(ea.pareto_front());
         this->_create_log_file(ea, "pareto.dat");
         if (ea.dump_enabled())
           show_all(*(this->_log_file), ea.gen(), ea.nb_evals());
@@ -95,6 +95,21 @@ namespace sferes {
 
     protected:
       pareto_t _pareto_front;
+
+      // copy the front in lexicographic order (sorted on a snapshot of the objectives)
+      void _sort_lex(const pareto_t& front) {
+        _pareto_front.resize(front.size());
+        if (front.empty())
+          return;
+        fit::ObjMatrix objs;
+        objs.snapshot(front);
+        std::vector<size_t> order(front.size());
+        for (size_t i = 0; i < order.size(); ++i)
+          order[i] = i;
+        std::sort(order.begin(), order.end(), fit::compare_rows_lex(objs));
+        for (size_t i = 0; i < order.size(); ++i)
+          _pareto_front[i] = front[order[i]];
+      }
     };
   }
 }
@@ -37,6 +37,10 @@
 
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/nvp.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/mpl/int.hpp>
+#include <boost/mpl/integral_c_tag.hpp>
+#include <sferes/misc/rand.hpp>
 #include <sferes/stat/stat.hpp>
 #include <sferes/fit/fitness.hpp>
 
@@ -44,12 +48,18 @@ namespace sferes {
   namespace stat {
     // a statistics class that saves the full population + gen number
     // this is useful for restarting sferes when it is killed
+    // (+ the seed of the run, so that a resumed run draws the same random
+    // numbers as the one that was interrupted; not in the files written
+    // before version 1 of this class)
     SFERES_STAT(State, Stat) {
     public:
+      State() : _gen(0), _seed(0), _has_seed(false) {}
       template<typename E>
       void refresh(const E& ea) {
         _pop = ea.pop();
         _gen = ea.gen();
+        _seed = misc::rand_seed();
+        _has_seed = true;
       }
       // show the n-th individual from the population
       void show(std::ostream& os, size_t k) {
@@ -66,16 +76,49 @@ namespace sferes {
       size_t gen() const {
         return _gen;
       }
+      uint64_t seed() const {
+        return _seed;
+      }
+      bool has_seed() const {
+        return _has_seed;
+      }
+      void set_seed(uint64_t seed) {
+        _seed = seed;
+        _has_seed = true;
+      }
+      // e.g. from a columnar checkpoint (see ea/checkpoint.hpp)
+      void set(size_t gen, const std::vector<boost::shared_ptr<Phen> >& pop) {
+        _gen = gen;
+        _pop = pop;
+      }
       template<class Archive>
       void serialize(Archive & ar, const unsigned int version) {
         _last_written_gen = _gen;
         ar & BOOST_SERIALIZATION_NVP(_gen);
         ar & BOOST_SERIALIZATION_NVP(_pop);
+        if (version >= 1) {
+          ar & BOOST_SERIALIZATION_NVP(_seed);
+          _has_seed = true;
+        }
       }
     protected:
       std::vector<boost::shared_ptr<Phen> > _pop;
       size_t _gen;
       size_t _last_written_gen;
+      uint64_t _seed;
+      bool _has_seed;
+    };
+  }
+}
+
+// (BOOST_CLASS_VERSION does not work with class templates)
+namespace boost {
+  namespace serialization {
+    template<typename Phen, typename Params, typename Exact>
+    struct version<sferes::stat::State<Phen, Params, Exact> > {
+      typedef mpl::integral_c_tag tag;
+      typedef mpl::int_<1> type;
+      BOOST_STATIC_CONSTANT(int, value = version::type::value);
     };
   }
 }
@@ -77,6 +77,15 @@ namespace stc {
   };
   struct _Params {};
 
+  // Void<T>::type is void if T is a valid type, to detect an optional
+  // member with a partial specialization, e.g.
+  //   template<typename P, typename Enable = void> struct x { ... };
+  //   template<typename P> struct x<P, typename Void<decltype(P::y)>::type> { ... };
+  template <typename T>
+  struct Void {
+    typedef void type;
+  };
+
 }
 
 #define STC_FIND_EXACT(Type) typename stc::FindExact<Type<Exact>, Exact>::ret
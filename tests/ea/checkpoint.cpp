@@ -0,0 +1,339 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE checkpoint
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <sferes/phen/parameters.hpp>
+#include <sferes/gen/evo_float.hpp>
+#include <sferes/ea/nsga2.hpp>
+#include <sferes/eval/eval.hpp>
+#include <sferes/stat/pareto_front.hpp>
+#include <sferes/modif/dummy.hpp>
+
+using namespace sferes;
+using namespace sferes::gen::evo_float;
+
+struct Params {
+  struct evo_float {
+    SFERES_CONST float cross_rate = 0.5f;
+    SFERES_CONST float mutation_rate = 1.0f / 10.0f;
+    SFERES_CONST float eta_m = 15.0f;
+    SFERES_CONST float eta_c = 10.0f;
+    SFERES_CONST mutation_t mutation_type = polynomial;
+    SFERES_CONST cross_over_t cross_over_type = sbx;
+  };
+  struct pop {
+    SFERES_CONST unsigned size = 100;
+    SFERES_CONST unsigned nb_gen = 20;
+    SFERES_CONST float initial_aleat = 1.0f;
+    SFERES_CONST int dump_period = 10;
+  };
+  struct parameters {
+    SFERES_CONST float min = 0.0f;
+    SFERES_CONST float max = 1.0f;
+  };
+};
+
+SFERES_FITNESS(FitZDT1, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(2);
+    float g = 1.0f;
+    for (size_t i = 1; i < ind.size(); ++i)
+      g += 9.0f * ind.data(i) / (ind.size() - 1);
+    this->_objs[0] = -ind.data(0);
+    this->_objs[1] = -g * (1.0f - sqrtf(ind.data(0) / g));
+    this->_value = this->_objs[0] + this->_objs[1];
+  }
+};
+
+// a dump every 2 generations
+struct ParamsDelta : public Params {
+  struct pop {
+    SFERES_CONST unsigned size = 100;
+    SFERES_CONST unsigned nb_gen = 20;
+    SFERES_CONST float initial_aleat = 1.0f;
+    SFERES_CONST int dump_period = 2;
+  };
+};
+
+typedef gen::EvoFloat<10, Params> gen_t;
+typedef phen::Parameters<gen_t, FitZDT1<Params>, Params> phen_t;
+typedef boost::fusion::vector<stat::ParetoFront<phen_t, Params> > stat_t;
+typedef ea::Nsga2<phen_t, eval::Eval<Params>, stat_t, modif::Dummy<>, Params> ea_t;
+typedef stat::State<phen_t, Params> state_t;
+typedef ea::Nsga2<phen_t, eval::Eval<Params>, stat_t, modif::Dummy<>, ParamsDelta> ea_delta_t;
+typedef stat::State<phen_t, ParamsDelta> state_delta_t;
+
+void check_same(const std::vector<boost::shared_ptr<phen_t> >& p1,
+                const std::vector<boost::shared_ptr<phen_t> >& p2) {
+  BOOST_REQUIRE_EQUAL(p1.size(), p2.size());
+  for (size_t i = 0; i < p1.size(); ++i) {
+    for (size_t j = 0; j < p1[i]->size(); ++j)
+      BOOST_CHECK_EQUAL(p1[i]->gen().data(j), p2[i]->gen().data(j));
+    BOOST_CHECK_EQUAL(p1[i]->fit().value(), p2[i]->fit().value());
+    BOOST_CHECK(p1[i]->fit().objs() == p2[i]->fit().objs());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_checkpoint) {
+  ea_t ea;
+  ea.run();
+  std::string ckpt = ea.res_dir() + "/gen_19.ckpt";
+  ea.write_checkpoint(ckpt);
+  BOOST_CHECK(ea::checkpoint::is_checkpoint(ckpt));
+  BOOST_CHECK(!ea::checkpoint::is_checkpoint(ea.res_dir() + "/gen_10"));
+
+  const state_t& s = *boost::fusion::find<state_t>(ea.stat());
+  {
+    // the genomes and objectives are read in place
+    ea::checkpoint::Mapped m(ckpt);
+    BOOST_CHECK_EQUAL(m.gen(), s.gen());
+    BOOST_REQUIRE_EQUAL(m.pop_size(), (size_t)Params::pop::size);
+    BOOST_CHECK_EQUAL(m.genome_size(), 10);
+    BOOST_CHECK_EQUAL(m.nb_objs(), 2);
+    BOOST_CHECK_EQUAL(m.pop_blob(), 1);
+    BOOST_CHECK(m.has_seed());
+    BOOST_CHECK(!m.has_indivs());
+    BOOST_CHECK_EQUAL(m.seed(), s.seed());
+    BOOST_CHECK_EQUAL((size_t)m.genome<float>(0) % 64, 0);
+    for (size_t i = 0; i < m.pop_size(); ++i) {
+      BOOST_CHECK_EQUAL(m.genome<float>(i)[3], s.pop()[i]->gen().data(3));
+      BOOST_CHECK_EQUAL(m.objs(1)[i], s.pop()[i]->fit().obj(1));
+    }
+  }
+
+  // the columnar checkpoint gives the same stats as the boost archive
+  ea_t ea1, ea2;
+  ea1.load(ea.res_dir() + "/gen_10");
+  ea1.write_checkpoint(ea.res_dir() + "/gen_10.ckpt");
+  ea2.load(ea.res_dir() + "/gen_10.ckpt");
+  const state_t& s1 = *boost::fusion::find<state_t>(ea1.stat());
+  const state_t& s2 = *boost::fusion::find<state_t>(ea2.stat());
+  BOOST_CHECK_EQUAL(s1.gen(), 10);
+  BOOST_CHECK_EQUAL(s2.gen(), 10);
+  BOOST_CHECK_EQUAL(s1.seed(), misc::rand_seed());
+  BOOST_CHECK_EQUAL(s2.seed(), s1.seed());
+  check_same(s1.pop(), s2.pop());
+  check_same(ea1.stat<0>().pareto_front(), ea2.stat<0>().pareto_front());
+
+  // resume from a checkpoint
+  ea_t ea3;
+  ea3.resume(ckpt);
+  BOOST_CHECK_EQUAL(ea3.gen(), (size_t)Params::pop::nb_gen);
+
+  // a truncated checkpoint is detected
+  boost::filesystem::resize_file(ckpt, boost::filesystem::file_size(ckpt) / 2);
+  BOOST_CHECK_THROW(ea::checkpoint::Mapped m(ckpt), std::runtime_error);
+
+  boost::filesystem::remove_all(ea.res_dir());
+}
+
+// the individuals have members that the matrices do not store
+struct ParamsIndivs : public Params {
+  struct pop : public Params::pop {
+    SFERES_CONST bool checkpoint_indivs = true;
+  };
+};
+struct ParamsDeltaIndivs : public ParamsDelta {
+  struct pop : public ParamsDelta::pop {
+    SFERES_CONST bool checkpoint_indivs = true;
+  };
+};
+
+// a fitness with members that the matrices do not store
+SFERES_FITNESS(FitDesc, sferes::fit::Fitness) {
+public:
+  FitDesc() : _stamp(0) {}
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(2);
+    this->_objs[0] = -ind.data(0);
+    this->_objs[1] = -ind.data(1);
+    this->_value = this->_objs[0] + this->_objs[1];
+    _desc.resize(2);
+    _desc[0] = ind.data(2);
+    _desc[1] = ind.data(3);
+  }
+  const std::vector<float>& desc() const {
+    return _desc;
+  }
+  size_t stamp() const {
+    return _stamp;
+  }
+  void set_stamp(size_t s) {
+    _stamp = s;
+  }
+  template<class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    sferes::fit::Fitness<Params, typename stc::FindExact<FitDesc<Params, Exact>, Exact>::ret>::serialize(ar, version);
+    ar & BOOST_SERIALIZATION_NVP(_desc);
+    ar & BOOST_SERIALIZATION_NVP(_stamp);
+  }
+protected:
+  std::vector<float> _desc;
+  size_t _stamp;
+};
+
+// changes the individuals of the population without changing their genome
+SFERES_CLASS(ModifStamp) {
+public:
+  template<typename Ea>
+  void apply(Ea& ea) {
+    for (size_t i = 0; i < ea.pop().size(); ++i)
+      ea.pop()[i]->fit().set_stamp(ea.gen());
+  }
+};
+
+// the individuals are loaded from their blobs
+BOOST_AUTO_TEST_CASE(test_checkpoint_indiv) {
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_desc_t;
+  typedef ea::Nsga2<phen_desc_t, eval::Eval<Params>, boost::fusion::vector<>,
+          modif::Dummy<>, ParamsIndivs> ea_desc_t;
+  typedef stat::State<phen_desc_t, ParamsIndivs> state_desc_t;
+  ea_desc_t ea;
+  ea.run();
+  std::string ckpt = ea.res_dir() + "/gen_19.ckpt";
+  ea.write_checkpoint(ckpt);
+  BOOST_CHECK(ea::checkpoint::Mapped(ckpt).has_indivs());
+  ea_desc_t ea2;
+  ea2.load(ckpt);
+  const state_desc_t& s1 = *boost::fusion::find<state_desc_t>(ea.stat());
+  const state_desc_t& s2 = *boost::fusion::find<state_desc_t>(ea2.stat());
+  BOOST_REQUIRE_EQUAL(s1.pop().size(), s2.pop().size());
+  for (size_t i = 0; i < s1.pop().size(); ++i) {
+    BOOST_CHECK_EQUAL(s2.pop()[i]->fit().desc().size(), 2);
+    BOOST_CHECK(s1.pop()[i]->fit().desc() == s2.pop()[i]->fit().desc());
+  }
+  boost::filesystem::remove_all(ea.res_dir());
+}
+
+BOOST_AUTO_TEST_CASE(test_delta_checkpoint) {
+  // the same run (same seed), with full gen files and with deltas
+  misc::rand_seed(42);
+  ea_delta_t ea1;
+  ea1.set_res_dir("test_delta_full");
+  ea1.run();
+  misc::rand_seed(42);
+  ea_delta_t ea2;
+  ea2.set_res_dir("test_delta");
+  ea2.set_full_dump_period(4);
+  ea2.run();
+
+  for (size_t g = 0; g < ParamsDelta::pop::nb_gen; g += ParamsDelta::pop::dump_period) {
+    std::string f1 = ea1.res_dir() + "/gen_" + boost::lexical_cast<std::string>(g);
+    std::string f2 = ea2.res_dir() + "/gen_" + boost::lexical_cast<std::string>(g);
+    {
+      ea::checkpoint::Mapped m(f2);
+      bool is_delta = (g / ParamsDelta::pop::dump_period) % 4 != 0;
+      BOOST_CHECK_EQUAL(m.is_delta(), is_delta);
+      if (is_delta) {
+        BOOST_CHECK_EQUAL(m.parent_gen(), g - ParamsDelta::pop::dump_period);
+        // the survivors of the parent are not stored again
+        BOOST_CHECK(m.nb_genomes() < m.pop_size());
+      }
+    }
+    // a delta gives the same stats as a full gen file
+    ea_delta_t e1, e2;
+    e1.load(f1);
+    e2.load(f2);
+    const state_delta_t& s1 = *boost::fusion::find<state_delta_t>(e1.stat());
+    const state_delta_t& s2 = *boost::fusion::find<state_delta_t>(e2.stat());
+    BOOST_CHECK_EQUAL(s2.gen(), g);
+    check_same(s1.pop(), s2.pop());
+    check_same(e1.stat<0>().pareto_front(), e2.stat<0>().pareto_front());
+  }
+  // resume from a delta
+  ea_delta_t ea3;
+  ea3.set_res_dir("test_delta_resume");
+  ea3.resume(ea2.res_dir() + "/gen_14");
+  BOOST_CHECK_EQUAL(ea3.gen(), (size_t)ParamsDelta::pop::nb_gen);
+
+  // a delta cannot be replayed without its parent
+  boost::filesystem::remove(ea2.res_dir() + "/gen_12");
+  ea::checkpoint::Mapped m(ea2.res_dir() + "/gen_14");
+  std::vector<boost::shared_ptr<phen_t> > pop;
+  BOOST_CHECK_THROW(m.pop(pop), std::runtime_error);
+
+  boost::filesystem::remove_all(ea1.res_dir());
+  boost::filesystem::remove_all(ea2.res_dir());
+  boost::filesystem::remove_all(ea3.res_dir());
+}
+
+// a survivor that changed is stored again in the delta
+BOOST_AUTO_TEST_CASE(test_delta_checkpoint_indiv) {
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_desc_t;
+  typedef ea::Nsga2<phen_desc_t, eval::Eval<Params>, boost::fusion::vector<>,
+          ModifStamp<>, ParamsDeltaIndivs> ea_desc_t;
+  typedef stat::State<phen_desc_t, ParamsDeltaIndivs> state_desc_t;
+  misc::rand_seed(42);
+  ea_desc_t ea1;
+  ea1.set_res_dir("test_delta_indiv_full");
+  ea1.run();
+  misc::rand_seed(42);
+  ea_desc_t ea2;
+  ea2.set_res_dir("test_delta_indiv");
+  ea2.set_full_dump_period(4);
+  ea2.run();
+
+  for (size_t g = 0; g < ParamsDelta::pop::nb_gen; g += ParamsDelta::pop::dump_period) {
+    std::string f1 = ea1.res_dir() + "/gen_" + boost::lexical_cast<std::string>(g);
+    std::string f2 = ea2.res_dir() + "/gen_" + boost::lexical_cast<std::string>(g);
+    {
+      ea::checkpoint::Mapped m(f2);
+      BOOST_CHECK_EQUAL(m.nb_genomes(), m.pop_size());
+    }
+    ea_desc_t e1, e2;
+    e1.load(f1);
+    e2.load(f2);
+    const state_desc_t& s1 = *boost::fusion::find<state_desc_t>(e1.stat());
+    const state_desc_t& s2 = *boost::fusion::find<state_desc_t>(e2.stat());
+    BOOST_REQUIRE_EQUAL(s1.pop().size(), s2.pop().size());
+    for (size_t i = 0; i < s1.pop().size(); ++i) {
+      BOOST_CHECK_EQUAL(s2.pop()[i]->fit().stamp(), g);
+      BOOST_CHECK_EQUAL(s1.pop()[i]->fit().stamp(), s2.pop()[i]->fit().stamp());
+      BOOST_CHECK(s1.pop()[i]->fit().desc() == s2.pop()[i]->fit().desc());
+    }
+  }
+  boost::filesystem::remove_all(ea1.res_dir());
+  boost::filesystem::remove_all(ea2.res_dir());
+}
@@ -51,6 +51,7 @@
 #include <sferes/misc/rand.hpp>
 
 
+#include <sferes/fit/dominate_block.hpp>
 #include <sferes/ea/dom_sort.hpp>
 #include <sferes/ea/dom_sort_basic.hpp>
 
@@ -124,3 +125,143 @@ BOOST_AUTO_TEST_CASE(test_domsort) {
     }
   }
 }
+
+template<typename Pop>
+void check_same_fronts(std::vector<Pop>& f1, std::vector<Pop>& f2) {
+  BOOST_REQUIRE_EQUAL(f1.size(), f2.size());
+  for (size_t i = 0; i < f1.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(f1[i].size(), f2[i].size());
+    std::sort(f1[i].begin(), f1[i].end());
+    std::sort(f2[i].begin(), f2[i].end());
+    for (size_t j = 0; j < f1[i].size(); ++j)
+      BOOST_CHECK(f1[i][j] == f2[i][j]);
+  }
+}
+
+// the sorting backends must give the same fronts, for different numbers
+// of individuals and objectives (see examples/bench_dom_sort.cpp for their
+// speed)
+BOOST_AUTO_TEST_CASE(test_domsort_ens) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitRand<Params>, Params> phen_t;
+  typedef boost::shared_ptr<phen_t> pphen_t;
+  typedef std::vector<pphen_t> pop_t;
+
+  size_t sizes[] = { 100, 500 };
+  size_t objs[] = { 2, 3, 4, 6 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(size_t); ++s)
+    for (size_t o = 0; o < sizeof(objs) / sizeof(size_t); ++o)
+      // with discretized objectives, there are many duplicates
+      for (int discrete = 0; discrete < 2; ++discrete) {
+        pop_t pop;
+        for (size_t i = 0; i < sizes[s]; ++i) {
+          pphen_t ind(new phen_t());
+          ind->fit().resize_obj(objs[o]);
+          for (size_t k = 0; k < objs[o]; ++k) {
+            float v = misc::rand<float>(10);
+            ind->fit().set_obj(k, discrete ? floorf(v) : v);
+          }
+          pop.push_back(ind);
+        }
+        std::vector<pop_t> f_deb, f_ss, f_bs;
+        std::vector<size_t> r_deb, r_ss, r_bs;
+        ea::dom_sort_f()(pop, f_deb, r_deb);
+        ea::dom_sort_ens_ss_f()(pop, f_ss, r_ss);
+        ea::dom_sort_ens_bs_f()(pop, f_bs, r_bs);
+        BOOST_CHECK(r_deb == r_ss);
+        BOOST_CHECK(r_deb == r_bs);
+        check_same_fronts(f_deb, f_ss);
+        check_same_fronts(f_deb, f_bs);
+      }
+}
+
+// the objective matrix must give the same dominance relation as the fitness
+BOOST_AUTO_TEST_CASE(test_obj_matrix) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitRand<Params>, Params> phen_t;
+  typedef boost::shared_ptr<phen_t> pphen_t;
+  typedef std::vector<pphen_t> pop_t;
+
+  pop_t pop;
+  for (size_t i = 0; i < 100; ++i) {
+    pphen_t ind(new phen_t());
+    ind->fit().resize_obj(3);
+    for (size_t k = 0; k < 3; ++k)
+      ind->fit().set_obj(k, floorf(misc::rand<float>(3)));
+    pop.push_back(ind);
+  }
+  fit::ObjMatrix objs;
+  objs.snapshot(pop);
+  BOOST_CHECK_EQUAL(objs.size(), pop.size());
+  BOOST_CHECK_EQUAL(objs.nb_objs(), 3);
+  BOOST_CHECK_EQUAL(objs.stride() % fit::ObjMatrix::block_size, 0);
+  for (size_t i = 0; i < pop.size(); ++i)
+    for (size_t j = 0; j < pop.size(); ++j) {
+      BOOST_CHECK_EQUAL(objs.dominate_flag(i, j),
+                        fit::dominate_flag(pop[i], pop[j]));
+      BOOST_CHECK_EQUAL(objs.dominate_flag(pop[i]->fit().objs(), j),
+                        fit::dominate_flag(pop[i], pop[j]));
+    }
+}
+
+// the block kernel must give the same result as the scalar comparison
+BOOST_AUTO_TEST_CASE(test_dominate_block) {
+  for (size_t m = 1; m <= 8; ++m) {
+    size_t size = 37 + m;
+    fit::ObjMatrix objs;
+    objs.resize(size, m);
+    std::vector<float> o(m);
+    for (size_t i = 0; i < size; ++i) {
+      for (size_t k = 0; k < m; ++k)
+        o[k] = floorf(misc::rand<float>(3));
+      objs.set_row(i, o);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      objs.row(i, o);
+      for (size_t b = 0; b < size; b += fit::ObjMatrix::block_size) {
+        unsigned dominating, dominated;
+        fit::dominate_block(&o[0], objs, b, dominating, dominated);
+        if (m == 3) {
+          unsigned dominating3, dominated3;
+          fit::dominate_block<3>(&o[0], objs, b, dominating3, dominated3);
+          BOOST_CHECK_EQUAL(dominating, dominating3);
+          BOOST_CHECK_EQUAL(dominated, dominated3);
+        }
+        for (size_t j = 0; j < fit::ObjMatrix::block_size; ++j) {
+          int flag = b + j < size ? objs.dominate_flag(i, b + j) : 0;
+          BOOST_CHECK_EQUAL((dominating >> j) & 1, flag == 1);
+          BOOST_CHECK_EQUAL((dominated >> j) & 1, flag == -1);
+        }
+      }
+    }
+  }
+}
+
+// the buffers of dom_sort_f are reused from one call to the next
+BOOST_AUTO_TEST_CASE(test_domsort_reuse) {
+  ea::dom_sort_f sorter;
+  ea::Fronts fronts;
+  std::vector<size_t> ranks;
+  for (size_t size = 300; size > 0; size -= 100) {
+    fit::ObjMatrix objs;
+    objs.resize(size, 3);
+    std::vector<float> o(3);
+    for (size_t i = 0; i < size; ++i) {
+      for (size_t k = 0; k < 3; ++k)
+        o[k] = floorf(misc::rand<float>(5));
+      objs.set_row(i, o);
+    }
+    sorter(objs, fronts, ranks);
+    ea::Fronts fronts_ens;
+    std::vector<size_t> ranks_ens;
+    ea::dom_sort_ens_ss_f()(objs, fronts_ens, ranks_ens);
+    BOOST_CHECK(ranks == ranks_ens);
+    BOOST_REQUIRE_EQUAL(fronts.size(), fronts_ens.size());
+    BOOST_CHECK_EQUAL(fronts.nb_indivs(), size);
+    for (size_t i = 0; i < fronts.size(); ++i)
+      BOOST_CHECK(std::equal(fronts.begin(i), fronts.end(i), fronts_ens.begin(i)));
+    BOOST_CHECK_EQUAL(fronts.nb_fronts_for(1), 1);
+    BOOST_CHECK_EQUAL(fronts.nb_fronts_for(fronts.front_size(0)), 1);
+    BOOST_CHECK_EQUAL(fronts.nb_fronts_for(size), fronts.size());
+  }
+}
@@ -75,6 +75,13 @@ struct Params {
   };
 };
 
+// the same, with the batch variation operators of EvoFloat
+struct ParamsBatch : public Params {
+  struct evo_float : public Params::evo_float {
+    SFERES_CONST bool batch_variation = true;
+  };
+};
+
 template<typename Indiv>
 float _g(const Indiv &ind) {
   float g = 0.0f;
@@ -126,3 +133,98 @@ BOOST_AUTO_TEST_CASE(test_nsga2) {
   }
 
 }
+
+BOOST_AUTO_TEST_CASE(test_nsga2_ens) {
+  typedef gen::EvoFloat<30, ParamsBatch> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT2<Params>, Params> phen_t;
+  typedef eval::Parallel<Params> eval_t;
+  typedef boost::fusion::vector<stat::ParetoFront<phen_t, Params> >  stat_t;
+  typedef modif::Dummy<> modifier_t;
+  typedef ea::GenericNsga2<phen_t, eval_t, stat_t, modifier_t,
+          ea::crowd::assign_crowd<boost::shared_ptr<ea::crowd::Indiv<phen_t> > >,
+          Params, stc::Itself, ea::dom_sort_ens_ss_f> ea_t;
+  // opt-in
+  BOOST_CHECK((!gen::batch<gen::EvoFloat<30, Params> >::enabled));
+  BOOST_CHECK(gen::batch<gen_t>::enabled);
+  ea_t ea;
+
+  ea.run();
+
+  BOOST_CHECK(ea.stat<0>().pareto_front().size() > 50);
+  BOOST_FOREACH(boost::shared_ptr<phen_t> p, ea.stat<0>().pareto_front()) {
+    BOOST_CHECK(_g(*p) < 1.1);
+    BOOST_CHECK(_g(*p) > 0.0);
+  }
+}
+
+// the same, with the stats refreshed in background
+struct ParamsPipelined : public Params {
+  struct pop : public Params::pop {
+    SFERES_CONST bool pipelined = true;
+  };
+};
+
+// a stat that reads a population that Snapshot does not copy: it can
+// only be used in the default mode
+SFERES_STAT(ParentPopSize, stat::Stat) {
+public:
+  ParentPopSize() : _size(0) {}
+  template<typename E>
+  void refresh(const E& ea) {
+    _size = ea.parent_pop().size();
+  }
+  size_t size() const {
+    return _size;
+  }
+  template<class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar & BOOST_SERIALIZATION_NVP(_size);
+  }
+protected:
+  size_t _size;
+};
+
+template<typename P>
+void run_nsga2(std::vector<float>& objs) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT2<Params>, Params> phen_t;
+  typedef eval::Parallel<Params> eval_t;
+  typedef boost::fusion::vector<stat::ParetoFront<phen_t, Params> >  stat_t;
+  typedef modif::Dummy<> modifier_t;
+  typedef ea::Nsga2<phen_t, eval_t, stat_t, modifier_t, P> ea_t;
+
+  ea_t ea;
+  misc::rand_seed(42);
+  ea.run();
+  BOOST_CHECK_EQUAL(ea.template stat<0>().pareto_front().size(), ea.pareto_front().size());
+  BOOST_FOREACH(boost::shared_ptr<phen_t> p, ea.template stat<0>().pareto_front()) {
+    // a copy of the individual of the population
+    BOOST_CHECK(!ea.pipelined() || std::find(ea.pop().begin(), ea.pop().end(), p) == ea.pop().end());
+    objs.push_back(p->fit().obj(0));
+    objs.push_back(p->fit().obj(1));
+  }
+}
+
+// the stats of the pipelined mode are those of the default mode
+BOOST_AUTO_TEST_CASE(test_nsga2_pipelined) {
+  BOOST_CHECK(!ea::pipelined<Params>::value);
+  BOOST_CHECK(ea::pipelined<ParamsPipelined>::value);
+  std::vector<float> objs[2];
+  run_nsga2<Params>(objs[0]);
+  run_nsga2<ParamsPipelined>(objs[1]);
+  BOOST_CHECK(objs[0] == objs[1]);
+}
+
+// the default mode does not instantiate the pipelined mode
+BOOST_AUTO_TEST_CASE(test_nsga2_stat_parent_pop) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT2<Params>, Params> phen_t;
+  typedef eval::Parallel<Params> eval_t;
+  typedef boost::fusion::vector<ParentPopSize<phen_t, Params> >  stat_t;
+  typedef modif::Dummy<> modifier_t;
+  typedef ea::Nsga2<phen_t, eval_t, stat_t, modifier_t, Params> ea_t;
+
+  ea_t ea;
+  ea.run();
+  BOOST_CHECK_EQUAL(ea.stat<0>().size(), (size_t)Params::pop::size);
+}
@@ -117,3 +117,40 @@ BOOST_AUTO_TEST_CASE(test_rank_simple2) {
   ea.run();
 
 }
+
+struct ParamsDump : public Params {
+  struct pop : public Params::pop {
+    SFERES_CONST unsigned nb_gen = 50;
+    SFERES_CONST int dump_period = 10;
+  };
+};
+
+struct ParamsPipelined : public ParamsDump {
+  struct pop : public ParamsDump::pop {
+    SFERES_CONST bool pipelined = true;
+  };
+};
+
+template<typename P>
+float run_rank_simple() {
+  typedef gen::EvoFloat<30, ParamsDump> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT2<ParamsDump>, ParamsDump> phen_t;
+  typedef eval::Parallel<ParamsDump> eval_t;
+  typedef boost::fusion::vector<stat::BestFit<phen_t, ParamsDump> >  stat_t;
+  typedef modif::Dummy<> modifier_t;
+  typedef ea::RankSimple<phen_t, eval_t, stat_t, modifier_t, P> ea_t;
+
+  ea_t ea;
+  misc::rand_seed(42);
+  ea.run();
+  BOOST_CHECK_EQUAL(ea.template stat<1>().gen(), P::pop::nb_gen - 1);
+  for (size_t g = 0; g < P::pop::nb_gen; g += P::pop::dump_period)
+    BOOST_CHECK(boost::filesystem::exists(ea.res_dir() + "/gen_" + boost::lexical_cast<std::string>(g)));
+  boost::filesystem::remove_all(ea.res_dir());
+  return ea.template stat<0>().best()->fit().value();
+}
+
+// the pipelined mode refreshes the stats and writes the same gen files
+BOOST_AUTO_TEST_CASE(test_rank_simple_pipelined) {
+  BOOST_CHECK_EQUAL(run_rank_simple<ParamsDump>(), run_rank_simple<ParamsPipelined>());
+}
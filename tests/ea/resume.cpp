@@ -119,7 +119,9 @@ BOOST_AUTO_TEST_CASE(test_nsga2_resume) {
   typedef modif::Dummy<> modifier_t;
   typedef ea::Nsga2<phen_t, eval_t, stat_t, modifier_t, Params> ea_t;
   ea_t ea;
+  misc::rand_seed(12345);
   ea.run();// 101 generations
+  BOOST_CHECK_EQUAL(ea.stat<1>().seed(), 12345u);
   std::cout<<"nsga2 done, running some tests..."<<std::endl;
 
   ea.stat<0>().show_all(std::cout, 0);
@@ -138,7 +140,11 @@ BOOST_AUTO_TEST_CASE(test_nsga2_resume) {
   Params::pop::nb_gen = 201;
   typedef ea::Nsga2<phen_t, eval_t, stat_t, modifier_t, Params> ea2_t;
   ea2_t ea2;
+  // the seed of the interrupted run is restored
+  misc::rand_seed(1);
   ea2.resume(ea.res_dir() + "/gen_100");
+  BOOST_CHECK_EQUAL(misc::rand_seed(), 12345u);
+  BOOST_CHECK_EQUAL(ea2.stat<1>().seed(), 12345u);
   ea2.stat<0>().show_all(std::cout, 0);
   BOOST_CHECK(ea2.stat<0>().pareto_front().size() > 50);
 
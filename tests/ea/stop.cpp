@@ -0,0 +1,199 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE stop
+
+#include <atomic>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <sferes/phen/parameters.hpp>
+#include <sferes/gen/evo_float.hpp>
+#include <sferes/ea/nsga2.hpp>
+#include <sferes/eval/parallel.hpp>
+#include <sferes/stat/pareto_front.hpp>
+#include <sferes/modif/dummy.hpp>
+#include <sferes/run.hpp>
+
+using namespace sferes;
+using namespace sferes::gen::evo_float;
+
+struct Params {
+  struct evo_float {
+    SFERES_CONST float cross_rate = 0.5f;
+    SFERES_CONST float mutation_rate = 1.0f / 10.0f;
+    SFERES_CONST float eta_m = 15.0f;
+    SFERES_CONST float eta_c = 10.0f;
+    SFERES_CONST mutation_t mutation_type = polynomial;
+    SFERES_CONST cross_over_t cross_over_type = sbx;
+  };
+  struct pop {
+    SFERES_CONST unsigned size = 100;
+    SFERES_CONST unsigned nb_gen = 10;
+    SFERES_CONST float initial_aleat = 1.0f;
+    SFERES_CONST int dump_period = 100;
+  };
+  struct parameters {
+    SFERES_CONST float min = 0.0f;
+    SFERES_CONST float max = 1.0f;
+  };
+};
+
+// the stop is requested during the evaluation number stop_at
+std::atomic<size_t> nb_evals(0);
+size_t stop_at = 0;
+
+SFERES_FITNESS(FitZDT1, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    if (++nb_evals == stop_at)
+      misc::request_stop(SIGTERM);
+    this->_objs.resize(2);
+    float g = 1.0f;
+    for (size_t i = 1; i < ind.size(); ++i)
+      g += 9.0f * ind.data(i) / (ind.size() - 1);
+    this->_objs[0] = -ind.data(0);
+    this->_objs[1] = -g * (1.0f - sqrtf(ind.data(0) / g));
+  }
+};
+
+typedef gen::EvoFloat<10, Params> gen_t;
+typedef phen::Parameters<gen_t, FitZDT1<Params>, Params> phen_t;
+typedef boost::fusion::vector<stat::ParetoFront<phen_t, Params> > stat_t;
+typedef ea::Nsga2<phen_t, eval::Parallel<Params>, stat_t, modif::Dummy<>, Params> ea_t;
+typedef stat::State<phen_t, Params> state_t;
+
+std::string status(const ea_t& ea) {
+  std::ifstream ifs((ea.res_dir() + "/status").c_str());
+  std::string s;
+  ifs >> s;
+  return s;
+}
+
+// random_pop() then each generation evaluate 100 individuals
+size_t eval_of_gen(size_t gen) {
+  return Params::pop::size * (gen + 1) + Params::pop::size / 2;
+}
+
+BOOST_AUTO_TEST_CASE(test_stop) {
+  // the generation 5 is finished, then written
+  misc::clear_stop();
+  misc::set_stop_deadline(-1);
+  nb_evals = 0;
+  stop_at = eval_of_gen(5);
+  ea_t ea;
+  ea.set_res_dir("test_stop");
+  ea.run();
+  BOOST_CHECK(ea.is_stopped());
+  BOOST_CHECK_EQUAL(status(ea), "interrupted");
+  BOOST_CHECK_EQUAL(nb_evals, Params::pop::size * 7);
+  BOOST_REQUIRE(boost::filesystem::exists(ea.res_dir() + "/gen_5"));
+
+  // the run can be resumed
+  misc::clear_stop();
+  ea_t ea2;
+  ea2.set_res_dir("test_stop");
+  ea2.resume(ea.res_dir() + "/gen_5");
+  BOOST_CHECK_EQUAL(ea2.gen(), (size_t)Params::pop::nb_gen);
+  BOOST_CHECK_EQUAL(status(ea2), "finished");
+  boost::filesystem::remove_all(ea.res_dir());
+}
+
+BOOST_AUTO_TEST_CASE(test_stop_abandon) {
+  // the generation 5 is abandoned, and the generation 4 is written
+  misc::clear_stop();
+  misc::set_stop_deadline(0);
+  nb_evals = 0;
+  stop_at = eval_of_gen(5);
+  ea_t ea;
+  ea.set_res_dir("test_stop_abandon");
+  ea.run();
+  misc::set_stop_deadline(-1);
+  BOOST_CHECK(ea.is_stopped());
+  BOOST_CHECK_EQUAL(status(ea), "interrupted");
+  BOOST_CHECK(nb_evals < Params::pop::size * 7);
+  BOOST_CHECK(!boost::filesystem::exists(ea.res_dir() + "/gen_5"));
+  BOOST_REQUIRE(boost::filesystem::exists(ea.res_dir() + "/gen_4"));
+
+  misc::clear_stop();
+  ea_t ea2;
+  ea2.load(ea.res_dir() + "/gen_4");
+  BOOST_CHECK_EQUAL((*boost::fusion::find<state_t>(ea2.stat())).gen(), 4);
+  boost::filesystem::remove_all(ea.res_dir());
+}
+
+struct ParamsDump : public Params {
+  struct pop : public Params::pop {
+    SFERES_CONST int dump_period = 5;
+  };
+};
+
+BOOST_AUTO_TEST_CASE(test_stop_written) {
+  // the generation 5 is finished and already written: it is not written
+  // again (gen_0, gen_5)
+  typedef gen::EvoFloat<10, ParamsDump> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT1<ParamsDump>, ParamsDump> phen_t;
+  typedef boost::fusion::vector<stat::ParetoFront<phen_t, ParamsDump> > stat_t;
+  typedef ea::Nsga2<phen_t, eval::Parallel<ParamsDump>, stat_t, modif::Dummy<>, ParamsDump> ea_t;
+  misc::clear_stop();
+  misc::set_stop_deadline(-1);
+  nb_evals = 0;
+  stop_at = eval_of_gen(5);
+  ea_t ea;
+  ea.set_res_dir("test_stop_written");
+  ea.run();
+  BOOST_CHECK(ea.is_stopped());
+  BOOST_CHECK(boost::filesystem::exists(ea.res_dir() + "/gen_5"));
+  BOOST_CHECK_EQUAL(ea.writer().nb_written(), 2);
+  misc::clear_stop();
+  boost::filesystem::remove_all(ea.res_dir());
+}
+
+BOOST_AUTO_TEST_CASE(test_stop_signal) {
+  misc::clear_stop();
+  run::_set_sig_handler();
+  raise(SIGTERM);
+  BOOST_CHECK_EQUAL(misc::stop_requested(), SIGTERM);
+  misc::clear_stop();
+  // the handler is reset after the first signal
+  struct sigaction sa;
+  sigaction(SIGTERM, 0, &sa);
+  BOOST_CHECK(sa.sa_handler == SIG_DFL);
+}
@@ -39,9 +39,9 @@
 #define BOOST_TEST_MODULE parallel
 #include <iostream>
 #include <boost/test/unit_test.hpp>
-#if 0
-//#ifdef MPI_ENABLED
+#ifdef MPI_ENABLED
 
+#include <unistd.h>
 #include <boost/test/unit_test.hpp>
 #include <sferes/phen/parameters.hpp>
 #include <sferes/gen/evo_float.hpp>
@@ -49,6 +49,7 @@
 #include <sferes/eval/eval.hpp>
 #include <sferes/stat/best_fit.hpp>
 #include <sferes/stat/mean_fit.hpp>
+#include <sferes/stat/mpi_workers.hpp>
 #include <sferes/modif/dummy.hpp>
 
 #include <sferes/eval/mpi.hpp>
@@ -61,6 +62,7 @@ struct Params {
   struct evo_float {
 
     SFERES_CONST float mutation_rate = 0.1f;
+    SFERES_CONST float cross_rate = 0.5f;
     SFERES_CONST float eta_m = 15.0f;
     SFERES_CONST float eta_c = 10.0f;
     SFERES_CONST mutation_t mutation_type = polynomial;
@@ -68,7 +70,7 @@ struct Params {
   };
   struct pop {
     SFERES_CONST unsigned size = 100;
-    SFERES_CONST unsigned nb_gen = 1000;
+    SFERES_CONST unsigned nb_gen = 100;
     SFERES_CONST int dump_period = -1;
     SFERES_CONST int initial_aleat = 1;
     SFERES_CONST float coeff = 1.1f;
@@ -80,10 +82,35 @@ struct Params {
   };
 };
 
+// fault injection: with 4 ranks or more, the rank 2 hangs for a while and
+// the rank 3 stops answering, both after nb_evals_before_fault evaluations;
+// the genotypes that start with the max gene are slow everywhere (slower
+// on the master)
+SFERES_CONST size_t nb_evals_before_fault = 500;
+SFERES_CONST unsigned fault_duration = 3; // s, more than the timeout
+
 SFERES_FITNESS(FitTest, sferes::fit::Fitness) {
 public:
   template<typename Indiv>
   void eval(Indiv& ind) {
+    static size_t nb_evals = 0;
+    if (++nb_evals == nb_evals_before_fault) {
+      int rank = boost::mpi::communicator().rank();
+      if (rank == 2)
+        sleep(fault_duration);
+      else if (rank == 3) {
+        // no answer until the master stops the workers, then quit as a
+        // worker does (MPI_Finalize() is collective)
+        boost::mpi::communicator world;
+        while (!world.iprobe(0, eval::_mpi::tag_quit))
+          usleep(10000);
+        world.recv(0, eval::_mpi::tag_quit);
+        MPI_Finalize();
+        exit(0);
+      }
+    }
+    if (ind.gen().data(0) == 1.0f)
+      usleep(boost::mpi::communicator().rank() == 0 ? 300000 : 250000);
     float v = 0;
     for (unsigned i = 0; i < ind.size(); ++i) {
       float p = ind.data(i);
@@ -99,14 +126,78 @@ BOOST_AUTO_TEST_CASE(test_mpi) {
   typedef gen::EvoFloat<10, Params> gen_t;
   typedef phen::Parameters<gen_t, FitTest<Params>, Params> phen_t;
   typedef eval::Mpi<Params> eval_t;
-  typedef boost::fusion::vector<stat::BestFit<phen_t, Params>, stat::MeanFit<Params> >  stat_t;
+  typedef boost::fusion::vector<stat::BestFit<phen_t, Params>, stat::MeanFit<Params>,
+          stat::MpiWorkers<phen_t, Params> >  stat_t;
   typedef modif::Dummy<> modifier_t;
   typedef ea::RankSimple<phen_t, eval_t, stat_t, modifier_t, Params> ea_t;
   ea_t ea;
+  ea.eval().set_min_timeout(1.0);
   ea.run();
 
   std::cout<<"==> best fitness ="<<ea.stat<0>().best()->fit().value()<<std::endl;
   std::cout<<"==> mean fitness ="<<ea.stat<1>().mean()<<std::endl;
+  ea.stat<2>().show(std::cout, 0);
+
+  // more eval() calls with the same workers (MPI can be initialized only
+  // once per process, so we reuse the evaluator of the EA)
+  typedef boost::shared_ptr<phen_t> indiv_t;
+  eval_t& e = ea.eval();
+  size_t nb_evals = e.nb_evals();
+  for (size_t k = 0; k < 3; ++k) {
+    std::vector<indiv_t> pop;
+    for (size_t i = 0; i < 1000; ++i) {
+      pop.push_back(indiv_t(new phen_t()));
+      pop.back()->random();
+    }
+    e.eval(pop, 0, pop.size(), FitTest<Params>());
+    nb_evals += pop.size();
+    BOOST_CHECK_EQUAL(e.nb_evals(), nb_evals);
+    for (size_t i = 0; i < pop.size(); ++i) {
+      phen_t p(*pop[i]);
+      p.develop();
+      p.fit().eval(p);
+      BOOST_CHECK_EQUAL(p.fit().value(), pop[i]->fit().value());
+    }
+    for (size_t w = 1; w <= e.nb_workers(); ++w)
+      std::cout<<"worker "<<w<<" batch size:"<<e.batch_size(w)
+               <<" throughput:"<<e.throughput(w)
+               <<" failures:"<<e.failures(w)<<std::endl;
+  }
+  // the faulty workers have been removed from the pool
+  for (size_t w = 1; w <= e.nb_workers(); ++w) {
+    BOOST_CHECK_EQUAL(e.alive(w), w != 2 && w != 3);
+    BOOST_CHECK_EQUAL(e.failures(w), e.alive(w) ? 0 : 1);
+  }
+  // the late answers of the rank 2 are in: it is back in the pool
+  sleep(fault_duration);
+  std::vector<indiv_t> pop(100);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = indiv_t(new phen_t());
+    pop[i]->random();
+  }
+  e.eval(pop, 0, pop.size(), FitTest<Params>());
+  for (size_t w = 1; w <= e.nb_workers(); ++w) {
+    BOOST_CHECK_EQUAL(e.alive(w), w != 3);
+    BOOST_CHECK_EQUAL(e.failures(w), (w == 2 || w == 3) ? 1 : 0);
+  }
+  // all the workers time out: the master evaluates the individuals, and
+  // uses the late answers that arrive meanwhile instead
+  if (e.nb_workers() > 0) {
+    std::vector<indiv_t> slow(20);
+    for (size_t i = 0; i < slow.size(); ++i) {
+      slow[i] = indiv_t(new phen_t());
+      slow[i]->random();
+      slow[i]->gen().data(0, 1.0f);
+    }
+    e.eval(slow, 0, slow.size(), FitTest<Params>());
+    BOOST_CHECK(e.nb_recovered() > 0);
+    for (size_t i = 0; i < slow.size(); ++i) {
+      phen_t p(*slow[i]);
+      p.develop();
+      p.fit().eval(p);
+      BOOST_CHECK_EQUAL(p.fit().value(), slow[i]->fit().value());
+    }
+  }
 }
 
 #else
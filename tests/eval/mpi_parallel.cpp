@@ -0,0 +1,118 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE mpi_parallel
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#ifdef MPI_ENABLED
+
+#include <sferes/phen/parameters.hpp>
+#include <sferes/fit/fitness.hpp>
+#include <sferes/gen/evo_float.hpp>
+#include <sferes/eval/mpi_parallel.hpp>
+#include <sferes/misc/stop.hpp>
+
+using namespace sferes;
+using namespace sferes::gen::evo_float;
+
+struct Params {
+  struct evo_float {
+    SFERES_CONST float cross_rate = 0.5f;
+    SFERES_CONST float mutation_rate = 0.1f;
+    SFERES_CONST float eta_m = 15.0f;
+    SFERES_CONST float eta_c = 10.0f;
+    SFERES_CONST mutation_t mutation_type = polynomial;
+    SFERES_CONST cross_over_t cross_over_type = sbx;
+  };
+  struct parameters {
+    SFERES_CONST float min = -10.0f;
+    SFERES_CONST float max = 10.0f;
+  };
+};
+
+SFERES_FITNESS(FitTest, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    float v = 0;
+    for (unsigned i = 0; i < ind.size(); ++i) {
+      float p = ind.data(i);
+      v += p * p * p * p;
+    }
+    this->_value = -v;
+  }
+};
+
+// run with a few local ranks, e.g. mpirun -np 3
+BOOST_AUTO_TEST_CASE(test_mpi_parallel) {
+  typedef gen::EvoFloat<10, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitTest<Params>, Params> phen_t;
+  typedef boost::shared_ptr<phen_t> indiv_t;
+  eval::MpiParallel<Params> e;
+  // the evaluations are finished even after the stop deadline (the
+  // workers never leave this call)
+  misc::request_stop();
+  misc::set_stop_deadline(0);
+  for (size_t k = 0; k < 3; ++k) {
+    std::vector<indiv_t> pop;
+    for (size_t i = 0; i < 2000; ++i) {
+      pop.push_back(indiv_t(new phen_t()));
+      pop.back()->random();
+    }
+    e.eval(pop, 0, pop.size(), FitTest<Params>());
+    BOOST_CHECK_EQUAL(e.nb_evals(), (k + 1) * pop.size());
+    for (size_t i = 0; i < pop.size(); ++i) {
+      phen_t p(*pop[i]);
+      p.develop();
+      p.fit().eval(p);
+      BOOST_CHECK_EQUAL(p.fit().value(), pop[i]->fit().value());
+    }
+    for (size_t w = 1; w <= e.nb_workers(); ++w) {
+      BOOST_CHECK(e.batch_size(w) >= 1);
+      std::cout<<"worker "<<w<<" batch size:"<<e.batch_size(w)<<std::endl;
+    }
+  }
+  misc::clear_stop();
+  misc::set_stop_deadline(-1);
+}
+
+#else
+BOOST_AUTO_TEST_CASE(test_mpi_parallel) {
+  std::cout<<"MPI is disabled"<<std::endl;
+}
+#endif
@@ -48,7 +48,9 @@
 #include <sferes/eval/eval.hpp>
 #include <sferes/stat/best_fit.hpp>
 #include <sferes/stat/mean_fit.hpp>
+#include <sferes/stat/eval_cost.hpp>
 #include <sferes/modif/dummy.hpp>
+#include <sferes/misc/pool.hpp>
 
 #include <sferes/eval/parallel.hpp>
 
@@ -98,7 +100,8 @@ BOOST_AUTO_TEST_CASE(test_parallel) {
   typedef gen::EvoFloat<10, Params> gen_t;
   typedef phen::Parameters<gen_t, FitTest<Params>, Params> phen_t;
   typedef eval::Parallel<Params> eval_t;
-  typedef boost::fusion::vector<stat::BestFit<phen_t, Params>, stat::MeanFit<Params> >  stat_t;
+  typedef boost::fusion::vector<stat::BestFit<phen_t, Params>, stat::MeanFit<Params>,
+          stat::EvalCost<phen_t, Params> >  stat_t;
   typedef modif::Dummy<> modifier_t;
   typedef ea::RankSimple<phen_t, eval_t, stat_t, modifier_t, Params> ea_t;
   ea_t ea;
@@ -107,5 +110,121 @@ BOOST_AUTO_TEST_CASE(test_parallel) {
 
   std::cout<<"==> best fitness ="<<ea.stat<0>().best()->fit().value()<<std::endl;
   std::cout<<"==> mean fitness ="<<ea.stat<1>().mean()<<std::endl;
+  ea.stat<2>().show(std::cout, 0);
+  BOOST_CHECK(ea.stat<2>().makespan() > 0);
 }
 
+
+// individuals that take longer to evaluate (the cost depends on the genotype)
+SFERES_FITNESS(FitSlow, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    float v = 0;
+    size_t n = ind.data(0) > 0 ? 20000 : 200;
+    for (size_t k = 0; k < n; ++k)
+      for (unsigned i = 0; i < ind.size(); ++i)
+        v += ind.data(i) * ind.data(i) / (k + 1);
+    this->_value = -v;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(test_parallel_cost) {
+  typedef gen::EvoFloat<10, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitSlow<Params>, Params> phen_t;
+  typedef eval::Parallel<Params> eval_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+
+  pop_t pop(50);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = boost::shared_ptr<phen_t>(new phen_t());
+    pop[i]->random();
+  }
+  eval_t eval;
+  eval.eval(pop, 0, pop.size(), FitSlow<Params>());
+  BOOST_CHECK_EQUAL(eval.nb_evals(), 50);
+  BOOST_CHECK_EQUAL(eval.costs().size(), 50);
+  BOOST_CHECK(eval.makespan() > 0);
+  BOOST_CHECK(eval.idle_time() >= 0);
+  // evaluate again a part of the population
+  eval.eval(pop, 10, 40, FitSlow<Params>());
+  BOOST_CHECK_EQUAL(eval.nb_evals(), 80);
+  BOOST_CHECK_EQUAL(eval.costs().size(), 30);
+  for (size_t i = 10; i < 40; ++i)
+    BOOST_CHECK(!std::isnan(pop[i]->fit().value()));
+}
+
+// misc::Pool gives the address of a destroyed individual to the next one:
+// the new individual must not inherit the cost of the old one
+BOOST_AUTO_TEST_CASE(test_parallel_cost_recycled) {
+  typedef gen::EvoFloat<10, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitSlow<Params>, Params> phen_t;
+  typedef eval::Parallel<Params> eval_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+
+  pop_t pop(20);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = misc::Pool<phen_t>::create();
+    pop[i]->random();
+  }
+  eval_t eval;
+  eval.eval(pop, 0, pop.size(), FitSlow<Params>());
+  float mean = 0;
+  for (size_t i = 0; i < pop.size(); ++i) {
+    BOOST_CHECK_EQUAL(eval.estimate(pop[i]), eval.costs()[i]);
+    mean += eval.costs()[i];
+  }
+  mean /= pop.size();
+
+  const phen_t* old = pop[0].get();
+  pop[0].reset();
+  pop[0] = misc::Pool<phen_t>::create();
+  BOOST_REQUIRE_EQUAL(pop[0].get(), old);
+  BOOST_CHECK_CLOSE(eval.estimate(pop[0]), mean, 1e-3);
+  BOOST_CHECK_EQUAL(eval.estimate(pop[1]), eval.costs()[1]);
+}
+
+// the start rank of each evaluation; the fitness predicts the evaluation
+// time from the genotype
+std::atomic<int> nb_started(0);
+SFERES_FITNESS(FitExpected, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_value = nb_started++;
+  }
+  template<typename Indiv>
+  float expected_cost(const Indiv& ind) const {
+    return ind.gen().data(0);
+  }
+};
+
+// the new individuals are started in the order of their predicted cost
+BOOST_AUTO_TEST_CASE(test_parallel_dispatch_order) {
+  typedef gen::EvoFloat<10, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitExpected<Params>, Params> phen_t;
+  typedef eval::Parallel<Params> eval_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  BOOST_CHECK(eval::has_expected_cost<phen_t>::value);
+  BOOST_CHECK((!eval::has_expected_cost<phen::Parameters<gen_t, FitSlow<Params>, Params> >::value));
+
+  pop_t pop(50);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = boost::shared_ptr<phen_t>(new phen_t());
+    pop[i]->random();
+  }
+  std::vector<size_t> order(pop.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+    return pop[i]->gen().data(0) > pop[j]->gen().data(0);
+  });
+  eval_t eval;
+  for (size_t i = 0; i < pop.size(); ++i)
+    BOOST_CHECK_EQUAL(eval.estimate(pop[i]), pop[i]->gen().data(0));
+  nb_started = 0;
+  eval.eval(pop, 0, pop.size(), FitExpected<Params>());
+  // (the threads take the next individual at the same time)
+  for (size_t k = 0; k < order.size(); ++k)
+    BOOST_CHECK(fabs(pop[order[k]]->fit().value() - (float)k) < parallel::nb_threads());
+}
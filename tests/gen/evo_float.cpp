@@ -41,6 +41,7 @@
 #include <boost/test/unit_test.hpp>
 #include <sferes/gen/evo_float.hpp>
 #include <tests/check_serialize.hpp>
+#include <sstream>
 
 using namespace sferes::gen;
 using namespace sferes::gen::evo_float;
@@ -61,6 +62,7 @@ void test() {
 
 struct Params1 {
   struct evo_float {
+    SFERES_CONST bool batch_variation = true;
     SFERES_CONST float mutation_rate = 0.1f;
     SFERES_CONST float cross_rate = 0.1f;
     SFERES_CONST mutation_t mutation_type = polynomial;
@@ -90,8 +92,66 @@ BOOST_AUTO_TEST_CASE(polynomial_sbx_serialize) {
   sferes::tests::check_serialize(gen1, gen2, check_evofloat_eq());
 }
 
+// genotypes written with the previous storage (std::vector<float>)
+struct OldFloat {
+  OldFloat() {}
+  OldFloat(size_t n, float v) : _data(n, v) {}
+  std::vector<float> _data;
+  template<class Archive>
+  void serialize(Archive & ar, const unsigned int version) {
+    ar & BOOST_SERIALIZATION_NVP(_data);
+  }
+};
+
+template<typename Ia, typename Oa>
+void check_old_format() {
+  OldFloat old;
+  for (size_t i = 0; i < 10; ++i)
+    old._data.push_back(i / 10.0f);
+  std::stringstream ss;
+  {
+    Oa oa(ss);
+    oa << boost::serialization::make_nvp("gen", old);
+  }
+  EvoFloat<10, Params1> gen;
+  {
+    Ia ia(ss);
+    ia >> boost::serialization::make_nvp("gen", gen);
+  }
+  for (size_t i = 0; i < 10; ++i)
+    BOOST_CHECK_EQUAL(gen.data(i), old._data[i]);
+}
+
+BOOST_AUTO_TEST_CASE(serialize_old_format) {
+  check_old_format<boost::archive::xml_iarchive, boost::archive::xml_oarchive>();
+  check_old_format<boost::archive::text_iarchive, boost::archive::text_oarchive>();
+  check_old_format<boost::archive::binary_iarchive, boost::archive::binary_oarchive>();
+}
+
+// a genotype of another size cannot be loaded
+template<typename Ia, typename Oa>
+void check_wrong_size() {
+  OldFloat old(12, 0.5f);
+  std::stringstream ss;
+  {
+    Oa oa(ss);
+    oa << boost::serialization::make_nvp("gen", old);
+  }
+  EvoFloat<10, Params1> gen;
+  Ia ia(ss);
+  BOOST_CHECK_THROW(ia >> boost::serialization::make_nvp("gen", gen),
+                    boost::archive::archive_exception);
+}
+
+BOOST_AUTO_TEST_CASE(serialize_wrong_size) {
+  check_wrong_size<boost::archive::xml_iarchive, boost::archive::xml_oarchive>();
+  check_wrong_size<boost::archive::text_iarchive, boost::archive::text_oarchive>();
+  check_wrong_size<boost::archive::binary_iarchive, boost::archive::binary_oarchive>();
+}
+
 struct Params2 {
   struct evo_float {
+    SFERES_CONST bool batch_variation = true;
     SFERES_CONST float mutation_rate = 0.1f;
     SFERES_CONST float cross_rate = 0.1f;
     SFERES_CONST mutation_t mutation_type = gaussian;
@@ -121,3 +181,137 @@ BOOST_AUTO_TEST_CASE(uniform_sbx) {
   test<10, Params3>();
 }
 
+
+// the batch operators should give the same distributions as the per-gene
+// ones: compare the mean / variance of the genes over many genotypes
+struct stats {
+  void add(float v) {
+    values.push_back(v);
+  }
+  double mean() const {
+    double m = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+      m += values[i];
+    return m / values.size();
+  }
+  // k-th central moment
+  double moment(int k) const {
+    double m = mean(), r = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+      r += pow(values[i] - m, k);
+    return r / values.size();
+  }
+  double var() const {
+    return moment(2);
+  }
+  std::vector<double> values;
+};
+
+// 4 standard errors of the difference between the means / the variances
+// of two samples; nb_indep is the number of independent values in each
+// sample (lower than n when the values are correlated)
+double mean_tolerance(const stats& s1, const stats& s2, size_t nb_indep) {
+  return 4 * sqrt((s1.var() + s2.var()) / nb_indep);
+}
+double var_tolerance(const stats& s1, const stats& s2, size_t nb_indep) {
+  double v1 = s1.moment(4) - s1.var() * s1.var();
+  double v2 = s2.moment(4) - s2.var() * s2.var();
+  return 4 * sqrt((v1 + v2) / nb_indep);
+}
+
+template<typename G>
+void check_batch_mutation(float init) {
+  SFERES_CONST size_t n = 20000;
+  std::vector<G> g1(n), g2(n);
+  std::vector<G*> p(n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < g1[i].size(); ++j) {
+      g1[i].data(j, init);
+      g2[i].data(j, init);
+    }
+    p[i] = &g2[i];
+    g1[i].mutate();
+  }
+  BOOST_CHECK(sferes::gen::batch<G>::mutation_t::enabled);
+  sferes::gen::batch<G>::mutate(&p[0], n);
+  stats s1, s2;
+  size_t m1 = 0, m2 = 0;
+  for (size_t i = 0; i < n; ++i)
+    for (size_t j = 0; j < g1[i].size(); ++j) {
+      BOOST_CHECK(g2[i].data(j) >= 0 && g2[i].data(j) <= 1);
+      if (g1[i].data(j) != init) {
+        ++m1;
+        s1.add(g1[i].data(j));
+      }
+      if (g2[i].data(j) != init) {
+        ++m2;
+        s2.add(g2[i].data(j));
+      }
+    }
+  double total = n * g1[0].size();
+  BOOST_CHECK_CLOSE(m1 / total, m2 / total, 5);
+  BOOST_CHECK_SMALL(s1.mean() - s2.mean(), 0.005);
+  BOOST_CHECK_CLOSE(s1.var(), s2.var(), 10);
+}
+
+BOOST_AUTO_TEST_CASE(batch_polynomial) {
+  check_batch_mutation<EvoFloat<10, Params1> >(0.5f);
+  check_batch_mutation<EvoFloat<10, Params1> >(0.9f);
+}
+
+BOOST_AUTO_TEST_CASE(batch_gaussian) {
+  check_batch_mutation<EvoFloat<10, Params2> >(0.5f);
+  check_batch_mutation<EvoFloat<10, Params2> >(0.1f);
+}
+
+struct Params4 {
+  struct evo_float {
+    SFERES_CONST bool batch_variation = true;
+    SFERES_CONST float mutation_rate = 0.1f;
+    SFERES_CONST float cross_rate = 0.5f;
+    SFERES_CONST mutation_t mutation_type = polynomial;
+    SFERES_CONST cross_over_t cross_over_type = sbx;
+    SFERES_CONST float eta_m = 15.0f;
+    SFERES_CONST float eta_c = 15.0f;
+  };
+};
+
+BOOST_AUTO_TEST_CASE(batch_sbx) {
+  typedef EvoFloat<10, Params4> gen_t;
+  SFERES_CONST size_t n = 20000;
+  gen_t p1, p2;
+  for (size_t j = 0; j < p1.size(); ++j) {
+    p1.data(j, j == 0 ? 0.5f : 0.2f);
+    p2.data(j, j == 0 ? 0.5f : 0.7f);
+  }
+  std::vector<gen_t> c1(n), c2(n), d1(n), d2(n);
+  std::vector<gen_t*> pp1(n, &p1), pp2(n, &p2), pd1(n), pd2(n);
+  for (size_t i = 0; i < n; ++i) {
+    p1.cross(p2, c1[i], c2[i]);
+    pd1[i] = &d1[i];
+    pd2[i] = &d2[i];
+  }
+  BOOST_CHECK(sferes::gen::batch<gen_t>::enabled);
+  sferes::gen::batch<gen_t>::cross(&pp1[0], &pp2[0], &pd1[0], &pd2[0], n);
+  // gene 0: same value in both parents
+  // gene 1..: first child, second child, and both
+  stats s1, s2, t1, t2;
+  for (size_t i = 0; i < n; ++i) {
+    BOOST_CHECK_EQUAL(d1[i].data(0), 0.5f);
+    BOOST_CHECK_EQUAL(d2[i].data(0), 0.5f);
+    for (size_t j = 1; j < p1.size(); ++j) {
+      BOOST_CHECK(d1[i].data(j) >= 0 && d1[i].data(j) <= 1);
+      s1.add(c1[i].data(j));
+      s2.add(d1[i].data(j));
+      t1.add(c1[i].data(j) + c2[i].data(j));
+      t2.add(d1[i].data(j) + d2[i].data(j));
+    }
+  }
+  // the genes of a child are correlated (the cross-over rate is per
+  // individual), and the children of a pair too: only the n pairs are
+  // counted as independent samples
+  BOOST_CHECK_SMALL(s1.mean() - s2.mean(), mean_tolerance(s1, s2, n));
+  BOOST_CHECK_SMALL(s1.var() - s2.var(), var_tolerance(s1, s2, n));
+  BOOST_CHECK_SMALL(t1.mean() - t2.mean(), mean_tolerance(t1, t2, n));
+  BOOST_CHECK_SMALL(t1.var() - t2.var(), var_tolerance(t1, t2, n));
+}
@@ -0,0 +1,119 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE async_writer
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <sferes/misc/async_writer.hpp>
+
+BOOST_AUTO_TEST_CASE(test_async_writer) {
+  std::string dir = "async_writer_test";
+  boost::filesystem::create_directory(dir);
+  size_t bytes = 0;
+  {
+    sferes::misc::AsyncWriter writer;
+    for (size_t i = 0; i < 10; ++i) {
+      std::string& b = writer.buffer();
+      BOOST_CHECK(b.empty());
+      b.assign(100000 * (i + 1), 'a' + i);
+      bytes += b.size();
+      writer.submit(dir + "/f_" + boost::lexical_cast<std::string>(i));
+    }
+    writer.wait();
+    BOOST_CHECK_EQUAL(writer.nb_written(), 10);
+    BOOST_CHECK_EQUAL(writer.total_bytes(), bytes);
+    BOOST_CHECK_EQUAL(writer.last_bytes(), 1000000);
+    BOOST_CHECK(writer.last_latency() > 0);
+    BOOST_CHECK_EQUAL(writer.nb_errors(), 0);
+
+    // the error is reported, and the writer goes on
+    writer.buffer() = "x";
+    writer.submit(dir + "/no_such_dir/f");
+    writer.wait();
+    BOOST_CHECK_EQUAL(writer.nb_errors(), 1);
+  }
+  for (size_t i = 0; i < 10; ++i) {
+    std::string fname = dir + "/f_" + boost::lexical_cast<std::string>(i);
+    BOOST_CHECK(!boost::filesystem::exists(fname + ".tmp"));
+    std::ifstream ifs(fname.c_str());
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    BOOST_CHECK(ss.str() == std::string(100000 * (i + 1), 'a' + i));
+  }
+  boost::filesystem::remove_all(dir);
+}
+
+// the buffer is filled on the writer thread
+BOOST_AUTO_TEST_CASE(test_async_writer_fill) {
+  std::string dir = "async_writer_fill_test";
+  boost::filesystem::create_directory(dir);
+  std::string src(100000, 'z');
+  {
+    sferes::misc::AsyncWriter writer;
+    for (size_t i = 0; i < 4; ++i)
+      writer.submit(dir + "/f_" + boost::lexical_cast<std::string>(i),
+                    [&src, i](std::string& b) {
+                      b += src.substr(i);
+                    });
+    writer.wait_filled();
+    src = "changed";
+    writer.wait();
+    BOOST_CHECK_EQUAL(writer.nb_written(), 4);
+
+    // an exception of fill is a write error
+    writer.submit(dir + "/error", [](std::string& b) {
+      throw std::runtime_error("fill");
+    });
+    writer.wait();
+    BOOST_CHECK_EQUAL(writer.nb_errors(), 1);
+    BOOST_CHECK(!boost::filesystem::exists(dir + "/error"));
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    std::ifstream ifs((dir + "/f_" + boost::lexical_cast<std::string>(i)).c_str());
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    BOOST_CHECK(ss.str() == std::string(100000 - i, 'z'));
+  }
+  boost::filesystem::remove_all(dir);
+}
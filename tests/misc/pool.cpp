@@ -0,0 +1,117 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE pool
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <sferes/misc/pool.hpp>
+
+struct Obj {
+  Obj() : v(10, 1.0f), id(0) {}
+  std::vector<float> v;
+  int id;
+};
+
+BOOST_AUTO_TEST_CASE(test_pool) {
+  typedef sferes::misc::Pool<Obj> pool_t;
+  pool_t::instance().clear();
+  const Obj* obj = 0x0;
+  {
+    boost::shared_ptr<Obj> o = pool_t::create();
+    BOOST_CHECK_EQUAL(o->v.size(), 10);
+    o->v.resize(5, 2.0f);
+    o->id = 3;
+    obj = o.get();
+  }
+  // the memory of the object is recycled, and the object is default
+  // constructed in it
+  BOOST_CHECK_EQUAL(pool_t::instance().nb_free(), 1);
+  boost::shared_ptr<Obj> o = pool_t::create();
+  BOOST_CHECK_EQUAL(pool_t::instance().nb_free(), 0);
+  BOOST_CHECK(o.get() == obj);
+  BOOST_CHECK_EQUAL(o->id, 0);
+  BOOST_CHECK_EQUAL(o->v.size(), 10);
+  BOOST_CHECK_EQUAL(o->v[7], 1.0f);
+
+  // copies
+  o->id = 5;
+  boost::shared_ptr<Obj> o2 = pool_t::create(*o);
+  BOOST_CHECK_EQUAL(o2->id, 5);
+  BOOST_CHECK(o2.get() != o.get());
+
+  std::vector<boost::shared_ptr<Obj> > pop(100);
+  for (size_t i = 0; i < pop.size(); ++i)
+    pop[i] = pool_t::create();
+  pop.clear();
+  BOOST_CHECK_EQUAL(pool_t::instance().nb_free(), 100);
+  pool_t::instance().clear();
+  BOOST_CHECK_EQUAL(pool_t::instance().nb_free(), 0);
+}
+
+// the released objects are destroyed at once, and the free list of a
+// thread is bounded
+BOOST_AUTO_TEST_CASE(test_pool_capacity) {
+  typedef sferes::misc::Pool<Obj> pool_t;
+  pool_t::instance().clear();
+  boost::shared_ptr<int> state(new int(1));
+  {
+    boost::shared_ptr<boost::shared_ptr<int> > o =
+      sferes::misc::Pool<boost::shared_ptr<int> >::create(state);
+    BOOST_CHECK_EQUAL(state.use_count(), 2);
+  }
+  BOOST_CHECK_EQUAL(state.use_count(), 1);
+
+  size_t c = pool_t::capacity();
+  pool_t::set_capacity(10);
+  std::vector<boost::shared_ptr<Obj> > pop(100);
+  for (size_t i = 0; i < pop.size(); ++i)
+    pop[i] = pool_t::create();
+  pop.clear();
+  BOOST_CHECK_EQUAL(pool_t::instance().nb_free(), 10);
+  pool_t::set_capacity(c);
+
+  // the free list of another thread
+  size_t nb_free = 1;
+  std::thread t([&]() {
+    nb_free = pool_t::instance().nb_free();
+  });
+  t.join();
+  BOOST_CHECK_EQUAL(nb_free, 0);
+}
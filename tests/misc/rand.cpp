@@ -0,0 +1,196 @@
+//| This file is a part of the sferes2 framework.
+//| Copyright 2009, ISIR / Universite Pierre et Marie Curie (UPMC)
+//| Main contributor(s): Jean-Baptiste Mouret, mouret@isir.fr
+//|
+//| This software is a computer program whose purpose is to facilitate
+//| experiments in evolutionary computation and evolutionary robotics.
+//|
+//| This software is governed by the CeCILL license under French law
+//| and abiding by the rules of distribution of free software.  You
+//| can use, modify and/ or redistribute the software under the terms
+//| of the CeCILL license as circulated by CEA, CNRS and INRIA at the
+//| following URL "http://www.cecill.info".
+//|
+//| As a counterpart to the access to the source code and rights to
+//| copy, modify and redistribute granted by the license, users are
+//| provided only with a limited warranty and the software's author,
+//| the holder of the economic rights, and the successive licensors
+//| have only limited liability.
+//|
+//| In this respect, the user's attention is drawn to the risks
+//| associated with loading, using, modifying and/or developing or
+//| reproducing the software by the user in light of its specific
+//| status of free software, that may mean that it is complicated to
+//| manipulate, and that also therefore means that it is reserved for
+//| developers and experienced professionals having in-depth computer
+//| knowledge. Users are therefore encouraged to load and test the
+//| software's suitability as regards their requirements in conditions
+//| enabling the security of their systems and/or data to be ensured
+//| and, more generally, to use and operate it in the same conditions
+//| as regards security.
+//|
+//| The fact that you are presently reading this means that you have
+//| had knowledge of the CeCILL license and that you accept its terms.
+
+
+
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE rand
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <tbb/global_control.h>
+#include <sferes/parallel.hpp>
+#include <sferes/misc/rand.hpp>
+#include <sferes/phen/parameters.hpp>
+#include <sferes/gen/evo_float.hpp>
+#include <sferes/ea/nsga2.hpp>
+#include <sferes/eval/parallel.hpp>
+#include <sferes/modif/dummy.hpp>
+
+using namespace sferes;
+using namespace sferes::gen::evo_float;
+
+// known-answer tests of Random123
+BOOST_AUTO_TEST_CASE(philox_kat) {
+  uint32_t ctr[4] = { 0, 0, 0, 0 }, key[2] = { 0, 0 }, out[4];
+  misc::philox::block(ctr, key, out);
+  BOOST_CHECK_EQUAL(out[0], 0x6627e8d5u);
+  BOOST_CHECK_EQUAL(out[1], 0xe169c58du);
+  BOOST_CHECK_EQUAL(out[2], 0xbc57ac4cu);
+  BOOST_CHECK_EQUAL(out[3], 0x9b00dbd8u);
+
+  uint32_t ctr2[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+  uint32_t key2[2] = { 0xffffffff, 0xffffffff };
+  misc::philox::block(ctr2, key2, out);
+  BOOST_CHECK_EQUAL(out[0], 0x408f276du);
+  BOOST_CHECK_EQUAL(out[1], 0x41c83b0eu);
+  BOOST_CHECK_EQUAL(out[2], 0xa20bc7c6u);
+  BOOST_CHECK_EQUAL(out[3], 0x6d5451fdu);
+
+  // the lanes give the same blocks
+  uint32_t lanes[4 * misc::philox::nb_lanes];
+  misc::philox::blocks(ctr, key, lanes);
+  for (size_t l = 0; l < misc::philox::nb_lanes; ++l) {
+    uint32_t c[4] = { (uint32_t)l, 0, 0, 0 };
+    misc::philox::block(c, key, out);
+    for (size_t j = 0; j < 4; ++j)
+      BOOST_CHECK_EQUAL(lanes[4 * l + j], out[j]);
+  }
+}
+
+struct draw {
+  std::vector<float>& _v;
+  uint32_t _stream;
+  draw(std::vector<float>& v) : _v(v), _stream(misc::rand_stream()) {}
+  void operator() (const parallel::range_t& r) const {
+    for (size_t i = r.begin(); i != r.end(); ++i) {
+      misc::rand_scope scope(_stream, i);
+      float f[3];
+      misc::rand_fill(f, 3);
+      _v[i] = misc::rand<float>() + misc::gaussian_rand<float>() + f[2]
+              + misc::rand<int>(0, 1000) + misc::flip_coin();
+    }
+  }
+};
+
+std::vector<float> draw_all(size_t nb_threads, uint64_t seed) {
+  std::vector<float> v(5000);
+  misc::rand_seed(seed);
+  misc::rand_epoch(3);
+  // (more threads than cores if needed)
+  tbb::global_control c(tbb::global_control::max_allowed_parallelism, nb_threads);
+  tbb::task_arena arena(nb_threads);
+  arena.execute([&] {
+    parallel::p_for(parallel::range_t(0, v.size(), 1), draw(v));
+  });
+  // the main thread, outside of any scope
+  v.push_back(misc::rand<float>());
+  return v;
+}
+
+BOOST_AUTO_TEST_CASE(rand_streams) {
+  std::vector<float> v1 = draw_all(1, 42);
+  std::vector<float> v4 = draw_all(4, 42);
+  std::vector<float> w = draw_all(4, 43);
+  BOOST_CHECK(v1 == v4);
+  BOOST_CHECK(v1 != w);
+  // the individuals draw different numbers
+  BOOST_CHECK(v1[0] != v1[1]);
+
+  // a scope does not change the stream of the thread
+  misc::rand_seed(7);
+  float a = misc::rand<float>();
+  float b = misc::rand<float>();
+  misc::rand_seed(7);
+  BOOST_CHECK_EQUAL(misc::rand<float>(), a);
+  {
+    misc::rand_scope scope(0, 0);
+    misc::rand<float>();
+  }
+  BOOST_CHECK_EQUAL(misc::rand<float>(), b);
+}
+
+struct Params {
+  struct evo_float {
+    SFERES_CONST float cross_rate = 0.5f;
+    SFERES_CONST float mutation_rate = 1.0f / 30.0f;
+    SFERES_CONST float eta_m = 15.0f;
+    SFERES_CONST float eta_c = 10.0f;
+    SFERES_CONST mutation_t mutation_type = polynomial;
+    SFERES_CONST cross_over_t cross_over_type = sbx;
+  };
+  struct pop {
+    SFERES_CONST unsigned size = 200;
+    SFERES_CONST unsigned nb_gen = 20;
+    SFERES_CONST float initial_aleat = 1.0f;
+    SFERES_CONST int dump_period = -1;
+  };
+  struct parameters {
+    SFERES_CONST float min = 0.0f;
+    SFERES_CONST float max = 1.0f;
+  };
+};
+
+// ZDT1 with some noise
+SFERES_FITNESS(FitNoisy, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(2);
+    float g = 1.0f;
+    for (size_t i = 1; i < ind.size(); ++i)
+      g += 9.0f * ind.data(i) / (ind.size() - 1);
+    this->_objs[0] = -ind.data(0);
+    this->_objs[1] = -g * (1.0f - sqrtf(ind.data(0) / g)) + misc::gaussian_rand<float>(0, 0.01f);
+  }
+};
+
+typedef gen::EvoFloat<10, Params> gen_t;
+typedef phen::Parameters<gen_t, FitNoisy<Params>, Params> phen_t;
+
+std::vector<float> run_nsga2(size_t nb_threads, uint64_t seed) {
+  typedef ea::Nsga2<phen_t, eval::Parallel<Params>, boost::fusion::vector<>,
+          modif::Dummy<>, Params> ea_t;
+  ea_t ea;
+  misc::rand_seed(seed);
+  tbb::global_control c(tbb::global_control::max_allowed_parallelism, nb_threads);
+  tbb::task_arena arena(nb_threads);
+  arena.execute([&] { ea.run(); });
+  std::vector<float> res;
+  for (size_t i = 0; i < ea.pop().size(); ++i) {
+    res.insert(res.end(), ea.pop()[i]->gen().data().begin(), ea.pop()[i]->gen().data().end());
+    res.push_back(ea.pop()[i]->fit().obj(1));
+  }
+  return res;
+}
+
+BOOST_AUTO_TEST_CASE(nsga2_reproducible) {
+  std::vector<float> r1 = run_nsga2(1, 1234);
+  std::vector<float> r4 = run_nsga2(4, 1234);
+  std::vector<float> r = run_nsga2(4, 4321);
+  BOOST_CHECK(r1 == r4);
+  BOOST_CHECK(r1 != r);
+}
@@ -88,6 +88,9 @@ float _g(const Indiv &ind) {
   return g;
 }
 
+// number of calls to dist() (the tests are not parallel)
+size_t nb_dists = 0;
+
 SFERES_FITNESS(FitZDT2, sferes::fit::Fitness) {
 public:
   template<typename Indiv>
@@ -106,6 +109,7 @@ public:
   }
   template<typename Indiv>
   float dist(const Indiv& ind) {
+    ++nb_dists;
     return (_v - ind.fit()._v).squaredNorm();
   }
   Eigen::VectorXf _v;
@@ -134,3 +138,151 @@ BOOST_AUTO_TEST_CASE(test_nsga2) {
   }
 
 }
+
+// the same genotype, with the behaviour descriptor contract (see
+// fit/desc_matrix.hpp); dist() is only used by the reference
+SFERES_FITNESS(FitDesc, sferes::fit::Fitness) {
+public:
+  SFERES_CONST size_t desc_size = 30;
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(3);
+    this->_objs[0] = -ind.data(0);
+    this->_objs[1] = -_g(ind);
+    this->_objs[2] = 0;
+    for (size_t i = 0; i < desc_size; ++i)
+      _v[i] = ind.data(i);
+  }
+  template<typename Indiv>
+  float dist(const Indiv& ind) {
+    float s = 0;
+    for (size_t i = 0; i < desc_size; ++i)
+      s += (_v[i] - ind.fit()._v[i]) * (_v[i] - ind.fit()._v[i]);
+    return sqrtf(s);
+  }
+  const float* desc() const {
+    return _v;
+  }
+  float _v[desc_size];
+};
+
+template<typename Phen>
+struct FakeEa {
+  typedef Phen phen_t;
+  typedef std::vector<boost::shared_ptr<Phen> > pop_t;
+  pop_t& _pop;
+  FakeEa(pop_t& p) : _pop(p) {}
+  pop_t& pop() { return _pop; }
+};
+
+BOOST_AUTO_TEST_CASE(test_diversity_desc) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  // more than a tile, and a duplicate
+  pop_t pop(600);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = boost::shared_ptr<phen_t>(new phen_t());
+    pop[i]->random();
+    pop[i]->develop();
+    pop[i]->fit().eval(*pop[i]);
+  }
+  pop[1] = boost::shared_ptr<phen_t>(new phen_t(*pop[0]));
+  std::vector<float> ref(pop.size());
+  for (size_t i = 0; i < pop.size(); ++i) {
+    for (size_t j = 0; j < pop.size(); ++j)
+      ref[i] += pop[i]->fit().dist(*pop[j]);
+    ref[i] /= pop.size();
+  }
+  FakeEa<phen_t> ea(pop);
+  modif::Diversity<> div;
+  div.apply(ea);
+  for (size_t i = 0; i < pop.size(); ++i)
+    BOOST_CHECK_CLOSE(pop[i]->fit().obj(2), ref[i], 1e-3);
+}
+
+template<typename Phen>
+std::vector<boost::shared_ptr<Phen> > random_pop(size_t n) {
+  std::vector<boost::shared_ptr<Phen> > pop(n);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = boost::shared_ptr<Phen>(new Phen());
+    pop[i]->random();
+    pop[i]->develop();
+    pop[i]->fit().eval(*pop[i]);
+  }
+  return pop;
+}
+
+// the last objective + the mean distance to the population
+template<typename Pop>
+std::vector<float> div_ref(const Pop& pop) {
+  std::vector<float> ref(pop.size());
+  for (size_t i = 0; i < pop.size(); ++i) {
+    float d = 0.0f;
+    for (size_t j = 0; j < pop.size(); ++j)
+      d += pop[i]->fit().dist(*pop[j]);
+    ref[i] = d / pop.size() + pop[i]->fit().obj(2);
+  }
+  return ref;
+}
+
+BOOST_AUTO_TEST_CASE(test_diversity_cache) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT2<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  const size_t n = 100;
+  pop_t pop = random_pop<phen_t>(n);
+  FakeEa<phen_t> ea(pop);
+  modif::Diversity<> div;
+  BOOST_CHECK(!div.cache());
+  div.set_cache(true);
+
+  // each pair once
+  std::vector<float> ref = div_ref(pop);
+  nb_dists = 0;
+  div.apply(ea);
+  BOOST_CHECK_EQUAL(nb_dists, n * (n + 1) / 2);
+  for (size_t i = 0; i < n; ++i)
+    BOOST_CHECK_EQUAL(pop[i]->fit().obj(2), ref[i]);
+
+  // half of the population survives, in another order: only the pairs
+  // with a new individual are computed
+  pop_t next = random_pop<phen_t>(n);
+  for (size_t i = 0; i < n / 2; ++i)
+    next[2 * i] = pop[n - 1 - i];
+  pop = next;
+  ref = div_ref(pop);
+  nb_dists = 0;
+  div.apply(ea);
+  BOOST_CHECK_EQUAL(nb_dists, n * (n + 1) / 2 - (n / 2) * (n / 2 + 1) / 2);
+  for (size_t i = 0; i < n; ++i)
+    BOOST_CHECK_EQUAL(pop[i]->fit().obj(2), ref[i]);
+
+  // without the cache (the rows are summed in another order)
+  div.set_cache(false);
+  ref = div_ref(pop);
+  nb_dists = 0;
+  div.apply(ea);
+  BOOST_CHECK_EQUAL(nb_dists, n * (n + 1) / 2);
+  for (size_t i = 0; i < n; ++i)
+    BOOST_CHECK_CLOSE(pop[i]->fit().obj(2), ref[i], 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(test_diversity_sampled) {
+  typedef gen::EvoFloat<30, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitZDT2<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  misc::rand_seed(1);
+  const size_t n = 400, m = 100;
+  pop_t pop = random_pop<phen_t>(n);
+  std::vector<float> ref = div_ref(pop);
+  FakeEa<phen_t> ea(pop);
+  modif::Diversity<> div;
+  div.set_sample_size(m);
+  nb_dists = 0;
+  div.apply(ea);
+  BOOST_CHECK_EQUAL(nb_dists, n * m);
+  // (an estimate of the mean distance)
+  for (size_t i = 0; i < n; ++i)
+    BOOST_CHECK_CLOSE(pop[i]->fit().obj(2), ref[i], 20);
+}
@@ -52,6 +52,7 @@
 #include <sferes/modif/novelty.hpp>
 #include <sferes/stat/archive.hpp>
 #include <sferes/stat/best_archive_fit.hpp>
+#include <sferes/stat/compact_archive.hpp>
 #include <Eigen/Core>
 
 using namespace sferes;
@@ -191,3 +192,280 @@ BOOST_AUTO_TEST_CASE(test_novelty) {
   }
 }
 */
+
+// the sparseness as computed before the nearest-neighbour indexes (with
+// the matrix of all the distances)
+template<typename Phen>
+std::vector<float> dense_sparseness(const std::vector<boost::shared_ptr<Phen> >& archive,
+                                    const std::vector<boost::shared_ptr<Phen> >& pop) {
+  SFERES_CONST size_t k = Params::novelty::k;
+  std::vector<boost::shared_ptr<Phen> > all = archive;
+  all.insert(all.end(), pop.begin(), pop.end());
+  Eigen::MatrixXf distances(pop.size(), all.size());
+  for (size_t i = 0; i < pop.size(); ++i)
+    for (size_t j = 0; j < all.size(); ++j)
+      distances(i, j) = pop[i]->fit().dist(*all[j]);
+  std::vector<float> res(pop.size());
+  for (size_t i = 0; i < pop.size(); ++i) {
+    Eigen::VectorXf vd = distances.row(i);
+    std::partial_sort(vd.data(), vd.data() + k, vd.data() + vd.size());
+    double n = vd.head<k>().sum() / k;
+    res[i] = n;
+  }
+  return res;
+}
+
+// a 2D behaviour descriptor
+SFERES_FITNESS(FitDesc, sferes::fit::Fitness) {
+public:
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(2);
+    this->_objs[0] = -ind.data(0);
+    _v = Eigen::Vector2f(ind.data(0), ind.data(1));
+  }
+  template<typename Indiv>
+  float dist(const Indiv& ind) {
+    return (_v - ind.fit()._v).squaredNorm();
+  }
+  const Eigen::Vector2f& desc() const {
+    return _v;
+  }
+  Eigen::Vector2f _v;
+};
+
+struct ParamsArchive : public Params {
+  struct novelty {
+    SFERES_CONST float rho_min_init = 0.0; // everybody goes to the archive
+    SFERES_CONST size_t k = Params::novelty::k;
+    SFERES_CONST size_t stalled_tresh = 2500;
+    SFERES_CONST size_t adding_tresh = 4;
+    SFERES_CONST float add_to_archive_prob = 0;
+  };
+};
+
+template<typename Pop>
+struct FakeEa {
+  Pop& _pop;
+  size_t _gen;
+  FakeEa(Pop& p, size_t gen = 0) : _pop(p), _gen(gen) {}
+  Pop& pop() { return _pop; }
+  size_t gen() const { return _gen; }
+};
+
+template<typename Phen>
+std::vector<boost::shared_ptr<Phen> > random_pop() {
+  std::vector<boost::shared_ptr<Phen> > pop(Params::pop::size);
+  for (size_t i = 0; i < pop.size(); ++i) {
+    pop[i] = boost::shared_ptr<Phen>(new Phen());
+    pop[i]->random();
+    pop[i]->develop();
+    pop[i]->fit().eval(*pop[i]);
+  }
+  return pop;
+}
+
+BOOST_AUTO_TEST_CASE(test_novelty_knn) {
+  typedef gen::EvoFloat<2, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  typedef modif::Novelty<phen_t, ParamsArchive> brute_t;
+  typedef modif::knn::KdTree<phen_t, 2> index_t;
+  typedef modif::Novelty<phen_t, ParamsArchive, index_t> kdtree_t;
+  brute_t brute;
+  kdtree_t kdtree;
+  for (size_t g = 0; g < 20; ++g) {
+    pop_t pop = random_pop<phen_t>();
+    // some duplicates of the archive (distance 0)
+    for (size_t i = 0; i < 10 && g > 0; ++i)
+      pop[i] = boost::shared_ptr<phen_t>(new phen_t(*brute.archive()[i * 7]));
+    std::vector<float> ref = dense_sparseness(brute.archive(), pop);
+    FakeEa<pop_t> ea(pop, g);
+    brute.apply(ea);
+    for (size_t i = 0; i < pop.size(); ++i)
+      BOOST_CHECK_EQUAL(pop[i]->fit().obj(1), ref[i]);
+    kdtree.apply(ea);
+    for (size_t i = 0; i < pop.size(); ++i)
+      BOOST_CHECK_EQUAL(pop[i]->fit().obj(1), ref[i]);
+    BOOST_CHECK_EQUAL(brute.archive().size(), kdtree.archive().size());
+  }
+  // (the k-d tree is used once the archive is large enough)
+  BOOST_CHECK(kdtree.archive().size() > 2 * index_t::min_tree_size);
+}
+
+BOOST_AUTO_TEST_CASE(test_novelty_bounded) {
+  typedef gen::EvoFloat<2, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  typedef modif::knn::KdTree<phen_t, 2> index_t;
+  modif::novelty::eviction_t policies[] =
+  { modif::novelty::fifo, modif::novelty::least_novel, modif::novelty::random };
+  for (size_t p = 0; p < 3; ++p) {
+    modif::Novelty<phen_t, ParamsArchive> brute;
+    modif::Novelty<phen_t, ParamsArchive, index_t> kdtree;
+    brute.set_capacity(300, policies[p]);
+    kdtree.set_capacity(300, policies[p]);
+    for (size_t g = 0; g < 10; ++g) {
+      pop_t pop = random_pop<phen_t>();
+      std::vector<float> ref = dense_sparseness(brute.archive(), pop);
+      FakeEa<pop_t> ea(pop, g);
+      brute.apply(ea);
+      for (size_t i = 0; i < pop.size(); ++i)
+        BOOST_CHECK_EQUAL(pop[i]->fit().obj(1), ref[i]);
+      BOOST_CHECK(brute.archive().size() <= 300);
+      BOOST_CHECK_EQUAL(brute.ids().size(), brute.archive().size());
+      if (policies[p] == modif::novelty::random)
+        continue;
+      // the same points are evicted (and the k-d tree is rebuilt)
+      ref = dense_sparseness(kdtree.archive(), pop);
+      kdtree.apply(ea);
+      for (size_t i = 0; i < pop.size(); ++i)
+        BOOST_CHECK_EQUAL(pop[i]->fit().obj(1), ref[i]);
+      BOOST_CHECK(brute.ids() == kdtree.ids());
+    }
+    const std::vector<uint64_t>& ids = brute.ids();
+    BOOST_CHECK_EQUAL(ids.size(), 300);
+    if (policies[p] == modif::novelty::fifo) {
+      // the last 300 points
+      BOOST_CHECK_EQUAL(ids.back(), (9ul << 32) | 99);
+      BOOST_CHECK_EQUAL(ids.front(), (7ul << 32) | 0);
+    }
+    if (policies[p] == modif::novelty::least_novel)
+      BOOST_CHECK(*std::min_element(brute.scores().begin(), brute.scores().end()) > 0);
+  }
+}
+
+// the fake EA for stat::CompactArchive
+template<typename M>
+struct FakeEaStat {
+  const M& _m;
+  FakeEaStat(const M& m) : _m(m) {}
+  template<int I>
+  const M& fit_modifier() const { return _m; }
+  bool dump_enabled() const { return false; }
+  size_t gen() const { return 0; }
+  size_t nb_evals() const { return 0; }
+  std::string res_dir() const { return ""; }
+};
+
+BOOST_AUTO_TEST_CASE(test_novelty_compact) {
+  typedef gen::EvoFloat<2, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  typedef modif::knn::Compact<phen_t, 2, modif::knn::l2_squared> index_t;
+  typedef modif::Novelty<phen_t, ParamsArchive, index_t> compact_t;
+  modif::Novelty<phen_t, ParamsArchive> brute;
+  compact_t compact;
+  // 20 bytes per point (descriptor, id, score)
+  compact.set_memory_budget(20 * 500);
+  BOOST_CHECK_EQUAL(compact.capacity(), 500);
+  brute.set_capacity(500);
+  for (size_t g = 0; g < 10; ++g) {
+    pop_t pop = random_pop<phen_t>();
+    FakeEa<pop_t> ea(pop, g);
+    brute.apply(ea);
+    std::vector<float> ref(pop.size());
+    for (size_t i = 0; i < pop.size(); ++i)
+      ref[i] = pop[i]->fit().obj(1);
+    compact.apply(ea);
+    // (dist() is the squared norm, like l2_squared)
+    for (size_t i = 0; i < pop.size(); ++i)
+      BOOST_CHECK_EQUAL(pop[i]->fit().obj(1), ref[i]);
+  }
+  BOOST_REQUIRE_EQUAL(compact.index().size(), 500);
+  BOOST_CHECK(compact.ids() == brute.ids());
+  for (size_t i = 0; i < 500; ++i)
+    BOOST_CHECK_EQUAL(compact.index().descriptors()[i * 2], brute.archive()[i]->fit().desc()(0));
+
+  stat::CompactArchive<phen_t, Params> s;
+  s.refresh(FakeEaStat<compact_t>(compact));
+  BOOST_CHECK_EQUAL(s.size(), 500);
+  BOOST_CHECK_EQUAL(s.dim(), 2);
+  BOOST_CHECK(s.descriptors() == compact.index().descriptors());
+}
+
+// an 8D behaviour descriptor, with the descriptor contract (see
+// fit/desc_matrix.hpp); dist() is only used by the reference
+SFERES_FITNESS(FitBehaviour, sferes::fit::Fitness) {
+public:
+  SFERES_CONST size_t desc_size = 8;
+  template<typename Indiv>
+  void eval(Indiv& ind) {
+    this->_objs.resize(2);
+    this->_objs[0] = -ind.data(0);
+    for (size_t i = 0; i < desc_size; ++i)
+      _v[i] = ind.data(i);
+  }
+  template<typename Indiv>
+  float dist(const Indiv& ind) {
+    float s = 0;
+    for (size_t i = 0; i < desc_size; ++i)
+      s += (_v[i] - ind.fit()._v[i]) * (_v[i] - ind.fit()._v[i]);
+    return sqrtf(s);
+  }
+  const float* desc() const {
+    return _v;
+  }
+  float _v[desc_size];
+};
+
+BOOST_AUTO_TEST_CASE(test_novelty_desc) {
+  typedef gen::EvoFloat<8, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitBehaviour<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  typedef modif::Novelty<phen_t, ParamsArchive> novelty_t;
+  BOOST_CHECK((std::is_same<novelty_t::index_t, modif::knn::Blocked<phen_t> >::value));
+  BOOST_CHECK(!fit::has_desc<FitDesc<Params> >::value);
+  novelty_t novelty;
+  for (size_t g = 0; g < 10; ++g) {
+    pop_t pop = random_pop<phen_t>();
+    // some duplicates of the archive (distance 0)
+    for (size_t i = 0; i < 10 && g > 0; ++i)
+      pop[i] = boost::shared_ptr<phen_t>(new phen_t(*novelty.archive()[i * 7]));
+    std::vector<float> ref = dense_sparseness(novelty.archive(), pop);
+    FakeEa<pop_t> ea(pop, g);
+    novelty.apply(ea);
+    // (||a||^2 + ||b||^2 - 2ab is not bit-identical to dist())
+    for (size_t i = 0; i < pop.size(); ++i)
+      BOOST_CHECK_SMALL(pop[i]->fit().obj(1) - ref[i], 1e-4f);
+  }
+  // (several tiles)
+  BOOST_CHECK(novelty.archive().size() > modif::knn::Blocked<phen_t>::tile_size);
+}
+
+struct ParamsProb : public Params {
+  struct novelty {
+    SFERES_CONST float rho_min_init = 0.05;
+    SFERES_CONST size_t k = Params::novelty::k;
+    SFERES_CONST size_t stalled_tresh = 2500;
+    SFERES_CONST size_t adding_tresh = 1000;
+    SFERES_CONST float add_to_archive_prob = 0.3;
+  };
+};
+
+BOOST_AUTO_TEST_CASE(test_novelty_insertion_order) {
+  typedef gen::EvoFloat<2, Params> gen_t;
+  typedef phen::Parameters<gen_t, FitDesc<Params>, Params> phen_t;
+  typedef std::vector<boost::shared_ptr<phen_t> > pop_t;
+  modif::Novelty<phen_t, ParamsProb> novelty;
+  std::vector<uint64_t> ids;
+  for (size_t g = 0; g < 10; ++g) {
+    pop_t pop = random_pop<phen_t>();
+    std::vector<float> ref = dense_sparseness(novelty.archive(), pop);
+    // the individuals a serial loop adds, with the same random draws
+    // (rho_min does not change: adding_tresh is never reached, and
+    // stalled_tresh is more than the number of individuals)
+    misc::rand_seed(g + 1);
+    for (size_t i = 0; i < pop.size(); ++i)
+      if (ref[i] > ParamsProb::novelty::rho_min_init
+          || misc::rand<float>() < ParamsProb::novelty::add_to_archive_prob)
+        ids.push_back(((uint64_t)g << 32) | i);
+    misc::rand_seed(g + 1);
+    FakeEa<pop_t> ea(pop, g);
+    novelty.apply(ea);
+    for (size_t i = 0; i < pop.size(); ++i)
+      BOOST_CHECK_EQUAL(pop[i]->fit().obj(1), ref[i]);
+  }
+  BOOST_CHECK(novelty.ids() == ids);
+  BOOST_CHECK(ids.size() < 10 * Params::pop::size);
+}